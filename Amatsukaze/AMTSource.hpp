@@ -14,10 +14,14 @@
 
 #include <memory>
 #include <mutex>
+#include <condition_variable>
 #include <set>
 
 #include "Tree.hpp"
 #include "List.hpp"
+#include "Mpeg2TsParser.hpp"
+#include "TsIndex.hpp"
+#include "ProcessThread.hpp"
 
 
 namespace av {
@@ -39,6 +43,413 @@ struct AMTSourceData {
 	std::vector<FilterAudioFrame> audioFrames;
 };
 
+// z[h̃CfbNX璆ԉft@CiPSjč\ēǂ
+// fPES̓CfbNXɂTSt@C͈̔͂ǂőgݗĒ
+class VirtualPsReader : public ReadIOContext, AMTObject
+{
+	enum {
+		IO_BUFFER_SIZE = 256 * 1024,
+	};
+
+	// wPIDPESpPbg擪1W߂
+	class PesCollector : public TsPacketParser {
+	public:
+		PesCollector(AMTContext& ctx, AutoBuffer& buffer)
+			: TsPacketParser(ctx)
+			, buffer(buffer)
+			, pid(-1)
+			, length(0)
+		{ }
+
+		void init(int pid, int length) {
+			reset();
+			buffer.clear();
+			this->pid = pid;
+			this->length = length;
+		}
+
+	protected:
+		virtual void onTsPacket(TsPacket packet) {
+			if (packet.PID() != pid || !packet.has_payload()) return;
+			if (buffer.size() == 0 && !packet.payload_unit_start_indicator()) return;
+			if ((int)buffer.size() >= length) return;
+			buffer.add(packet.payload());
+		}
+
+	private:
+		AutoBuffer& buffer;
+		int pid;
+		int length;
+	};
+
+	VirtualPsIndex index;
+	File tsFile;
+	int64_t pos;
+
+	int curPes; // pesDataɓĂPESiȂ-1j
+	std::vector<uint8_t> tsData;
+	AutoBuffer pesData;
+	PesCollector collector;
+
+	static VirtualPsIndex LoadIndex(const tstring& indexpath) {
+		VirtualPsIndex index;
+		index.load(indexpath);
+		return index;
+	}
+
+	bool LoadPes(int pesIdx) {
+		if (curPes == pesIdx) {
+			return true;
+		}
+		curPes = -1;
+		const VirtualPsPes& pes = index.pesList[pesIdx];
+		tsData.resize((size_t)(pes.tsEnd - pes.tsOffset));
+		tsFile.seek(pes.tsOffset, SEEK_SET);
+		size_t readBytes = tsFile.read(MemoryChunk(tsData.data(), tsData.size()));
+		collector.init(pes.pid, pes.length);
+		collector.inputTS(MemoryChunk(tsData.data(), readBytes));
+		collector.flush();
+		if ((int)pesData.size() < pes.length) {
+			ctx.warnF("[VirtualPsReader] TSPESč\ł܂łiʒu: %lldj", pes.tsOffset);
+			return false;
+		}
+		curPes = pesIdx;
+		return true;
+	}
+
+public:
+	VirtualPsReader(AMTContext& ctx, const tstring& indexpath)
+		: ReadIOContext(IO_BUFFER_SIZE)
+		, AMTObject(ctx)
+		, index(LoadIndex(indexpath))
+		, tsFile(index.srcpath, _T("rb"))
+		, pos(0)
+		, curPes(-1)
+		, collector(ctx, pesData)
+	{ }
+
+	int64_t Size() const {
+		return index.size;
+	}
+
+	// PSoffsetmc.lengthoCgǂ
+	// ߂l: ǂ񂾃oCgiI[Ȃ0AG[Ȃ-1j
+	int ReadAt(int64_t offset, MemoryChunk mc) {
+		size_t done = 0;
+		while (done < mc.length) {
+			const VirtualPsSegment* seg = index.findSegment(offset);
+			if (seg == nullptr) {
+				break;
+			}
+			int64_t within = offset - seg->offset;
+			size_t len = (size_t)std::min<int64_t>(mc.length - done, seg->length - within);
+			const uint8_t* src;
+			if (seg->pes == -1) {
+				src = index.headerData.data() + seg->srcOffset + within;
+			}
+			else {
+				if (!LoadPes(seg->pes)) {
+					return -1;
+				}
+				src = pesData.ptr() + seg->srcOffset + within;
+			}
+			memcpy(mc.data + done, src, len);
+			done += len;
+			offset += len;
+		}
+		return (int)done;
+	}
+
+protected:
+	virtual int onRead(MemoryChunk mc) {
+		try {
+			int ret = ReadAt(pos, mc);
+			if (ret > 0) {
+				pos += ret;
+			}
+			return ret;
+		}
+		catch (const Exception& e) {
+			ctx.warnF("[VirtualPsReader] TS̓ǂݍ݂Ɏs: %s", e.message());
+			return -1;
+		}
+	}
+
+	virtual int64_t onSeek(int64_t offset, int whence) {
+		if (whence & AVSEEK_SIZE) {
+			return index.size;
+		}
+		switch (whence & ~AVSEEK_FORCE) {
+		case SEEK_SET:
+			break;
+		case SEEK_CUR:
+			offset += pos;
+			break;
+		case SEEK_END:
+			offset += index.size;
+			break;
+		default:
+			return -1;
+		}
+		if (offset < 0) {
+			return -1;
+		}
+		pos = offset;
+		return pos;
+	}
+};
+
+// fR[hς݃t[̕ۑt@C
+// ŏAMTSource擪珇ɏŁA2ڈȍ~ichapter_exe, tB^, GR[hj
+// fR[_g킸ɂǂށB݂͏ݑƂ̈ꎞt@CɍsA
+// St[{̖Oɂ̂ŁA{̖Õt@C͏ɊSȂ̂ɂȂB
+// YV12̂ݑΉiUtVideoŉtkj
+class DecodedFrameStore : AMTObject
+{
+	// et[̃f[^̐擪ɕt
+	struct FrameHeader {
+		int refFrame;    // -1łȂ΂̃t[ƓifR[hłȂt[j
+		int codedSize;
+		int frameType;
+		int qpWidth;     // QPe[uiȂ0j
+		int qpHeight;
+		int qpStride;
+		int qpScaleType;
+		int nonBWidth;   // Onon B QPe[uiȂ0j
+		int nonBHeight;
+	};
+
+	int width;
+	int height;
+	int numFrames;
+	bool readMode;
+	std::unique_ptr<LosslessVideoFile> file;
+	CCodecPointer codec;
+	std::vector<uint8_t> rawFrame;
+	std::vector<uint8_t> buffer;
+	int nextWrite;
+	tstring path;
+	tstring writePath; // ݒ̈ꎞt@C
+	bool writeStarted;
+	std::mutex mutex;
+
+	static void PutPlane(std::vector<uint8_t>& buf, const PVideoFrame& frame, int w, int h) {
+		const uint8_t* src = frame->GetReadPtr();
+		int pitch = frame->GetPitch();
+		for (int y = 0; y < h; ++y) {
+			buf.insert(buf.end(), src + y * pitch, src + y * pitch + w);
+		}
+	}
+
+	static PVideoFrame GetPlane(const uint8_t* src, int w, int h, IScriptEnvironment* env) {
+		VideoInfo qpvi = VideoInfo();
+		qpvi.width = w;
+		qpvi.height = h;
+		qpvi.pixel_type = VideoInfo::CS_Y8;
+		PVideoFrame frame = env->NewVideoFrame(qpvi);
+		env->BitBlt(frame->GetWritePtr(), frame->GetPitch(), src, w, w, h);
+		return frame;
+	}
+
+	void WriteEntry(const FrameHeader& hdr) {
+		memcpy(buffer.data(), &hdr, sizeof(hdr));
+		file->writeFrame(buffer.data(), (int)buffer.size());
+		if (++nextWrite == numFrames) {
+			FinishWrite();
+		}
+	}
+
+	// St[ꎞt@CĖ{̖Oɂ
+	void FinishWrite() {
+		file->flush();
+		if (!file->isComplete()) {
+			// ǂݍ݂ɎgȂ̂ŎcȂifXgN^ŏj
+			return;
+		}
+		codec->EncodeEnd();
+		file = nullptr;
+		if (File::move(writePath, path)) {
+			ctx.info("[AMTSource] fR[hς݃t[̕ۑ܂");
+		}
+		else {
+			// ̃\[XɊēǂݍ݂ɎgĂ
+			File::remove(writePath);
+		}
+	}
+
+public:
+	DecodedFrameStore(AMTContext& ctx, const tstring& path, int width, int height, int numFrames)
+		: AMTObject(ctx)
+		, width(width)
+		, height(height)
+		, numFrames(numFrames)
+		, readMode(false)
+		, codec(make_unique_ptr(CCodec::CreateInstance(UTVF_ULH0, "Amatsukaze")))
+		, rawFrame(width * height * 3 / 2)
+		, nextWrite(0)
+		, path(path)
+		, writeStarted(false)
+	{
+		// St[ĂΓǂݍ݂Ɏg
+		if (File::exists(path)) {
+			try {
+				file = std::unique_ptr<LosslessVideoFile>(new LosslessVideoFile(ctx, path, _T("rb")));
+				file->readHeader();
+				readMode = (file->getWidth() == width && file->getHeight() == height &&
+					file->getNumFrames() == numFrames && file->isComplete());
+			}
+			catch (const IOException&) {
+				readMode = false;
+			}
+		}
+		if (readMode) {
+			auto extra = file->getExtra();
+			if (codec->DecodeBegin(UTVF_YV12, width, height, CBGROSSWIDTH_WINDOWS, extra.data(), (int)extra.size())) {
+				THROW(RuntimeException, "failed to DecodeBegin (UtVideo)");
+			}
+		}
+		else {
+			file = nullptr;
+		}
+	}
+
+	~DecodedFrameStore() {
+		if (readMode) {
+			codec->DecodeEnd();
+		}
+		else if (file != nullptr) {
+			// ԂɃANZXȂir܂ł̃t@C͎cȂj
+			codec->EncodeEnd();
+			file = nullptr;
+			File::remove(writePath);
+			ctx.infoF("[AMTSource] fR[hς݃t[%d/%dt[܂łۑ܂łi܂蒼܂j",
+				nextWrite, numFrames);
+		}
+	}
+
+	// St[̂œǂݍ݂Ɏg
+	bool IsReadable() const { return readMode; }
+
+	// ȂΈꎞt@Cɍŏ珑
+	// {̖Õt@C͊܂ŐGȂ̂ŁÃ\[XɏĂĂ󂳂Ȃ
+	void StartWrite() {
+		size_t extraSize = codec->EncodeGetExtraDataSize();
+		std::vector<uint8_t> extra(extraSize);
+		if (codec->EncodeGetExtraData(extra.data(), extraSize, UTVF_YV12, width, height)) {
+			THROW(RuntimeException, "failed to EncodeGetExtraData (UtVideo)");
+		}
+		if (codec->EncodeBegin(UTVF_YV12, width, height, CBGROSSWIDTH_WINDOWS)) {
+			THROW(RuntimeException, "failed to EncodeBegin (UtVideo)");
+		}
+		static std::atomic<int> seq(0);
+		writePath = StringFormat(_T("%s.%d-%d.tmp"), path, (int)GetCurrentProcessId(), seq++);
+		file = std::unique_ptr<LosslessVideoFile>(new LosslessVideoFile(ctx, writePath, _T("wb")));
+		file->writeHeader(width, height, numFrames, extra);
+		writeStarted = true;
+	}
+
+	// StartWrite()ŏ݂n߂iIςȂj
+	bool IsWriting() const { return writeStarted; }
+
+	// ݍς݃t[
+	int GetNumWritten() {
+		std::lock_guard<std::mutex> guard(mutex);
+		return nextWrite;
+	}
+
+	// ݂͕K擪珇Ԃ
+	void WriteFrame(const PVideoFrame& frame) {
+		std::lock_guard<std::mutex> guard(mutex);
+		FrameHeader hdr = FrameHeader();
+		hdr.refFrame = -1;
+		hdr.frameType = frame->GetProperty("FrameType", 0);
+
+		buffer.resize(sizeof(hdr) + codec->EncodeGetOutputSize(UTVF_YV12, width, height));
+		CopyYV12(rawFrame.data(), const_cast<PVideoFrame&>(frame), width, height);
+		bool keyFrame = false;
+		hdr.codedSize = (int)codec->EncodeFrame(buffer.data() + sizeof(hdr), &keyFrame, rawFrame.data());
+		buffer.resize(sizeof(hdr) + hdr.codedSize);
+
+		PVideoFrame qp = frame->GetProperty("QP_Table", PVideoFrame());
+		if (qp) {
+			hdr.qpWidth = qp->GetRowSize();
+			hdr.qpHeight = qp->GetHeight();
+			hdr.qpStride = frame->GetProperty("QP_Stride", 0);
+			hdr.qpScaleType = frame->GetProperty("QP_ScaleType", 0);
+			PutPlane(buffer, qp, hdr.qpWidth, hdr.qpHeight);
+		}
+		PVideoFrame nonB = frame->GetProperty("QP_Table_Non_B", PVideoFrame());
+		if (nonB) {
+			hdr.nonBWidth = nonB->GetRowSize();
+			hdr.nonBHeight = nonB->GetHeight();
+			PutPlane(buffer, nonB, hdr.nonBWidth, hdr.nonBHeight);
+		}
+		WriteEntry(hdr);
+	}
+
+	// fR[hłȂt[͒ut[QƂ邾
+	void WriteRef(int refFrame) {
+		std::lock_guard<std::mutex> guard(mutex);
+		FrameHeader hdr = FrameHeader();
+		hdr.refFrame = refFrame;
+		buffer.resize(sizeof(hdr));
+		WriteEntry(hdr);
+	}
+
+	PVideoFrame ReadFrame(int n, const VideoInfo& vi, bool outputQP, IScriptEnvironment* env) {
+		std::lock_guard<std::mutex> guard(mutex);
+		for (int i = 0; ; ++i) {
+			buffer.resize(file->getFrameSize(n));
+			file->readFrame(n, buffer.data());
+			int refFrame = ((const FrameHeader*)buffer.data())->refFrame;
+			if (refFrame < 0) {
+				break;
+			}
+			if (i > 0) {
+				THROW(FormatException, "[AMTSource] fR[hς݃t[t@CĂ܂");
+			}
+			n = refFrame;
+		}
+		FrameHeader hdr = *(const FrameHeader*)buffer.data();
+		const uint8_t* data = buffer.data() + sizeof(hdr);
+		if (codec->DecodeFrame(rawFrame.data(), data) != rawFrame.size()) {
+			THROW(RuntimeException, "failed to DecodeFrame (UtVideo)");
+		}
+		data += hdr.codedSize;
+
+		PVideoFrame ret = env->NewVideoFrame(vi);
+		CopyYV12(ret, rawFrame.data(), width, height);
+		ret->SetProperty("FrameType", hdr.frameType);
+		if (outputQP && hdr.qpWidth > 0) {
+			PVideoFrame qp = GetPlane(data, hdr.qpWidth, hdr.qpHeight, env);
+			data += hdr.qpWidth * hdr.qpHeight;
+			ret->SetProperty("QP_Table", qp);
+			if (hdr.nonBWidth > 0) {
+				PVideoFrame nonB = GetPlane(data, hdr.nonBWidth, hdr.nonBHeight, env);
+				ret->SetProperty("QP_Table_Non_B", nonB);
+			}
+			ret->SetProperty("QP_Stride", hdr.qpStride);
+			ret->SetProperty("QP_ScaleType", hdr.qpScaleType);
+		}
+		return ret;
+	}
+};
+
+// AMTSourcẽLbVv
+struct AMTSourceCacheStats {
+	int64_t hit;      // LbVɂ
+	int64_t miss;     // fR[hKvifR[h̃t[҂ꍇ܂ށj
+	int64_t seek;     // av_seek_framẻ
+	int64_t prefetch; // ǂ݂GOP
+	int64_t evict;    // LbV폜GOP
+	int64_t storeRead;    // fR[hς݃t[t@Cǂ񂾃t[
+	int64_t seekFlush;    // tbVōς񂾃V[N
+	int64_t seekReset;    // fR[_蒼V[NitH[}bgύX⎸s̃gCj
+	int64_t graphRebuild; // tbVɃtB^Ot蒼
+	double seekTime;      // V[NS[܂ŃfR[ĥɂԂ̍vibj
+	double seekTimeMax;   // V ő
+};
+
 class AMTSource : public IClip, AMTObject
 {
 	const std::vector<FilterSourceFrame>& frames;
@@ -50,19 +461,145 @@ class AMTSource : public IClip, AMTObject
 
 	bool outputQP; // QPe[uo͂邩
 
-	InputContext inputCtx;
-	CodecContext codecCtx;
-
-	FilterGraph filterGraph;
-	AVFilterContext* bufferSrcCtx;
-	AVFilterContext* bufferSinkCtx;
+	tstring srcpath;
+
+	// ͂tB^܂łƗɎfR[_
+	// ɗNGXg͕ʁX̃fR[_œɃfR[h
+	struct Decoder {
+		// z[hȂTS璼ړǂށiʏnullptrj
+		std::unique_ptr<VirtualPsReader> virtualReader;
+		InputContext inputCtx;
+		CodecContext codecCtx;
+
+		FilterGraph filterGraph;
+		AVFilterContext* bufferSrcCtx;
+		AVFilterContext* bufferSinkCtx;
+
+		AVStream *videoStream;
+
+		// OnFrameDecodedŒOɃfR[hꂽt[
+		// ܂fR[hĂȂꍇ-1
+		int lastDecodeFrame;
+
+		// codecCtxOɃfR[ht[
+		// ܂fR[hĂȂꍇnullptr
+		std::unique_ptr<Frame> prevFrame;
+
+		// Onon Bt[iQPe[upj
+		std::shared_ptr<Frame> nonBFrame;
+
+		// fR[hifR[hȂdecodeBegindecodeGoal܂łfR[hĂj
+		bool busy;
+		int decodeBegin;
+		int decodeGoal;
+
+		// ŌɎgԁi󂢂ĂfR[_Ȃꍇ͈ԌÂ̂gj
+		int64_t lastUsed;
+
+		// R[fbNĂŏɃfR[ht[̃tH[}bgi܂̏ꍇ-1j
+		// OɃfR[ht[ƈĂrSD/HDȂǂ؂ւĂ̂
+		// tbVł͍ς܂Ȃ
+		int codecWidth;
+		int codecHeight;
+		int codecFormat;
+		int lastWidth;
+		int lastHeight;
+		int lastFormat;
+
+		// tB^OtƂ̓̓tH[}bg
+		int graphWidth;
+		int graphHeight;
+		int graphPixFmt;
+		// tB^̒xiŏ̏o͂܂łɓꂽt[-1j܂Ȃꍇ-1
+		int graphDelay;
+		int graphInputs;
+		// I[ꂽiꂽgȂj
+		bool graphEOF;
+
+		// tB^OttbVɎg񂵂Ăꍇ
+		// V[NÕt[̉e󂯂o͂̂Ă
+		bool graphFlushed;
+		int flushInputs;
+		int64_t acceptPts; // Ȍo͎͂̂Ă
+		int64_t fedPts;    // V[Nɓꂽt[̍őPTSȉo͂̓V[NỐj
+
+		Decoder(AMTContext& ctx, const tstring& srcpath)
+			: virtualReader(VirtualPsIndex::IsIndexFile(srcpath) ? new VirtualPsReader(ctx, srcpath) : nullptr)
+			, inputCtx(srcpath, virtualReader.get(), virtualReader ? "mpeg" : nullptr)
+			, bufferSrcCtx()
+			, bufferSinkCtx()
+			, videoStream()
+			, lastDecodeFrame(-1)
+			, busy(false)
+			, decodeBegin(-1)
+			, decodeGoal(-1)
+			, lastUsed(0)
+			, codecWidth(-1)
+			, codecHeight(-1)
+			, codecFormat(-1)
+			, lastWidth(-1)
+			, lastHeight(-1)
+			, lastFormat(-1)
+			, graphWidth(0)
+			, graphHeight(0)
+			, graphPixFmt(-1)
+			, graphDelay(-1)
+			, graphInputs(0)
+			, graphEOF(false)
+			, graphFlushed(false)
+			, flushInputs(0)
+			, acceptPts(0)
+			, fedPts(0)
+		{ }
+	};
 
-	AVStream *videoStream;
+	std::vector<std::unique_ptr<Decoder>> decoders;
+	int maxDecoders;
+	int64_t useCounter;
+	std::condition_variable decoderFree;
 
 	std::unique_ptr<AMTSourceData> storage;
 
+	// fR[hς݃t[̕ۑt@CigȂꍇnullptrj
+	std::unique_ptr<DecodedFrameStore> frameStore;
+	// ۑt@Cɏt[iUtVideõGR[h͏d̂mutex̊Oŏj
+	struct StoreEntry {
+		PVideoFrame frame; // nullȂrefFrameQ
+		int refFrame;
+	};
+	std::deque<StoreEntry> storeQueue;
+	int storeQueued;   // L[ɓꂽt[
+	bool storeWriting; // ǂꂩ̃XbhL[Ă
+
+	// GOPǂ݃Xbh
+	class PrefetchThread : public DataPumpThread<int> {
+	public:
+		PrefetchThread(AMTSource* this_)
+			: DataPumpThread(8)
+			, this_(this_)
+		{ }
+	protected:
+		virtual void OnDataReceived(int&& gopBegin) {
+			this_->PrefetchGop(gopBegin);
+		}
+	private:
+		AMTSource* this_;
+	};
+
+	// ǂ݃XbhŃfR[ht[
+	// ǂ݃XbhłenvgȂ̂AVFramê܂܎ĂāA
+	// vXbhenvPVideoFrameɂ
+	struct RawFrame {
+		Frame top;
+		Frame bottom;
+		std::shared_ptr<Frame> nonB;
+		RawFrame(const Frame& top, const Frame& bottom, const std::shared_ptr<Frame>& nonB)
+			: top(top), bottom(bottom), nonB(nonB) { }
+	};
+
 	struct CacheFrame {
 		PVideoFrame data;
+		std::shared_ptr<RawFrame> raw; // nullptrłȂdata͂܂ĂȂ
 		TreeNode<int, CacheFrame*> treeNode;
 		ListNode<CacheFrame*> listNode;
 	};
@@ -75,22 +612,40 @@ class AMTSource : public IClip, AMTObject
 
 	VideoInfo vi;
 
+	// frameCache, recentAccessed, failedMap, seekDistance, decodersی
 	std::mutex mutex;
 
+	std::mutex audioMutex;
 	File waveFile;
 
 	int seekDistance;
 
-	// OnFrameDecodedŒOɃfR[hꂽt[
-	// ܂fR[hĂȂꍇ-1
-	int lastDecodeFrame;
-
-	// codecCtxOɃfR[ht[ԍ
-	// ܂fR[hĂȂꍇnullptr
-	std::unique_ptr<Frame> prevFrame;
-
-	// Onon B QPe[u
-	PVideoFrame nonBQPTable;
+	// LbV̓t[ł͂ȂʂŐ
+	size_t cacheBudget; // oCgi0ȂGOP猈߂j
+	size_t frameBytes;  // 1t[̃oCg
+
+	// ߂̃NGXgiANZX̕Ɣ͈͂\j
+	std::deque<int> recentRequests;
+	int accessDir;    // 1:O -1: 0:s
+	int accessRadius; // ߂̃NGXgSǂꂾU΂Ă邩
+
+	// ǂ݁iprefetchPending̓L[ɓĂGOP̐擪t[j
+	std::unique_ptr<PrefetchThread> prefetchThread;
+	std::set<int> prefetchPending;
+	bool prefetchCanceled;
+	// ǂ݃XbhŔG[iGetFrameœj
+	std::string prefetchError;
+
+	AMTSourceCacheStats stats;
+
+	// ǂ݃XbhłenvgȂinullptrĵŕʂ̗Oɂ
+	template <typename... Args>
+	void ThrowError(IScriptEnvironment* env, const char* fmt, const Args& ... args) {
+		if (env != nullptr) {
+			env->ThrowError(fmt, args...);
+		}
+		THROWF(RuntimeException, "%s", StringFormat(fmt, args...));
+	}
 
 	AVCodec* getHWAccelCodec(AVCodecID vcodecId)
 	{
@@ -123,67 +678,70 @@ class AMTSource : public IClip, AMTObject
 		return avcodec_find_decoder(vcodecId);
 	}
 
-	void MakeCodecContext(IScriptEnvironment* env) {
-		AVCodecID vcodecId = videoStream->codecpar->codec_id;
+	void MakeCodecContext(Decoder& dec, IScriptEnvironment* env) {
+		AVCodecID vcodecId = dec.videoStream->codecpar->codec_id;
 		AVCodec *pCodec = getHWAccelCodec(vcodecId);
 		if (pCodec == NULL) {
 			ctx.warn("w肳ꂽfR[_gpłȂ߃ftHgfR[_g܂");
 			pCodec = avcodec_find_decoder(vcodecId);
 		}
 		if (pCodec == NULL) {
-			env->ThrowError("Could not find decoder ...");
+			ThrowError(env, "Could not find decoder ...");
 		}
-		codecCtx.Set(pCodec);
-		if (avcodec_parameters_to_context(codecCtx(), videoStream->codecpar) != 0) {
-			env->ThrowError("avcodec_parameters_to_context failed");
+		dec.codecCtx.Set(pCodec);
+		if (avcodec_parameters_to_context(dec.codecCtx(), dec.videoStream->codecpar) != 0) {
+			ThrowError(env, "avcodec_parameters_to_context failed");
 		}
-		codecCtx()->thread_count = GetFFmpegThreads(GetProcessorCount());
+		dec.codecCtx()->thread_count = GetFFmpegThreads(GetProcessorCount());
 
 		// export_mvs for codecview
 		//AVDictionary *opts = NULL;
 		//av_dict_set(&opts, "flags2", "+export_mvs", 0);
 		
-		if (avcodec_open2(codecCtx(), pCodec, NULL) != 0) {
-			env->ThrowError("avcodec_open2 failed");
+		if (avcodec_open2(dec.codecCtx(), pCodec, NULL) != 0) {
+			ThrowError(env, "avcodec_open2 failed");
 		}
+
+		dec.codecWidth = dec.codecHeight = dec.codecFormat = -1;
+		dec.lastWidth = dec.lastHeight = dec.lastFormat = -1;
 	}
 
-	void MakeFilterGraph(IScriptEnvironment* env) {
+	void MakeFilterGraph(Decoder& dec, IScriptEnvironment* env) {
 		char args[512];
 		const AVFilter *buffersrc = avfilter_get_by_name("buffer");
 		const AVFilter *buffersink = avfilter_get_by_name("buffersink");
 		FilterInOut outputs;
 		FilterInOut inputs;
-		AVRational time_base = videoStream->time_base;
+		AVRational time_base = dec.videoStream->time_base;
 
-		filterGraph.Create();
-		bufferSrcCtx = nullptr;
-		bufferSinkCtx = nullptr;
+		dec.filterGraph.Create();
+		dec.bufferSrcCtx = nullptr;
+		dec.bufferSinkCtx = nullptr;
 
-		filterGraph()->nb_threads = 4;
+		dec.filterGraph()->nb_threads = 4;
 
 		/* buffer video source: the decoded frames from the decoder will be inserted here. */
 		snprintf(args, sizeof(args),
 			"video_size=%dx%d:pix_fmt=%d:time_base=%d/%d:pixel_aspect=%d/%d",
-			codecCtx()->width, codecCtx()->height, codecCtx()->pix_fmt,
+			dec.codecCtx()->width, dec.codecCtx()->height, dec.codecCtx()->pix_fmt,
 			time_base.num, time_base.den,
-			codecCtx()->sample_aspect_ratio.num, codecCtx()->sample_aspect_ratio.den);
+			dec.codecCtx()->sample_aspect_ratio.num, dec.codecCtx()->sample_aspect_ratio.den);
 
-		if (avfilter_graph_create_filter(&bufferSrcCtx, buffersrc, "in",
-			args, NULL, filterGraph()) < 0) {
-			env->ThrowError("avfilter_graph_create_filter failed (Cannot create buffer source)");
+		if (avfilter_graph_create_filter(&dec.bufferSrcCtx, buffersrc, "in",
+			args, NULL, dec.filterGraph()) < 0) {
+			ThrowError(env, "avfilter_graph_create_filter failed (Cannot create buffer source)");
 		}
 
 		/* buffer video sink: to terminate the filter chain. */
-		if (avfilter_graph_create_filter(&bufferSinkCtx, buffersink, "out",
-			NULL, NULL, filterGraph()) < 0) {
-			env->ThrowError("avfilter_graph_create_filter failed (Cannot create buffer sink)");
+		if (avfilter_graph_create_filter(&dec.bufferSinkCtx, buffersink, "out",
+			NULL, NULL, dec.filterGraph()) < 0) {
+			ThrowError(env, "avfilter_graph_create_filter failed (Cannot create buffer sink)");
 		}
 
-		if (av_opt_set_bin(bufferSinkCtx, "pix_fmts",
-			(uint8_t*)&codecCtx()->pix_fmt, sizeof(codecCtx()->pix_fmt),
+		if (av_opt_set_bin(dec.bufferSinkCtx, "pix_fmts",
+			(uint8_t*)&dec.codecCtx()->pix_fmt, sizeof(dec.codecCtx()->pix_fmt),
 			AV_OPT_SEARCH_CHILDREN) < 0) {
-			env->ThrowError("av_opt_set_bin failed (cannot set output pixel format)");
+			ThrowError(env, "av_opt_set_bin failed (cannot set output pixel format)");
 		}
 
 		/*
@@ -198,7 +756,7 @@ class AMTSource : public IClip, AMTObject
 		* default.
 		*/
 		outputs()->name = av_strdup("in");
-		outputs()->filter_ctx = bufferSrcCtx;
+		outputs()->filter_ctx = dec.bufferSrcCtx;
 		outputs()->pad_idx = 0;
 		outputs()->next = NULL;
 
@@ -209,18 +767,26 @@ class AMTSource : public IClip, AMTObject
 		* default.
 		*/
 		inputs()->name = av_strdup("out");
-		inputs()->filter_ctx = bufferSinkCtx;
+		inputs()->filter_ctx = dec.bufferSinkCtx;
 		inputs()->pad_idx = 0;
 		inputs()->next = NULL;
 
-		if (avfilter_graph_parse_ptr(filterGraph(), filterdesc.c_str(),
+		if (avfilter_graph_parse_ptr(dec.filterGraph(), filterdesc.c_str(),
 			&inputs(), &outputs(), NULL) < 0) {
-			env->ThrowError("avfilter_graph_parse_ptr failed");
+			ThrowError(env, "avfilter_graph_parse_ptr failed");
 		}
 
-		if (avfilter_graph_config(filterGraph(), NULL) < 0) {
-			env->ThrowError("avfilter_graph_config failed");
+		if (avfilter_graph_config(dec.filterGraph(), NULL) < 0) {
+			ThrowError(env, "avfilter_graph_config failed");
 		}
+
+		dec.graphWidth = dec.codecCtx()->width;
+		dec.graphHeight = dec.codecCtx()->height;
+		dec.graphPixFmt = dec.codecCtx()->pix_fmt;
+		dec.graphDelay = -1;
+		dec.graphInputs = 0;
+		dec.graphEOF = false;
+		dec.graphFlushed = false;
 	}
 
 	void MakeVideoInfo(const VideoFormat& vfmt, const AudioFormat& afmt) {
@@ -253,32 +819,86 @@ class AMTSource : public IClip, AMTObject
 		}
 	}
 
-	void UpdateVideoInfo(IScriptEnvironment* env)
+	void UpdateVideoInfo(Decoder& dec, IScriptEnvironment* env)
 	{
 		// rbg[x͎擾ĂȂ̂ffmpeg擾
-		vi.pixel_type = toAVSFormat(codecCtx()->pix_fmt, env);
+		vi.pixel_type = toAVSFormat(dec.codecCtx()->pix_fmt, env);
 
-		if (bufferSinkCtx) {
+		if (dec.bufferSinkCtx) {
 			// tB^΃tB^̏o͂ɍXV
-			const AVFilterLink* outlink = bufferSinkCtx->inputs[0];
+			const AVFilterLink* outlink = dec.bufferSinkCtx->inputs[0];
 			vi.pixel_type = toAVSFormat((AVPixelFormat)outlink->format, env);
 
 			if (outlink->w != vi.width ||
 				outlink->h != vi.height) {
-				env->ThrowError("ffmpeg filter output is resized, which is not supported on current AMTSource.");
+				ThrowError(env, "ffmpeg filter output is resized, which is not supported on current AMTSource.");
 			}
 		}
 	}
 
-	void ResetDecoder(IScriptEnvironment* env) {
-		lastDecodeFrame = -1;
-		prevFrame = nullptr;
-		MakeCodecContext(env);
+	void ResetDecoder(Decoder& dec, IScriptEnvironment* env) {
+		dec.lastDecodeFrame = -1;
+		dec.prevFrame = nullptr;
+		MakeCodecContext(dec, env);
 		if (filterdesc.size()) {
-			MakeFilterGraph(env);
+			MakeFilterGraph(dec, env);
 		}
 	}
 
+	// V[ÑfR[_
+	// Xg[̃p[^ςĂȂ΃R[fbN̓tbVōς܂
+	// tB^Ot̓tH[}bgȂ炻̂܂܎g
+	// ȉꍇAŏgraphDelayt[̓V[NÕt[̉e󂯂̂Ŏ̂Ăj
+	// fR[_蒼ꍇfalse
+	bool FlushDecoder(Decoder& dec, int keyNum, int n, IScriptEnvironment* env) {
+		if (dec.lastWidth != dec.codecWidth ||
+			dec.lastHeight != dec.codecHeight ||
+			dec.lastFormat != dec.codecFormat)
+		{
+			ResetDecoder(dec, env);
+			return false;
+		}
+
+		avcodec_flush_buffers(dec.codecCtx());
+		dec.lastDecodeFrame = -1;
+		dec.prevFrame = nullptr;
+
+		if (dec.bufferSrcCtx) {
+			if (dec.graphEOF || dec.graphDelay < 0 ||
+				dec.codecCtx()->width != dec.graphWidth ||
+				dec.codecCtx()->height != dec.graphHeight ||
+				dec.codecCtx()->pix_fmt != dec.graphPixFmt ||
+				n - keyNum < dec.graphDelay)
+			{
+				// g񂹂Ȃ̂ŃtB^Ot蒼
+				MakeFilterGraph(dec, env);
+				std::lock_guard<std::mutex> guard(mutex);
+				++stats.graphRebuild;
+			}
+			else {
+				dec.graphFlushed = true;
+				dec.flushInputs = 0;
+				dec.acceptPts = 0;
+				dec.fedPts = 0;
+			}
+		}
+		return true;
+	}
+
+	// VfR[_
+	std::unique_ptr<Decoder> CreateDecoder(IScriptEnvironment* env) {
+		auto dec = std::unique_ptr<Decoder>(new Decoder(ctx, srcpath));
+		if (avformat_find_stream_info(dec->inputCtx(), NULL) < 0) {
+			ThrowError(env, "avformat_find_stream_info failed");
+		}
+		dec->videoStream = GetVideoStream(dec->inputCtx());
+		if (dec->videoStream == NULL) {
+			ThrowError(env, "Could not find video stream ...");
+		}
+		ResetDecoder(*dec, env);
+		return dec;
+	}
+
 	template <typename T>
 	void Copy1(T* dst, const T* top, const T* bottom, int w, int h, int dpitch, int tpitch, int bpitch)
 	{
@@ -345,7 +965,29 @@ class AMTSource : public IClip, AMTObject
 		}
 	}
 
-	PVideoFrame MakeFrame(AVFrame* top, AVFrame* bottom, IScriptEnvironment* env) {
+	// QPe[uiȂnullptrj
+	PVideoFrame MakeQPTable(AVFrame* frame, int& qp_stride, int& qp_scale_type, IScriptEnvironment* env) {
+		const int8_t* qp_table = av_frame_get_qp_table(frame, &qp_stride, &qp_scale_type);
+		if (qp_table == nullptr) {
+			return PVideoFrame();
+		}
+		VideoInfo qpvi = vi;
+		if (!qp_stride) {
+			qpvi.width = (vi.width + 15) >> 4;
+			qpvi.height = 1;
+		}
+		else {
+			qpvi.width = qp_stride;
+			qpvi.height = (vi.height + 15) >> 4;
+		}
+		qpvi.pixel_type = VideoInfo::CS_Y8;
+		PVideoFrame qpframe = env->NewVideoFrame(qpvi);
+		env->BitBlt(qpframe->GetWritePtr(), qpframe->GetPitch(), (const BYTE*)qp_table, qpvi.width, qpvi.width, qpvi.height);
+		return qpframe;
+	}
+
+	// nonB͒Onon Bt[iȂnullptrj
+	PVideoFrame MakeFrame(AVFrame* top, AVFrame* bottom, AVFrame* nonB, IScriptEnvironment* env) {
 		PVideoFrame ret = env->NewVideoFrame(vi);
 		const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get((AVPixelFormat)(top->format));
 
@@ -362,25 +1004,16 @@ class AMTSource : public IClip, AMTObject
 		// QPe[u
 		if (outputQP) {
 			int qp_stride, qp_scale_type;
-			const int8_t* qp_table = av_frame_get_qp_table(top, &qp_stride, &qp_scale_type);
-			if (qp_table) {
-				VideoInfo qpvi = vi;
-				if (!qp_stride) {
-					qpvi.width = (vi.width + 15) >> 4;
-					qpvi.height = 1;
-				}
-				else {
-					qpvi.width = qp_stride;
-					qpvi.height = (vi.height + 15) >> 4;
-				}
-				qpvi.pixel_type = VideoInfo::CS_Y8;
-				PVideoFrame qpframe = env->NewVideoFrame(qpvi);
-				env->BitBlt(qpframe->GetWritePtr(), qpframe->GetPitch(), (const BYTE*)qp_table, qpvi.width, qpvi.width, qpvi.height);
-				if (top->pict_type != AV_PICTURE_TYPE_B) {
-					nonBQPTable = qpframe;
+			PVideoFrame qpframe = MakeQPTable(top, qp_stride, qp_scale_type, env);
+			if (qpframe) {
+				PVideoFrame nonBTable = qpframe;
+				if (top->pict_type == AV_PICTURE_TYPE_B) {
+					int nonBStride, nonBScaleType;
+					nonBTable = (nonB != nullptr) ?
+						MakeQPTable(nonB, nonBStride, nonBScaleType, env) : PVideoFrame();
 				}
 				ret->SetProperty("QP_Table", qpframe);
-				ret->SetProperty("QP_Table_Non_B", nonBQPTable);
+				ret->SetProperty("QP_Table_Non_B", nonBTable);
 				ret->SetProperty("QP_Stride", qp_stride ? qpframe->GetPitch() : 0);
 				ret->SetProperty("QP_ScaleType", qp_scale_type);
 			}
@@ -389,21 +1022,292 @@ class AMTSource : public IClip, AMTObject
 		return ret;
 	}
 
-	void PutFrame(int n, const PVideoFrame& frame) {
+	// fR[ht[LbVɓ
+	// ǂ݃XbhienvnullptrjłAVFramê܂ܓ
+	void OutputFrame(Decoder& dec, int n, Frame& top, Frame& bottom, IScriptEnvironment* env) {
+		if (outputQP && top()->pict_type != AV_PICTURE_TYPE_B) {
+			int qp_stride, qp_scale_type;
+			if (av_frame_get_qp_table(top(), &qp_stride, &qp_scale_type) != nullptr) {
+				dec.nonBFrame = std::make_shared<Frame>(top);
+			}
+		}
+		if (env == nullptr) {
+			PutFrame(n, PVideoFrame(), std::make_shared<RawFrame>(top, bottom, dec.nonBFrame));
+		}
+		else {
+			PutFrame(n, MakeFrame(top(), bottom(), dec.nonBFrame ? (*dec.nonBFrame)() : nullptr, env));
+		}
+	}
+
+	// ʂ̃fR[_łɓĂ牽Ȃ
+	void PutFrame(int n, const PVideoFrame& frame, const std::shared_ptr<RawFrame>& raw = nullptr) {
+		std::unique_lock<std::mutex> lock(mutex);
+		if (frameCache.find(n) != frameCache.end()) {
+			return;
+		}
 		CacheFrame* pcache = new CacheFrame();
 		pcache->data = frame;
+		pcache->raw = raw;
 		pcache->treeNode.key = n;
 		pcache->treeNode.value = pcache;
 		pcache->listNode.value = pcache;
 		frameCache.insert(&pcache->treeNode);
 		recentAccessed.push_front(&pcache->listNode);
 
-		if ((int)recentAccessed.size() > seekDistance * 3 / 2) {
-			// LbVꂽ폜
-			CacheFrame* pdel = recentAccessed.back().value;
-			frameCache.erase(frameCache.it(&pdel->treeNode));
-			recentAccessed.erase(recentAccessed.it(&pdel->listNode));
-			delete pdel;
+		QueueFrameStore();
+		EvictCache(n);
+		WriteFrameStore(lock);
+	}
+
+	// ۑt@CɎ̃t[珇ɏ邾L[ɓimutexԂŌĂԁj
+	void QueueFrameStore() {
+		if (frameStore == nullptr || !frameStore->IsWriting()) {
+			return;
+		}
+		while (storeQueued < (int)frames.size()) {
+			int n = storeQueued;
+			StoreEntry entry = StoreEntry();
+			entry.refFrame = -1;
+			auto it = frameCache.find(n);
+			if (it != frameCache.end()) {
+				if (it->value->raw != nullptr) {
+					// ǂ݂t[PVideoFrameɂȂĂ珑
+					break;
+				}
+				entry.frame = it->value->data;
+			}
+			else {
+				auto failed = failedMap.find(n);
+				if (failed == failedMap.end()) {
+					break;
+				}
+				entry.refFrame = failed->second;
+			}
+			storeQueue.push_back(entry);
+			++storeQueued;
+		}
+	}
+
+	// L[ɓĂt[ۑt@Cɏ
+	// lockԂŌĂԂAGR[hlockO
+	// ̃XbhĂꍇ͂̃XbhɔCĂɖ߂
+	void WriteFrameStore(std::unique_lock<std::mutex>& lock) {
+		if (storeWriting) {
+			return;
+		}
+		storeWriting = true;
+		try {
+			while (storeQueue.size() > 0) {
+				StoreEntry entry = storeQueue.front();
+				storeQueue.pop_front();
+				lock.unlock();
+				if (entry.frame) {
+					frameStore->WriteFrame(entry.frame);
+				}
+				else {
+					frameStore->WriteRef(entry.refFrame);
+				}
+				lock.lock();
+			}
+		}
+		catch (...) {
+			if (!lock.owns_lock()) {
+				lock.lock();
+			}
+			storeWriting = false;
+			throw;
+		}
+		storeWriting = false;
+	}
+
+	// GOP͈̔ [begin,end)
+	void GetGopRange(int n, int& begin, int& end) {
+		begin = frames[n].keyFrame;
+		end = std::max(begin, n) + 1;
+		while (end < (int)frames.size() && frames[end].keyFrame == begin) {
+			++end;
+		}
+	}
+
+	int MaxCacheFrames() {
+		// ȂƂ1GOP+ANZX͈͎͂Ă悤ɂ
+		int minFrames = seekDistance * 2 + accessRadius * 2;
+		if (cacheBudget == 0) {
+			// TCYw肪ȂGOPƃfR[_i傫ȃLbVcachesizew莞̂݁j
+			return std::max(minFrames, seekDistance * 3 / 2 * (int)decoders.size());
+		}
+		return std::max(minFrames, (int)std::min<size_t>(INT_MAX, cacheBudget / frameBytes));
+	}
+
+	void DeleteCacheFrame(CacheFrame* pdel) {
+		frameCache.erase(frameCache.it(&pdel->treeNode));
+		recentAccessed.erase(recentAccessed.it(&pdel->listNode));
+		delete pdel;
+	}
+
+	// \ꂽANZX͈͂ɂĂ邩
+	bool IsInAccessWindow(int begin, int end) {
+		if (recentRequests.size() == 0) {
+			return false;
+		}
+		int last = recentRequests.back();
+		int lo = last - accessRadius;
+		int hi = last + accessRadius;
+		// iޕ1GOP]Ɏc
+		if (accessDir > 0) hi += seekDistance;
+		if (accessDir < 0) lo -= seekDistance;
+		return begin <= hi && lo < end;
+	}
+
+	// fR[h̃S[iԂOɏƍj
+	bool IsDecodeGoal(int begin, int end) {
+		for (auto& d : decoders) {
+			if (d->busy && begin <= d->decodeGoal && d->decodeGoal < end) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// LbVꂽԑOɃANZXꂽGOP܂邲ƍ폜
+	// iGOP̈ꕔcĂĂǃV[NKvɂȂ邽߁j
+	// \ꂽANZX͈͂ɂGOP͌񂵂ɂ
+	void EvictCache(int keep) {
+		int maxFrames = MaxCacheFrames();
+		int tries = (int)recentAccessed.size();
+		while ((int)recentAccessed.size() > maxFrames) {
+			CacheFrame* victim = recentAccessed.back().value;
+			int victimFrame = victim->treeNode.key;
+			int gopBegin, gopEnd;
+			GetGopRange(victimFrame, gopBegin, gopEnd);
+			bool needed = (gopBegin <= keep && keep < gopEnd) || IsDecodeGoal(gopBegin, gopEnd);
+			if (tries > 0 && (needed || IsInAccessWindow(gopBegin, gopEnd))) {
+				// ܂ĝŌ
+				--tries;
+				UpdateAccessed(victim);
+				continue;
+			}
+			if (needed) {
+				// SgȂ̂Ńt[Pʂō폜
+				if (victimFrame == keep || IsDecodeGoal(victimFrame, victimFrame + 1)) {
+					// ͏Ȃ̂ňꎞIɒ߂
+					break;
+				}
+				DeleteCacheFrame(victim);
+				continue;
+			}
+			std::vector<CacheFrame*> dels;
+			for (auto it = frameCache.lower_bound(gopBegin); it != frameCache.end() && it->key < gopEnd; ++it) {
+				dels.push_back(it->value);
+			}
+			for (auto pdel : dels) {
+				DeleteCacheFrame(pdel);
+			}
+			++stats.evict;
+		}
+	}
+
+	// NGXgANZX̕Ɣ͈͂\
+	void RecordRequest(int n) {
+		recentRequests.push_back(n);
+		if (recentRequests.size() > 16) {
+			recentRequests.pop_front();
+		}
+		int num = (int)recentRequests.size();
+		if (num < 4) {
+			accessDir = 0;
+			accessRadius = 0;
+			return;
+		}
+		// Oƌ㔼̕ς̍ŕ߂
+		// iԕtB^͑OɐUȂiނ̂ŗדm̍ł͔łȂj
+		int64_t first = 0, second = 0;
+		for (int i = 0; i < num; ++i) {
+			((i < num / 2) ? first : second) += recentRequests[i];
+		}
+		int64_t diff = second * (num / 2) - first * (num - num / 2);
+		accessDir = (diff > 0) ? 1 : (diff < 0) ? -1 : 0;
+		int radius = 0;
+		for (int r : recentRequests) {
+			radius = std::max(radius, std::abs(r - n));
+		}
+		// єт̃ANZXŔ͈͂傫Ȃ肷Ȃ悤
+		accessRadius = std::min(radius, seekDistance * 4);
+	}
+
+	// iޕŎɕKvɂȂGOPǂ݃L[ɓimutexԂŌĂԁj
+	void SchedulePrefetch(int n) {
+		if (prefetchThread == nullptr || accessDir == 0 || prefetchPending.size() >= 2) {
+			return;
+		}
+		int target = n + accessDir * (accessRadius + 1);
+		// ͈͂̊OGOPɂ΂1
+		for (int i = 0; i < 2; ++i) {
+			if (target < 0 || target >= (int)frames.size()) {
+				return;
+			}
+			int gopBegin, gopEnd;
+			GetGopRange(target, gopBegin, gopEnd);
+			int goal = gopEnd - 1;
+			bool cached = frameCache.find(target) != frameCache.end() &&
+				frameCache.find(goal) != frameCache.end();
+			if (!cached) {
+				bool decoding = false;
+				for (auto& d : decoders) {
+					if (d->busy && d->decodeBegin <= goal && goal <= d->decodeGoal) {
+						decoding = true;
+					}
+				}
+				if (decoding || prefetchPending.count(gopBegin) ||
+					failedMap.find(goal) != failedMap.end())
+				{
+					return;
+				}
+				prefetchPending.insert(gopBegin);
+				int data = gopBegin;
+				prefetchThread->put(std::move(data), 1);
+				return;
+			}
+			target = (accessDir > 0) ? gopEnd : gopBegin - 1;
+		}
+	}
+
+	// ǂ݃XbhĂ΂
+	// ̃XbhłenvgȂ̂nullptrŌĂԁit[AVFramê܂܃LbVɓj
+	void PrefetchGop(int gopBegin) {
+		try {
+			std::unique_lock<std::mutex> lock(mutex);
+			prefetchPending.erase(gopBegin);
+			if (prefetchCanceled) {
+				return;
+			}
+			int begin, end;
+			GetGopRange(gopBegin, begin, end);
+			int goal = end - 1;
+			if (frameCache.find(goal) != frameCache.end()) {
+				return;
+			}
+			for (auto& d : decoders) {
+				if (d->busy && d->decodeBegin <= goal && goal <= d->decodeGoal) {
+					return;
+				}
+			}
+			Decoder* pdec = SelectDecoder(goal, nullptr);
+			if (pdec == nullptr) {
+				// 󂢂ĂfR[_Ȃΐǂ݂͂Ȃ
+				return;
+			}
+			++stats.prefetch;
+			RunDecoder(*pdec, goal, lock, nullptr);
+		}
+		catch (const Exception& e) {
+			// vXbhœ
+			std::lock_guard<std::mutex> guard(mutex);
+			prefetchError = e.message();
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> guard(mutex);
+			prefetchError = "[AMTSource] ǂݒɕsȃG[܂";
 		}
 	}
 
@@ -422,47 +1326,84 @@ class AMTSource : public IClip, AMTObject
 			return VideoInfo::CS_YUV420P12;
 			break;
 		}
-		env->ThrowError("ΉĂȂrbg[xł");
+		ThrowError(env, "ΉĂȂrbg[xł");
 		return 0;
 	}
 
-	void InputFrameFilter(Frame* frame, bool enableOut, IScriptEnvironment* env)
+	// 33bitŃbvPTS̍ia - bj
+	static int64_t PtsDiff(int64_t a, int64_t b) {
+		const int64_t wrap = int64_t(1) << 33;
+		int64_t diff = (a - b) & (wrap - 1);
+		return (diff >= (wrap >> 1)) ? (diff - wrap) : diff;
+	}
+
+	void InputFrameFilter(Decoder& dec, Frame* frame, bool enableOut, IScriptEnvironment* env)
 	{
+		if (frame != nullptr) {
+			++dec.graphInputs;
+			if (dec.graphFlushed) {
+				int64_t pts = (*frame)()->pts & ((int64_t(1) << 33) - 1);
+				if (dec.flushInputs == dec.graphDelay) {
+					dec.acceptPts = pts;
+				}
+				if (dec.flushInputs == 0 || PtsDiff(pts, dec.fedPts) > 0) {
+					dec.fedPts = pts;
+				}
+				++dec.flushInputs;
+			}
+		}
+		else {
+			dec.graphEOF = true;
+		}
+
 		/* push the decoded frame into the filtergraph */
-		if (av_buffersrc_add_frame_flags(bufferSrcCtx, frame ? (*frame)() : nullptr, 0) < 0) {
-			env->ThrowError("av_buffersrc_add_frame_flags failed (Error while feeding the filtergraph)");
+		if (av_buffersrc_add_frame_flags(dec.bufferSrcCtx, frame ? (*frame)() : nullptr, 0) < 0) {
+			ThrowError(env, "av_buffersrc_add_frame_flags failed (Error while feeding the filtergraph)");
 		}
 
 		/* pull filtered frames from the filtergraph */
 		while (1) {
 			Frame filtered;
-			int ret = av_buffersink_get_frame(bufferSinkCtx, filtered());
+			int ret = av_buffersink_get_frame(dec.bufferSinkCtx, filtered());
 			if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
 				// Ɠ͂Kv or t[Ȃ
 				break;
 			}
 			if (ret < 0) {
-				env->ThrowError("av_buffersink_get_frame failed");
+				ThrowError(env, "av_buffersink_get_frame failed");
+			}
+			if (dec.graphDelay < 0) {
+				dec.graphDelay = dec.graphInputs - 1;
+			}
+			if (dec.graphFlushed) {
+				int64_t pts = filtered()->pts & ((int64_t(1) << 33) - 1);
+				if (dec.flushInputs <= dec.graphDelay ||
+					PtsDiff(pts, dec.acceptPts) < 0 || PtsDiff(pts, dec.fedPts) > 0) {
+					// V[NÕt[Ă
+					continue;
+				}
+				// V[Ñt[oĂ͂V[NÕt[͏oĂȂ
+				dec.graphFlushed = false;
 			}
 			if (enableOut) {
-				OnFrameOutput(filtered, env);
+				OnFrameOutput(dec, filtered, env);
 			}
 		}
 	}
 
-	void OnFrameDecoded(Frame& frame, IScriptEnvironment* env)
+	void OnFrameDecoded(Decoder& dec, Frame& frame, IScriptEnvironment* env)
 	{
-		if (bufferSrcCtx) {
+		if (dec.bufferSrcCtx) {
 			// tB^
 			//frame()->pts = frame()->best_effort_timestamp;
-			InputFrameFilter(&frame, true, env);
+			InputFrameFilter(dec, &frame, true, env);
 		}
 		else {
-			OnFrameOutput(frame, env);
+			OnFrameOutput(dec, frame, env);
 		}
 	}
 
-	void OnFrameOutput(Frame& frame, IScriptEnvironment* env)
+	void OnFrameOutput(Decoder& dec, Frame& frame, IScriptEnvironment* env)
 	{
 		// ffmpegpts wrap̎dȂ̂ŉ33bit݂̂
 		//i26Ԉȏ゠铮悾Əd\͂邪j
@@ -487,9 +1428,9 @@ class AMTSource : public IClip, AMTObject
 			tailDiff = pts - frames.back().framePTS;
 			// Ỏ\̂ŁA
 			if (headDiff == 0 || headDiff > tailDiff) {
-				lastDecodeFrame = vi.num_frames;
+				dec.lastDecodeFrame = vi.num_frames;
 			}
-			prevFrame = nullptr; // AłȂȂꍇnullZbg
+			dec.prevFrame = nullptr; // AłȂȂꍇnullZbg
 			return;
 		}
 
@@ -497,23 +1438,21 @@ class AMTSource : public IClip, AMTObject
 			// vt[Ȃ
 			ctx.incrementCounter(AMT_ERR_UNKNOWN_PTS);
 			ctx.warnF("Unknown PTS frame %lld", pts);
-			prevFrame = nullptr; // AłȂȂꍇnullZbg
+			dec.prevFrame = nullptr; // AłȂȂꍇnullZbg
 			return;
 		}
 
 		int frameIndex = int(it - frames.begin());
-		auto cacheit = frameCache.find(frameIndex);
 
 		if (it->halfDelay) {
 			// fBCKp
-			if (cacheit != frameCache.end()) {
+			if (TouchCache(frameIndex)) {
 				// łɃLbVɂ
-				UpdateAccessed(cacheit->value);
-				lastDecodeFrame = frameIndex;
+				dec.lastDecodeFrame = frameIndex;
 			}
-			else if (prevFrame != nullptr) {
-				PutFrame(frameIndex, MakeFrame((*prevFrame)(), frame(), env));
-				lastDecodeFrame = frameIndex;
+			else if (dec.prevFrame != nullptr) {
+				OutputFrame(dec, frameIndex, *dec.prevFrame, frame, env);
+				dec.lastDecodeFrame = frameIndex;
 			}
 			else {
 				// Õt[Ȃ̂Ńt[Ȃ
@@ -522,30 +1461,21 @@ class AMTSource : public IClip, AMTObject
 			// ̃t[t[QƂĂ炻o
 			auto next = it + 1;
 			if (next != frames.end() && next->framePTS == it->framePTS) {
-				auto cachenext = frameCache.find(frameIndex + 1);
-				if (cachenext != frameCache.end()) {
-					// łɃLbVɂ
-					UpdateAccessed(cachenext->value);
+				if (!TouchCache(frameIndex + 1)) {
+					OutputFrame(dec, frameIndex + 1, frame, frame, env);
 				}
-				else {
-					PutFrame(frameIndex + 1, MakeFrame(frame(), frame(), env));
-				}
-				lastDecodeFrame = frameIndex + 1;
+				dec.lastDecodeFrame = frameIndex + 1;
 			}
 		}
 		else {
 			// ̂܂
-			if (cacheit != frameCache.end()) {
-				// łɃLbVɂ
-				UpdateAccessed(cacheit->value);
+			if (!TouchCache(frameIndex)) {
+				OutputFrame(dec, frameIndex, frame, frame, env);
 			}
-			else {
-				PutFrame(frameIndex, MakeFrame(frame(), frame(), env));
-			}
-			lastDecodeFrame = frameIndex;
+			dec.lastDecodeFrame = frameIndex;
 		}
 
-		prevFrame = std::unique_ptr<Frame>(new Frame(frame));
+		dec.prevFrame = std::unique_ptr<Frame>(new Frame(frame));
 	}
 
 	void UpdateAccessed(CacheFrame* frame) {
@@ -553,7 +1483,40 @@ class AMTSource : public IClip, AMTObject
 		recentAccessed.push_front(&frame->listNode);
 	}
 
-	PVideoFrame ForceGetFrame(int n, IScriptEnvironment* env) {
+	// LbVɂ΃ANZXXVtrue
+	bool TouchCache(int n) {
+		std::lock_guard<std::mutex> guard(mutex);
+		auto it = frameCache.find(n);
+		if (it == frameCache.end()) {
+			return false;
+		}
+		UpdateAccessed(it->value);
+		return true;
+	}
+
+	// LbṼt[ԂilockԂŌĂԁj
+	// ǂ݂t[͂ŗvXbhenvgPVideoFrameɂ
+	PVideoFrame GetCacheData(CacheFrame* pcache, std::unique_lock<std::mutex>& lock, IScriptEnvironment* env) {
+		if (pcache->raw == nullptr) {
+			return pcache->data;
+		}
+		int n = pcache->treeNode.key;
+		std::shared_ptr<RawFrame> raw = pcache->raw;
+		lock.unlock();
+		PVideoFrame frame = MakeFrame(raw->top(), raw->bottom(), raw->nonB ? (*raw->nonB)() : nullptr, env);
+		lock.lock();
+		// bNOĂԂɕϊ폜Ă邩Ȃ̂ŒT
+		auto it = frameCache.find(n);
+		if (it != frameCache.end() && it->value->raw == raw) {
+			it->value->data = frame;
+			it->value->raw = nullptr;
+			QueueFrameStore();
+			WriteFrameStore(lock);
+		}
+		return frame;
+	}
+
+	PVideoFrame ForceGetFrame(int n, std::unique_lock<std::mutex>& lock, IScriptEnvironment* env) {
 		if (frameCache.size() == 0) {
 			return env->NewVideoFrame(vi);
 		}
@@ -562,44 +1525,179 @@ class AMTSource : public IClip, AMTObject
 			--lb;
 		}
 		UpdateAccessed(lb->value);
-		return lb->value->data;
+		return GetCacheData(lb->value, lock, env);
 	}
 
-	void DecodeLoop(int goal, IScriptEnvironment* env) {
+	void DecodeLoop(Decoder& dec, int goal, IScriptEnvironment* env) {
 		Frame frame;
 		AVPacket packet = AVPacket();
-		while (av_read_frame(inputCtx(), &packet) == 0) {
-			if (packet.stream_index == videoStream->index) {
-				if (avcodec_send_packet(codecCtx(), &packet) != 0) {
+		while (av_read_frame(dec.inputCtx(), &packet) == 0) {
+			if (packet.stream_index == dec.videoStream->index) {
+				if (avcodec_send_packet(dec.codecCtx(), &packet) != 0) {
 					ctx.incrementCounter(AMT_ERR_DECODE_PACKET_FAILED);
 					ctx.warn("avcodec_send_packet failed");
 				}
-				while (avcodec_receive_frame(codecCtx(), frame()) == 0) {
+				while (avcodec_receive_frame(dec.codecCtx(), frame()) == 0) {
+					if (dec.codecWidth == -1) {
+						dec.codecWidth = frame()->width;
+						dec.codecHeight = frame()->height;
+						dec.codecFormat = frame()->format;
+					}
+					dec.lastWidth = frame()->width;
+					dec.lastHeight = frame()->height;
+					dec.lastFormat = frame()->format;
 					// ŏIt[܂ŃXLbv
-					if (lastDecodeFrame != -1 || frame()->key_frame) {
-						OnFrameDecoded(frame, env);
+					if (dec.lastDecodeFrame != -1 || frame()->key_frame) {
+						OnFrameDecoded(dec, frame, env);
 					}
 				}
 			}
 			av_packet_unref(&packet);
-			if (lastDecodeFrame >= goal) {
+			if (dec.lastDecodeFrame >= goal) {
 				return;
 			}
 		}
-		if (bufferSrcCtx) {
+		if (dec.bufferSrcCtx) {
 			// Xg[͑Sēǂݎ̂ŃtB^flush
-			InputFrameFilter(nullptr, true, env);
+			InputFrameFilter(dec, nullptr, true, env);
+		}
+	}
+
+	// n fR[hfR[_IԁimutexԂŌĂԁj
+	// SăfR[hȂnullptr
+	Decoder* SelectDecoder(int n, IScriptEnvironment* env) {
+		// Oɐi߂邾nɓ͂fR[_Έԋ߂̂g
+		Decoder* best = nullptr;
+		for (auto& d : decoders) {
+			if (!d->busy && d->lastDecodeFrame != -1 &&
+				n > d->lastDecodeFrame && n < d->lastDecodeFrame + seekDistance)
+			{
+				if (best == nullptr || d->lastDecodeFrame > best->lastDecodeFrame) {
+					best = d.get();
+				}
+			}
+		}
+		if (best != nullptr) {
+			return best;
+		}
+		// V[NKvȂ̂ŗ]TΐVfR[_
+		// ĩfR[_̈ʒu󂳂Ȃ߁j
+		if ((int)decoders.size() < maxDecoders) {
+			decoders.push_back(CreateDecoder(env));
+			return decoders.back().get();
+		}
+		// ԒgĂȂfR[_V[N
+		for (auto& d : decoders) {
+			if (!d->busy && (best == nullptr || d->lastUsed < best->lastUsed)) {
+				best = d.get();
+			}
+		}
+		return best;
+	}
+
+	bool IsCached(int n) {
+		std::lock_guard<std::mutex> guard(mutex);
+		return frameCache.find(n) != frameCache.end();
+	}
+
+	// decn܂ŃfR[h
+	// lockԂŌĂԁifR[h̓bNÔő̃fR[_ƕɓj
+	void RunDecoder(Decoder& dec, int n, std::unique_lock<std::mutex>& lock, IScriptEnvironment* env) {
+		bool forward = (dec.lastDecodeFrame != -1 &&
+			n > dec.lastDecodeFrame && n < dec.lastDecodeFrame + seekDistance);
+		dec.busy = true;
+		dec.decodeBegin = forward ? dec.lastDecodeFrame + 1 : frames[n].keyFrame;
+		dec.decodeGoal = n;
+		dec.lastUsed = ++useCounter;
+		lock.unlock();
+
+		try {
+			if (forward) {
+				// Oɂ߂
+				DecodeLoop(dec, n, env);
+			}
+			else {
+				SeekAndDecode(dec, n, env);
+			}
+		}
+		catch (...) {
+			lock.lock();
+			dec.busy = false;
+			decoderFree.notify_all();
+			throw;
+		}
+
+		lock.lock();
+		dec.busy = false;
+		decoderFree.notify_all();
+	}
+
+	// L[t[܂ŃV[Nn܂ŃfR[hibNOԂŌĂԁj
+	void SeekAndDecode(Decoder& dec, int n, IScriptEnvironment* env) {
+		Stopwatch sw;
+		sw.start();
+		int keyNum = frames[n].keyFrame;
+		for (int i = 0; ; ++i) {
+			int64_t fileOffset = frames[keyNum].fileOffset / 188 * 188;
+			if (av_seek_frame(dec.inputCtx(), -1, fileOffset, AVSEEK_FLAG_BYTE) < 0) {
+				THROW(FormatException, "av_seek_frame failed");
+			}
+			// ŏ̓tbVōς܂āA܂Ȃ蒼ăgC
+			bool flushed = false;
+			if (i == 0) {
+				flushed = FlushDecoder(dec, keyNum, n, env);
+			}
+			else {
+				ResetDecoder(dec, env);
+			}
+			{
+				std::lock_guard<std::mutex> guard(mutex);
+				++stats.seek;
+				++(flushed ? stats.seekFlush : stats.seekReset);
+			}
+			DecodeLoop(dec, n, env);
+			if (IsCached(n)) {
+				// fR[h
+				double elapsed = sw.current();
+				std::lock_guard<std::mutex> guard(mutex);
+				stats.seekTime += elapsed;
+				stats.seekTimeMax = std::max(stats.seekTimeMax, elapsed);
+				seekDistance = std::max(seekDistance, n - keyNum);
+				break;
+			}
+			if (keyNum <= 0) {
+				// ȏ߂Ȃ
+				// nlastDecodeFrame܂łfR[hsƂ
+				registerFailedFrames(n, dec.lastDecodeFrame, dec.lastDecodeFrame, env);
+				break;
+			}
+			if (dec.lastDecodeFrame >= 0 && dec.lastDecodeFrame < n) {
+				// f[^ȂăS[ɓBłȂ
+				// ̃t[͑SăfR[hsƂ
+				registerFailedFrames(dec.lastDecodeFrame + 1, (int)frames.size(), dec.lastDecodeFrame, env);
+				break;
+			}
+			if (i == 2) {
+				// fR[hs
+				// nlastDecodeFrame܂łfR[hsƂ
+				registerFailedFrames(n, dec.lastDecodeFrame, dec.lastDecodeFrame, env);
+				break;
+			}
+			keyNum -= std::max(5, keyNum - frames[keyNum - 1].keyFrame);
 		}
 	}
 
 	void registerFailedFrames(int begin, int end, int replace, IScriptEnvironment* env)
 	{
+		std::unique_lock<std::mutex> lock(mutex);
 		for (int f = begin; f < end; ++f) {
 			failedMap[f] = replace;
 		}
+		QueueFrameStore();
+		WriteFrameStore(lock);
 		// fR[hst[P𒴂ꍇ̓G[Ƃ
 		if (failedMap.size() * 10 > frames.size()) {
-			env->ThrowError("[AMTSource] fR[hłȂt[܂ -> %dt[fR[hs",
+			ThrowError(env, "[AMTSource] fR[hłȂt[܂ -> %dt[fR[hs",
 				(int)failedMap.size());
 		}
 	}
@@ -614,6 +1712,10 @@ public:
 		const DecoderSetting& decoderSetting,
 		const char* filterdesc,
 		bool outputQP,
+		int maxDecoders,
+		int cacheSizeMB,
+		bool prefetch,
+		const tstring& frameStorePath,
 		IScriptEnvironment* env)
 		: AMTObject(ctx)
 		, frames(frames)
@@ -621,30 +1723,76 @@ public:
 		, audioFrames(audioFrames)
 		, filterdesc(filterdesc)
 		, outputQP(outputQP)
-		, inputCtx(srcpath)
+		, srcpath(srcpath)
+		, maxDecoders(std::max(1, maxDecoders))
+		, useCounter(0)
+		, storeQueued(0)
+		, storeWriting(false)
 		, vi()
 		, waveFile(audiopath, _T("rb"))
-		, bufferSrcCtx()
-		, bufferSinkCtx()
 		, seekDistance(10)
-		, lastDecodeFrame(-1)
+		, cacheBudget((size_t)std::max(0, cacheSizeMB) * 1024 * 1024)
+		, frameBytes(1)
+		, accessDir(0)
+		, accessRadius(0)
+		, prefetchCanceled(false)
+		, stats()
 	{
 		MakeVideoInfo(vfmt, afmt);
 
-		if (avformat_find_stream_info(inputCtx(), NULL) < 0) {
-			env->ThrowError("avformat_find_stream_info failed");
+		// 
+		// fR[_͍ŏ1ĂĎc͕KvɂȂ
+		if (frameStorePath.size() > 0 && this->filterdesc.empty()) {
+			frameStore = std::unique_ptr<DecodedFrameStore>(
+				new DecodedFrameStore(ctx, frameStorePath, vi.width, vi.height, (int)frames.size()));
 		}
-		videoStream = GetVideoStream(inputCtx());
-		if (videoStream == NULL) {
-			env->ThrowError("Could not find video stream ...");
+
+		if (frameStore != nullptr && frameStore->IsReadable()) {
+			// Sۑt@Cǂ߂̂ŃfR[_͍Ȃ
+			vi.pixel_type = VideoInfo::CS_YV12;
+			prefetch = false;
 		}
+		else {
+			decoders.push_back(CreateDecoder(env));
+			UpdateVideoInfo(*decoders[0], env);
+			if (frameStore != nullptr) {
+				// QPe[uۑĂȂƌœǂޑ̂
+				// outputQP̂Ƃ
+				if (vi.pixel_type == VideoInfo::CS_YV12 && outputQP) {
+					frameStore->StartWrite();
+				}
+				else {
+					frameStore = nullptr;
+				}
+			}
+		}
+		frameBytes = std::max<size_t>(1, vi.BMPSize());
 
-		// 
-		ResetDecoder(env);
-		UpdateVideoInfo(env);
+		if (prefetch) {
+			prefetchThread = std::unique_ptr<PrefetchThread>(new PrefetchThread(this));
+			prefetchThread->start();
+		}
 	}
 
 	~AMTSource() {
+		if (prefetchThread) {
+			{
+				std::lock_guard<std::mutex> guard(mutex);
+				prefetchCanceled = true;
+			}
+			prefetchThread->join();
+		}
+		ctx.infoF("[AMTSource] LbV qbg: %lld ~X: %lld V[N: %lld ǂGOP: %lld 폜GOP: %lld",
+			stats.hit, stats.miss, stats.seek, stats.prefetch, stats.evict);
+		if (stats.storeRead > 0) {
+			ctx.infoF("[AMTSource] fR[hς݃t[t@Cǂ񂾃t[: %lld", stats.storeRead);
+		}
+		if (stats.seek > 0) {
+			ctx.infoF("[AMTSource] V[N tbV: %lld 蒼: %lld tB^蒼: %lld : %.1fms ő: %.1fms",
+				stats.seekFlush, stats.seekReset, stats.graphRebuild,
+				stats.seekTime * 1000 / stats.seek, stats.seekTimeMax * 1000);
+		}
+
 		// LbV폜
 		while (recentAccessed.size() > 0) {
 			CacheFrame* pdel = recentAccessed.back().value;
@@ -658,70 +1806,88 @@ public:
 		storage = std::move(streamInfo);
 	}
 
-	PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env)
-	{
+	AMTSourceCacheStats GetCacheStats() {
 		std::lock_guard<std::mutex> guard(mutex);
+		return stats;
+	}
 
-		// LbVɂΕԂ
-		auto it = frameCache.find(n);
-		if (it != frameCache.end()) {
-			UpdateAccessed(it->value);
-			return it->value->data;
-		}
+	PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
 
-		// fR[hłȂt[͒ut[ɒu
-		if (failedMap.find(n) != failedMap.end()) {
-			n = failedMap[n];
+		if (prefetchError.size() > 0) {
+			std::string message = prefetchError;
+			prefetchError.clear();
+			lock.unlock();
+			env->ThrowError("%s", message.c_str());
 		}
 
-		// LbVɂȂ̂ŃfR[h
-		if (lastDecodeFrame != -1 && n > lastDecodeFrame && n < lastDecodeFrame + seekDistance) {
-			// Oɂ߂
-			DecodeLoop(n, env);
-		}
-		else {
-			// V[NăfR[h
-			int keyNum = frames[n].keyFrame;
-			for (int i = 0; ; ++i) {
-				int64_t fileOffset = frames[keyNum].fileOffset / 188 * 188;
-				if (av_seek_frame(inputCtx(), -1, fileOffset, AVSEEK_FLAG_BYTE) < 0) {
-					THROW(FormatException, "av_seek_frame failed");
+		RecordRequest(n);
+		SchedulePrefetch(n);
+
+		Decoder* pdec = nullptr;
+		bool replaced = false;
+		bool first = true;
+		while (true) {
+			// LbVɂΕԂ
+			auto it = frameCache.find(n);
+			if (it != frameCache.end()) {
+				if (first) {
+					++stats.hit;
 				}
-				ResetDecoder(env);
-				DecodeLoop(n, env);
-				if (frameCache.find(n) != frameCache.end()) {
-					// fR[h
-					seekDistance = std::max(seekDistance, n - keyNum);
-					break;
-				}
-				if (keyNum <= 0) {
-					// ȏ߂Ȃ
-					// nlastDecodeFrame܂łfR[hsƂ
-					registerFailedFrames(n, lastDecodeFrame, lastDecodeFrame, env);
-					break;
-				}
-				if (lastDecodeFrame >= 0 && lastDecodeFrame < n) {
-					// f[^ȂăS[ɓBłȂ
-					// ̃t[͑SăfR[hsƂ
-					registerFailedFrames(lastDecodeFrame + 1, (int)frames.size(), lastDecodeFrame, env);
-					break;
-				}
-				if (i == 2) {
-					// fR[hs
-					// nlastDecodeFrame܂łfR[hsƂ
-					registerFailedFrames(n, lastDecodeFrame, lastDecodeFrame, env);
+				UpdateAccessed(it->value);
+				return GetCacheData(it->value, lock, env);
+			}
+			if (first) {
+				++stats.miss;
+				first = false;
+			}
+
+			if (frameStore != nullptr && frameStore->IsReadable()) {
+				// fR[hɕۑt@Cǂ
+				++stats.storeRead;
+				lock.unlock();
+				PVideoFrame frame = frameStore->ReadFrame(n, vi, outputQP, env);
+				PutFrame(n, frame);
+				return frame;
+			}
+
+			// fR[hłȂt[͒ut[ɒu
+			auto failed = failedMap.find(n);
+			if (!replaced && failed != failedMap.end()) {
+				n = failed->second;
+				replaced = true;
+				continue;
+			}
+
+			// ̃XbhfR[h̃t[Ȃ炻҂
+			bool decoding = false;
+			for (auto& d : decoders) {
+				if (d->busy && d->decodeBegin <= n && n <= d->decodeGoal) {
+					decoding = true;
 					break;
 				}
-				keyNum -= std::max(5, keyNum - frames[keyNum - 1].keyFrame);
 			}
+			if (decoding) {
+				decoderFree.wait(lock);
+				continue;
+			}
+
+			pdec = SelectDecoder(n, env);
+			if (pdec != nullptr) {
+				break;
+			}
+			// 󂢂ĂfR[_Ȃ
+			decoderFree.wait(lock);
 		}
 
-		return ForceGetFrame(n, env);
+		RunDecoder(*pdec, n, lock, env);
+		return ForceGetFrame(n, lock, env);
 	}
 
 	void __stdcall GetAudio(void* buf, __int64 start, __int64 count, IScriptEnvironment* env)
 	{
-		std::lock_guard<std::mutex> guard(mutex);
+		std::lock_guard<std::mutex> guard(audioMutex);
 
 		if (audioFrames.size() == 0) return;
 
@@ -779,7 +1945,8 @@ void SaveAMTSource(
 	const VideoFormat& vfmt, const AudioFormat& afmt,
 	const std::vector<FilterSourceFrame>& frames,
 	const std::vector<FilterAudioFrame>& audioFrames,
-	const DecoderSetting& decoderSetting)
+	const DecoderSetting& decoderSetting,
+	const tstring& frameStorePath)
 {
 	File file(savepath, _T("wb"));
 	file.writeArray(std::vector<tchar>(srcpath.begin(), srcpath.end()));
@@ -789,9 +1956,10 @@ void SaveAMTSource(
 	file.writeArray(frames);
 	file.writeArray(audioFrames);
 	file.writeValue(decoderSetting);
+	file.writeArray(std::vector<tchar>(frameStorePath.begin(), frameStorePath.end()));
 }
 
-PClip LoadAMTSource(const tstring& loadpath, const char* filterdesc, bool outputQP, IScriptEnvironment* env)
+PClip LoadAMTSource(const tstring& loadpath, const char* filterdesc, bool outputQP, int numDecoders, int cacheSizeMB, bool prefetch, IScriptEnvironment* env)
 {
 	File file(loadpath, _T("rb"));
 	auto& srcpathv = file.readArray<tchar>();
@@ -804,8 +1972,11 @@ PClip LoadAMTSource(const tstring& loadpath, const char* filterdesc, bool output
 	data->frames = file.readArray<FilterSourceFrame>();
 	data->audioFrames = file.readArray<FilterAudioFrame>();
 	DecoderSetting decoderSetting = file.readValue<DecoderSetting>();
+	auto& frameStorePathv = file.readArray<tchar>();
+	tstring frameStorePath(frameStorePathv.begin(), frameStorePathv.end());
 	AMTSource* src = new AMTSource(*g_ctx_for_plugin_filter,
-		srcpath, audiopath, vfmt, afmt, data->frames, data->audioFrames, decoderSetting, filterdesc, outputQP, env);
+		srcpath, audiopath, vfmt, afmt, data->frames, data->audioFrames, decoderSetting,
+		filterdesc, outputQP, numDecoders, cacheSizeMB, prefetch, frameStorePath, env);
 	src->TransferStreamInfo(std::move(data));
 	return src;
 }
@@ -818,7 +1989,13 @@ AVSValue CreateAMTSource(AVSValue args, void* user_data, IScriptEnvironment* env
 	tstring filename = to_tstring(args[0].AsString());
 	const char* filterdesc = args[1].AsString("");
 	bool outputQP = args[2].AsBool(true);
-	return LoadAMTSource(filename, filterdesc, outputQP, env);
+	// ɃfR[hfR[_̍ő吔iMTŕXbhvꂽꍇɎgj
+	int numDecoders = args[3].AsInt(4);
+	// t[LbṼTCYiMBj0GOP玩Ō߂
+	int cacheSizeMB = args[4].AsInt(0);
+	// ANZX̎GOPobNOEhŃfR[hĂ
+	bool prefetch = args[5].AsBool(true);
+	return LoadAMTSource(filename, filterdesc, outputQP, numDecoders, cacheSizeMB, prefetch, env);
 }
 
 class AVSLosslessSource : public IClip
@@ -114,6 +114,9 @@ public:
 		, bytesConsumed_(0)
 		, lastPTS_(-1)
 		, syncOK(false)
+		, decodeEnabled_(true)
+		, probed_(false)
+		, lastPceKey_(-1)
 	{
 		createChannelsMap();
 	}
@@ -125,6 +128,14 @@ public:
 		decodedBuffer.release();
 	}
 
+	// false: fR[hf[^o͂ȂidecodedDataSize=0j
+	// fR[h͕ʃXbhōsꍇpBtH[}bgςƂfR[h
+	// tH[}bg𒲂ׁAȊÕt[̓wb_đÕtH[}bgg
+	void setDecodeEnabled(bool enabled) {
+		decodeEnabled_ = enabled;
+		probed_ = false;
+	}
+
 	virtual bool inputFrame(MemoryChunk frame__, std::vector<AudioFrameData>& info, int64_t PTS) {
 		info.clear();
 		decodedBuffer.clear();
@@ -171,80 +182,67 @@ public:
 				if (header.parse(ptr, len)
 					&& header.frame_length <= len)
 				{
-					// Xg[͖͂̂ʓ|Ȃ̂ŃfR[hႤ
-					if (hAacDec == NULL) {
-						resetDecoder(MemoryChunk(ptr, len));
+					AudioFrameData frameData;
+					FormatKey key = decodeEnabled_ ? FormatKey() : getFormatKey(ptr, len);
+					bool frameOK = false;
+					// fR[hȂƃf[^Ȃ̂
+					// ̃t[syncwordĂ邩mF
+					int next = ibytes + header.frame_length;
+					bool nextSyncOK = (next + 2 > (int)frame.length) ||
+						((read16(&frame.data[next]) >> 4) == 0xFFF);
+					if (!decodeEnabled_ && probed_ && key == probedKey_ && nextSyncOK) {
+						// tH[}bg͑OƓȂ̂ŃfR[hȂ
+						frameData = probedFrame_;
+						frameData.codedDataSize = header.frame_length;
+						frameOK = true;
 					}
-					NeAACDecFrameInfo frameInfo;
-					void* samples = NeAACDecDecode(hAacDec, &frameInfo, ptr, len);
-					if (frameInfo.error != 0) {
-						// tH[}bgςƃG[f̂ŏĂPH킹
-						// ςȎgNeroAACN̓Xg[̓r
-						// tH[}bgς邱Ƃz肵ĂȂ񂾂dȂ
-						//ifixed headerςȂĂ`l\ς邱Ƃ邩ǂł݂ȂƕȂj
-						resetDecoder(MemoryChunk(ptr, len));
-						samples = NeAACDecDecode(hAacDec, &frameInfo, ptr, len);
+					else {
+						frameOK = decodeFrame(ptr, len, frameData);
+						if (frameOK && !decodeEnabled_) {
+							probed_ = true;
+							probedKey_ = key;
+							probedFrame_ = frameData;
+						}
 					}
-					if (frameInfo.error == 0) {
-						// _E~bNXĂ̂2chɂȂ͂
-						int numChannels = frameInfo.num_front_channels +
-							frameInfo.num_back_channels + frameInfo.num_side_channels + frameInfo.num_lfe_channels;
-
-						if (numChannels != 2) {
-							ctx.incrementCounter(AMT_ERR_DECODE_AUDIO);
-							ctx.warnF("fR[hꂽ2chł͂܂(ch=%d)", numChannels);
+					if (frameOK) {
+						// codedBufferf[^ւ̃|C^Ă̂
+						// codedBufferɂ͐GȂ悤ɒӁI
+						frameData.codedData = ptr;
+
+						// PTSvZ
+						int64_t duration = 90000 * frameData.numSamples / frameData.format.sampleRate;
+						if (ibytes < prevDataSize) {
+							// t[̊Jñ݂pPbg擪Oꍇ
+							// i܂APESpPbg̋Eƃt[̋EvȂꍇj
+							// ݂̃pPbgPTS͓KpłȂ̂őÕpPbg̒l
+							frameData.PTS = lastPTS_;
+							lastPTS_ += duration;
+							// ݂̃pPbgȂ΃t[o͂łȂ̂ŁAo͂t[݂͌̃pPbg̈ꕔ܂ނ͂
+							ASSERT(ibytes + header.frame_length > prevDataSize);
+							// ܂APTŚi΁j̃t[PTSł
+							if (PTS >= 0) {
+								lastPTS_ = PTS;
+								PTS = -1;
+							}
 						}
 						else {
-							decodedBuffer.add(MemoryChunk((uint8_t*)samples, frameInfo.samples * 2));
-
-							AudioFrameData frameData;
-							frameData.numSamples = frameInfo.original_samples / numChannels;
-							frameData.numDecodedSamples = frameInfo.samples / numChannels;
-							frameData.format.channels = getAudioChannels(header, frameInfo);
-							frameData.format.sampleRate = frameInfo.samplerate;
-							frameData.codedDataSize = frameInfo.bytesconsumed;
-							// codedBufferf[^ւ̃|C^Ă̂
-							// codedBufferɂ͐GȂ悤ɒӁI
-							frameData.codedData = ptr;
-							frameData.decodedDataSize = frameInfo.samples * 2;
-							// AutoBuffer̓Ċmۂ̂ŃfR[hf[^ւ̃|C^͌œ
-
-							// PTSvZ
-							int64_t duration = 90000 * frameData.numSamples / frameData.format.sampleRate;
-							if (ibytes < prevDataSize) {
-								// t[̊Jñ݂pPbg擪Oꍇ
-								// i܂APESpPbg̋Eƃt[̋EvȂꍇj
-								// ݂̃pPbgPTS͓KpłȂ̂őÕpPbg̒l
-								frameData.PTS = lastPTS_;
-								lastPTS_ += duration;
-								// ݂̃pPbgȂ΃t[o͂łȂ̂ŁAo͂t[݂͌̃pPbg̈ꕔ܂ނ͂
-								ASSERT(ibytes + header.frame_length > prevDataSize);
-								// ܂APTŚi΁j̃t[PTSł
-								if (PTS >= 0) {
-									lastPTS_ = PTS;
-									PTS = -1;
-								}
-							}
-							else {
-								// PESpPbg̋Eƃt[̋Evꍇ
-								// PESpPbg2Ԗڈȍ~̃t[
-								if (PTS >= 0) {
-									lastPTS_ = PTS;
-									PTS = -1;
-								}
-								frameData.PTS = lastPTS_;
-								lastPTS_ += duration;
+							// PESpPbg̋Eƃt[̋Evꍇ
+							// PESpPbg2Ԗڈȍ~̃t[
+							if (PTS >= 0) {
+								lastPTS_ = PTS;
+								PTS = -1;
 							}
+							frameData.PTS = lastPTS_;
+							lastPTS_ += duration;
+						}
 
-							info.push_back(frameData);
+						info.push_back(frameData);
 
-							// f[^i߂
-							ASSERT(frameInfo.bytesconsumed == header.frame_length);
-							ibytes += header.frame_length - 1;
-							bytesConsumed_ = ibytes + 1;
+						// f[^i߂
+						ibytes += header.frame_length - 1;
+						bytesConsumed_ = ibytes + 1;
 
-							syncOK = true;
-						}
+						syncOK = true;
 					}
 				}
 				else {
@@ -282,6 +280,114 @@ private:
 	AutoBuffer decodedBuffer;
 	bool syncOK;
 
+	// fR[hȂꍇ̃tH[}bgp
+	// fixed headerPCẼ`lGg\̑g
+	typedef std::pair<int, int64_t> FormatKey;
+	bool decodeEnabled_;
+	bool probed_;
+	FormatKey probedKey_;
+	AudioFrameData probedFrame_;
+	int64_t lastPceKey_;
+
+	// 1t[fR[hătH[}bg擾
+	bool decodeFrame(uint8_t* ptr, int len, AudioFrameData& frameData) {
+		// Xg[͖͂̂ʓ|Ȃ̂ŃfR[hႤ
+		if (hAacDec == NULL) {
+			resetDecoder(MemoryChunk(ptr, len));
+		}
+		NeAACDecFrameInfo frameInfo;
+		void* samples = NeAACDecDecode(hAacDec, &frameInfo, ptr, len);
+		if (frameInfo.error != 0) {
+			// tH[}bgςƃG[f̂ŏĂPH킹
+			// ςȎgNeroAACN̓Xg[̓r
+			// tH[}bgς邱Ƃz肵ĂȂ񂾂dȂ
+			//ifixed headerςȂĂ`l\ς邱Ƃ邩ǂł݂ȂƕȂj
+			resetDecoder(MemoryChunk(ptr, len));
+			samples = NeAACDecDecode(hAacDec, &frameInfo, ptr, len);
+		}
+		if (frameInfo.error != 0) {
+			return false;
+		}
+		// _E~bNXĂ̂2chɂȂ͂
+		int numChannels = frameInfo.num_front_channels +
+			frameInfo.num_back_channels + frameInfo.num_side_channels + frameInfo.num_lfe_channels;
+
+		if (numChannels != 2) {
+			ctx.incrementCounter(AMT_ERR_DECODE_AUDIO);
+			ctx.warnF("fR[hꂽ2chł͂܂(ch=%d)", numChannels);
+			return false;
+		}
+
+		frameData.numSamples = frameInfo.original_samples / numChannels;
+		frameData.format.channels = getAudioChannels(header, frameInfo);
+		frameData.format.sampleRate = frameInfo.samplerate;
+		frameData.codedDataSize = frameInfo.bytesconsumed;
+		ASSERT(frameInfo.bytesconsumed == header.frame_length);
+		if (decodeEnabled_) {
+			decodedBuffer.add(MemoryChunk((uint8_t*)samples, frameInfo.samples * 2));
+			frameData.numDecodedSamples = frameInfo.samples / numChannels;
+			frameData.decodedDataSize = frameInfo.samples * 2;
+			// AutoBuffer̓Ċmۂ̂ŃfR[hf[^ւ̃|C^͌œ
+		}
+		else {
+			frameData.numDecodedSamples = 0;
+			frameData.decodedDataSize = 0;
+		}
+		return true;
+	}
+
+	FormatKey getFormatKey(uint8_t* ptr, int len) {
+		int headerKey = (header.profile << 9) | (header.sampling_frequency_index << 5) |
+			(header.channel_configuration << 2) | header.number_of_raw_data_blocks_in_frame;
+		int64_t pceKey = -1;
+		if (header.channel_configuration == 0) {
+			// `l\PCEɂ
+			// PCEȂt[͒OPCEƓ\Ƃ݂Ȃ
+			pceKey = readPceElements(ptr, len);
+			if (pceKey == -1) {
+				pceKey = lastPceKey_;
+			}
+			lastPceKey_ = pceKey;
+		}
+		return FormatKey(headerKey, pceKey);
+	}
+
+	// 擪̃GgPCEȂ`lGg\ԂiȂ-1j
+	int64_t readPceElements(uint8_t* ptr, int len) {
+		int offset = header.numBytesRead + (header.protection_absent ? 0 : 2);
+		if (offset >= len) {
+			return -1;
+		}
+		BitReader reader(MemoryChunk(ptr + offset, len - offset));
+		try {
+			if (reader.read<3>() != ID_PCE) {
+				return -1;
+			}
+			reader.skip(4 + 2 + 4); // element_instance_tag, object_type, sampling_frequency_index
+			int numFront = reader.read<4>();
+			int numSide = reader.read<4>();
+			int numBack = reader.read<4>();
+			int numLfe = reader.read<2>();
+			reader.skip(3 + 4); // num_assoc_data_elements, num_valid_cc_elements
+			if (reader.read<1>()) reader.skip(4); // mono_mixdown_element_number
+			if (reader.read<1>()) reader.skip(4); // stereo_mixdown_element_number
+			if (reader.read<1>()) reader.skip(3); // matrix_mixdown_idx, pseudo_surround_enable
+			uint8_t elems[16 * 3 + 4];
+			int numElem = 0;
+			for (int i = 0; i < numFront + numSide + numBack; ++i) {
+				elems[numElem++] = reader.read<1>() ? (uint8_t)ID_CPE : (uint8_t)ID_SCE;
+				reader.skip(4); // element_tag_select
+			}
+			for (int i = 0; i < numLfe; ++i) {
+				elems[numElem++] = (uint8_t)ID_LFE;
+			}
+			return channelCanonical(numElem, elems);
+		}
+		catch (const EOFException&) {
+			return -1;
+		}
+	}
+
 	void closeDecoder() {
 		if (hAacDec != NULL) {
 			NeAACDecClose(hAacDec);
@@ -412,6 +518,7 @@ public:
 	DualMonoSplitter(AMTContext& ctx)
 		: AMTObject(ctx)
 		, hAacDec(NULL)
+		, numFallbackFrames(0)
 	{ }
 
 	~DualMonoSplitter() {
@@ -424,16 +531,18 @@ public:
 		if (!header.parse(frame.data, (int)frame.length)) {
 			THROW(FormatException, "[DualMonoSplitter] wb_parsełȂ");
 		}
-		// Xg[͖͂̂ʓ|Ȃ̂ŃfR[hႤ
 		if (hAacDec == NULL) {
 			resetDecoder(MemoryChunk(frame.data, frame.length));
 		}
+		// Gg̈ʒu΂̂ŃV^bNX͂iIMDCT͂Ȃj
 		NeAACDecFrameInfo frameInfo;
-		void* samples = NeAACDecDecode(hAacDec, &frameInfo, frame.data, (int)frame.length);
+		NeAACDecParse(hAacDec, &frameInfo, frame.data, (int)frame.length);
 		if (frameInfo.error != 0) {
 			// ł͑vƂ͎vǈꉞG[΍͂Ă
+			// ͂łȂfR[_ăfR[hĂ݂
+			++numFallbackFrames;
 			resetDecoder(MemoryChunk(frame.data, frame.length));
-			samples = NeAACDecDecode(hAacDec, &frameInfo, frame.data, (int)frame.length);
+			NeAACDecDecode(hAacDec, &frameInfo, frame.data, (int)frame.length);
 		}
 		if (frameInfo.error == 0) {
 			if (frameInfo.fr_ch_ele != 2) {
@@ -491,9 +600,15 @@ public:
 
 	virtual void OnOutFrame(int index, MemoryChunk mc) = 0;
 
+	// V^bNX͂ɎsăfR[ht[
+	int getNumFallbackFrames() const {
+		return numFallbackFrames;
+	}
+
 private:
 	NeAACDecHandle hAacDec;
 	AutoBuffer buf;
+	int numFallbackFrames;
 
 	void closeDecoder() {
 		if (hAacDec != NULL) {
@@ -48,10 +48,11 @@ extern "C" __declspec(dllexport) const char* __stdcall AvisynthPluginInit3(IScri
 		g_av_initialized = true;
 	}
 
-	env->AddFunction("AMTSource", "s[filter]s[outqp]b", av::CreateAMTSource, 0);
+	env->AddFunction("AMTSource", "s[filter]s[outqp]b[decoders]i[cachesize]i[prefetch]b", av::CreateAMTSource, 0);
 
 	env->AddFunction("AMTAnalyzeLogo", "cs[maskratio]i", logo::AMTAnalyzeLogo::Create, 0);
 	env->AddFunction("AMTEraseLogo", "ccs[logof]s[mode]i", logo::AMTEraseLogo::Create, 0);
+	env->AddFunction("AMTLumaProxySource", "s", logo::AMTLumaProxySource::Create, 0);
 
 	return "Amatsukaze plugin";
 }
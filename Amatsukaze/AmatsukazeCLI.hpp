@@ -97,10 +97,34 @@ static void printHelp(const tchar* bin) {
 		"                      drcs : }bsÔȂDRCSO摜o͂郂[h\n"
 		"                      probe_subtitles : 邩\n"
 		"                      probe_audio : tH[}bgo\n"
+		"                      probe_all : drcs,probe_subtitles,probe_audio1̓ǂݍ݂ōs\n"
+		"                                  ʂJSONŏói-jŃt@Cɂój\n"
 		"  --resource-manager <̓pCv>:<o̓pCv> \[XǗzXgƂ̒ʐMpCv\n"
 		"  --affinity <O[v>:<}XN> CPUAtBjeB\n"
 		"                      O[v̓vZbTO[vi64_RAȉ̃VXeł0̂݁j\n"
 		"  --max-frames        probe_*[ĥݗLBTS鎞Ԃft[Ŏw[9000]\n"
+		"  --input-engine <@> TSt@C̓ǂݍݕ@[readahead]\n"
+		"                      readahead : ʃXbhŐǂ݂Ȃǂݍ\n"
+		"                      read : ʏ̃t@Cǂݍ\n"
+		"                      mmap : }bvăRs[Ƀp[T֓\n"
+		"  --split-threads <> TS̕񐔁B0Ř_RA[1]\n"
+		"                      ͂𕪊ĕɉ͂i傫ȃt@Ĉ݁j\n"
+		"  --ts-index          TSɓ̓t@C̍\CfbNXi<̓t@C>.amtidxjɕۑ\n"
+		"                      ȍ~̃SGUĨV[N⎚̗L̔肪Ȃ\n"
+		"  --init-buffer <MB>  PAT,PMT,PCR҂ԂɕۑĂTS̃TCY[10]\n"
+		"                      ̓rn܂ĂčŏPCRPMTxt@Cp\n"
+		"  --int-video-no-cache ԉft@COS̃t@CLbVʂɏ\n"
+		"                      Ȓԃt@CœTSȂǂLbVǂoȂ悤ɂ\n"
+		"  --virtual-demux     ԉft@C炸ɓTSf𒼐ړǂ\n"
+		"                      ԉft@C̑TS̈ʒũCfbNXo͂\n"
+		"  --frame-store       ŏɃfR[ht[tkňꎞtH_ɕۑ\n"
+		"                      chapter_exetB^AGR[hł̓fR[hɂǂ\n"
+		"                      ꎞtH_ɉfTCY̋󂫂Kv\n"
+		"  --luma-proxy        S͂ŃfR[hƂ1/4ɏkPx̃vLV\n"
+		"                      chapter_exe̓fR[hɂǂށiSw莞̂ݗLj\n"
+		"                      vLVUtVideoŉtkĈꎞtH_ɒui񈳏kȂ1080̉f1Ԃ14GBj\n"
+		"                      kfŃV[`FWôŁAV[`FWʒuCM茋ʂς邱Ƃ\n"
+		"  --logo-threads <l> S͂̕]Xbh[0=]\n"
 		"  --dump              r̃f[^_vifobOpj\n",
 		bin);
 }
@@ -213,6 +237,8 @@ static std::unique_ptr<ConfigWrapper> parseArgs(AMTContext& ctx, int argc, const
 	conf.cmoutmask = 1;
 	conf.nicojkmask = 1;
 	conf.maxframes = 30 * 300;
+	conf.inputEngine = INPUT_ENGINE_READAHEAD;
+	conf.splitThreads = 1;
 	conf.inPipe = INVALID_HANDLE_VALUE;
 	conf.outPipe = INVALID_HANDLE_VALUE;
 	bool nicojk = false;
@@ -441,6 +467,45 @@ static std::unique_ptr<ConfigWrapper> parseArgs(AMTContext& ctx, int argc, const
 		else if (key == _T("--max-frames")) {
 			conf.maxframes = std::stoi(getParam(argc, argv, i++));
 		}
+		else if (key == _T("--input-engine")) {
+			const auto arg = getParam(argc, argv, i++);
+			if (arg == _T("read")) {
+				conf.inputEngine = INPUT_ENGINE_READ;
+			}
+			else if (arg == _T("mmap")) {
+				conf.inputEngine = INPUT_ENGINE_MMAP;
+			}
+			else if (arg == _T("readahead")) {
+				conf.inputEngine = INPUT_ENGINE_READAHEAD;
+			}
+			else {
+				THROWF(ArgumentException, "--input-engine̎w肪ԈĂ܂: %" PRITSTR "", arg);
+			}
+		}
+		else if (key == _T("--split-threads")) {
+			conf.splitThreads = std::stoi(getParam(argc, argv, i++));
+		}
+		else if (key == _T("--ts-index")) {
+			conf.tsIndex = true;
+		}
+		else if (key == _T("--init-buffer")) {
+			conf.initBufferSize = std::stoi(getParam(argc, argv, i++));
+		}
+		else if (key == _T("--int-video-no-cache")) {
+			conf.intVideoNoCache = true;
+		}
+		else if (key == _T("--virtual-demux")) {
+			conf.virtualDemux = true;
+		}
+		else if (key == _T("--frame-store")) {
+			conf.frameStore = true;
+		}
+		else if (key == _T("--luma-proxy")) {
+			conf.lumaProxy = true;
+		}
+		else if (key == _T("--logo-threads")) {
+			conf.logoThreads = std::stoi(getParam(argc, argv, i++));
+		}
 		else if (key == _T("--pmt-cut")) {
 			const auto arg = getParam(argc, argv, i++);
 			int ret = sscanfT(arg.c_str(), _T("%lf:%lf"),
@@ -588,15 +653,53 @@ static int amatsukazeTranscodeMain(AMTContext& ctx, const ConfigWrapper& setting
 			detectSubtitleMain(ctx, setting);
 		else if (mode == _T("probe_audio"))
 			detectAudioMain(ctx, setting);
+		else if (mode == _T("probe_all"))
+			probeAllMain(ctx, setting);
 
 		else if (mode == _T("test_print_crc"))
 			test::PrintCRCTable(ctx, setting);
 		else if (mode == _T("test_crc"))
 			test::CheckCRC(ctx, setting);
+		else if (mode == _T("test_crc_engines"))
+			test::CheckCRCEngines(ctx, setting);
+		else if (mode == _T("test_crc_perf"))
+			test::CRCPerformance(ctx, setting);
+		else if (mode == _T("test_mpeg2_scan_perf"))
+			test::Mpeg2ScanPerformance(ctx, setting);
 		else if (mode == _T("test_read_bits"))
 			test::ReadBits(ctx, setting);
 		else if (mode == _T("test_auto_buffer"))
 			test::CheckAutoBuffer(ctx, setting);
+		else if (mode == _T("test_ts_packet_parser"))
+			test::CheckTsPacketParser(ctx, setting);
+		else if (mode == _T("test_ts_packet_buffer"))
+			test::CheckTsPacketBuffer(ctx, setting);
+		else if (mode == _T("test_h264_nal_scan"))
+			test::CheckH264NalScanner(ctx, setting);
+		else if (mode == _T("test_ts_resync_perf"))
+			test::TsResyncPerformance(ctx, setting);
+		else if (mode == _T("test_logo_corr_perf"))
+			test::LogoCorrelationPerformance(ctx, setting);
+		else if (mode == _T("test_logo_bg_check"))
+			test::LogoBackgroundCheck(ctx, setting);
+		else if (mode == _T("test_logo_filter_perf"))
+			test::LogoFilterPerformance(ctx, setting);
+		else if (mode == _T("test_parallel_split"))
+			test::ParallelSplit(ctx, setting);
+		else if (mode == _T("test_async_audio_decode"))
+			test::AsyncAudioDecode(ctx, setting);
+		else if (mode == _T("test_ts_index"))
+			test::TsIndexTest(ctx, setting);
+		else if (mode == _T("test_late_caption_ts"))
+			test::MakeLateCaptionTs(ctx, setting);
+		else if (mode == _T("test_probe_all_subtitle"))
+			test::ProbeAllSubtitleTest(ctx, setting);
+		else if (mode == _T("test_block_file_writer"))
+			test::CheckBlockFileWriter(ctx, setting);
+		else if (mode == _T("test_frame_store"))
+			test::DecodedFrameStoreTest(ctx, setting);
+		else if (mode == _T("test_virtual_demux"))
+			test::VirtualDemuxTest(ctx, setting);
 		else if (mode == _T("test_verifympeg2ps"))
 			test::VerifyMpeg2Ps(ctx, setting);
 		else if (mode == _T("test_readts"))
@@ -615,8 +718,18 @@ static int amatsukazeTranscodeMain(AMTContext& ctx, const ConfigWrapper& setting
 			test::LosslessFileTest(ctx, setting);
 		else if (mode == _T("test_logoframe"))
 			test::LogoFrameTest(ctx, setting);
+		else if (mode == _T("test_logoframe_threads"))
+			test::LogoFrameThreadsTest(ctx, setting);
+		else if (mode == _T("test_logo_remake"))
+			test::LogoRemakeTest(ctx, setting);
+		else if (mode == _T("test_luma_proxy"))
+			test::LumaProxyFileTest(ctx, setting);
+		else if (mode == _T("test_luma_proxy_chapter"))
+			test::LumaProxyChapterTest(ctx, setting);
 		else if (mode == _T("test_dualmono"))
 			test::SplitDualMonoAAC(ctx, setting);
+		else if (mode == _T("test_dualmono_parse"))
+			test::DualMonoParseTest(ctx, setting);
 		else if (mode == _T("test_aacdecode"))
 			test::AACDecodeTest(ctx, setting);
 		else if (mode == _T("test_ass"))
@@ -51,56 +51,1468 @@ static int CheckCRC(AMTContext& ctx, const ConfigWrapper& setting)
 	return 0;
 }
 
+// SĂCRCvZ@ʂɂȂ邩
+static int CheckCRCEngines(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	CRC32 crc;
+	bool clmul = CRC32::IsCLMULAvailable();
+	if (!clmul) {
+		printf("PCLMULQDQgȂ̂slicing-by-8̂݃`FbN܂\n");
+	}
+
+	srand(0);
+	std::vector<uint8_t> buf(8192);
+	for (auto& b : buf) b = (uint8_t)rand();
+
+	for (int i = 0; i < 20000; ++i) {
+		// Et߂̒d_I
+		int length = (i < 1024) ? i : (rand() % 4096);
+		int offset = rand() % 64;
+		uint32_t init = (i % 2) ? 0xFFFFFFFFUL : (((uint32_t)rand() << 16) ^ (uint32_t)rand());
+		const uint8_t* data = buf.data() + offset;
+		uint32_t ref = crc.calcBytewise(data, length, init);
+		if (crc.calcSlice8(data, length, init) != ref) {
+			THROWF(TestException, "[CheckCRCEngines] slicing-by-8 does not match (length=%d)", length);
+		}
+		if (clmul && crc.calcCLMUL(data, length, init) != ref) {
+			THROWF(TestException, "[CheckCRCEngines] PCLMULQDQ does not match (length=%d)", length);
+		}
+		if (crc.calc(data, length, init) != ref) {
+			THROWF(TestException, "[CheckCRCEngines] calc does not match (length=%d)", length);
+		}
+	}
+
+	// ČvZĂ
+	uint32_t whole = crc.calc(buf.data(), (int)buf.size(), 0xFFFFFFFFUL);
+	for (int split = 1; split < (int)buf.size(); split += 97) {
+		uint32_t t = crc.calc(buf.data(), split, 0xFFFFFFFFUL);
+		if (crc.calc(buf.data() + split, (int)buf.size() - split, t) != whole) {
+			THROWF(TestException, "[CheckCRCEngines] split calculation does not match (split=%d)", split);
+		}
+	}
+
+	return 0;
+}
+
+static int CRCPerformance(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	CRC32 crc;
+	srand(0);
+
+	// 傫ȃf[^ƁAPSIZNVx̒Zf[^
+	std::vector<uint8_t> buf(64 * 1024 * 1024);
+	for (auto& b : buf) b = (uint8_t)rand();
+	const int sectionSizes[] = { (int)buf.size(), 4096, 1024, 188 };
+
+	struct Engine {
+		const char* name;
+		uint32_t(CRC32::*func)(const uint8_t* data, int length, uint32_t crc) const;
+	};
+	std::vector<Engine> engines = {
+		{ "bytewise", &CRC32::calcBytewise },
+		{ "slicing-by-8", &CRC32::calcSlice8 },
+	};
+	if (CRC32::IsCLMULAvailable()) {
+		engines.push_back({ "PCLMULQDQ", &CRC32::calcCLMUL });
+	}
+
+	for (int sectionSize : sectionSizes) {
+		uint32_t ref = 0;
+		for (int k = 0; k < (int)engines.size(); ++k) {
+			Stopwatch sw;
+			sw.start();
+			uint32_t sum = 0;
+			for (int pos = 0; pos + sectionSize <= (int)buf.size(); pos += sectionSize) {
+				sum ^= (crc.*engines[k].func)(buf.data() + pos, sectionSize, 0xFFFFFFFFUL);
+			}
+			sw.stop();
+			printf("%s (%d bytes): %.1f MB/s\n", engines[k].name, sectionSize,
+				buf.size() / sw.getTotal() / (1024 * 1024));
+			if (k == 0) {
+				ref = sum;
+			}
+			else if (sum != ref) {
+				THROWF(TestException, "[CRCPerformance] %s result does not match", engines[k].name);
+			}
+		}
+	}
+
+	return 0;
+}
+
+// nfWi1440x1080,16MbpsjMPEG2 ESPESPʂō
+static std::vector<std::vector<uint8_t>> MakeSyntheticMpeg2Es(int numFrames, int frameBytes)
+{
+	auto writePicture = [](BitWriter& writer, int codingType, int structure) {
+		writer.write<32>(PICTURE_START_CODE);
+		writer.write<10>(0); // temporal_reference
+		writer.write<3>(codingType);
+		writer.write<16>(0xFFFF); // vbv_delay
+		if (codingType == 2 || codingType == 3) writer.write<4>(0x7);
+		if (codingType == 3) writer.write<4>(0x7);
+		writer.write<1>(0); // extra_bit_picture
+		writer.byteAlign<false>();
+		writer.write<32>(EXTENSION_START_CODE);
+		writer.write<4>(0x8); // Picture Coding Extension ID
+		writer.write<16>(0xFFFF); // f_code
+		writer.write<2>(0); // intra_dc_precision
+		writer.write<2>(structure);
+		writer.write<1>(1); // top_field_first
+		writer.write<5>(0);
+		writer.write<1>(0); // repeat_first_field
+		writer.write<1>(1); // chroma_420_type
+		writer.write<1>(0); // progressive_frame
+		writer.write<1>(0); // composite_display_flag
+		writer.byteAlign<false>();
+	};
+	// XCX0x002Ȃ_f[^
+	auto writeSlices = [](BitWriter& writer, int bytes) {
+		for (int slice = 1; bytes > 0; ++slice) {
+			writer.write<32>(0x100 + std::min(slice, 0xAF));
+			for (int i = 0; i < 1024; ++i, --bytes) {
+				writer.write<8>((rand() % 255) + 1);
+			}
+		}
+	};
+
+	std::vector<std::vector<uint8_t>> pesList;
+	for (int i = 0; i < numFrames; ++i) {
+		AutoBuffer buf;
+		BitWriter writer(buf);
+		if (i % 15 == 0) {
+			writer.write<32>(SEQ_HEADER_START_CODE);
+			writer.write<12>(1440);
+			writer.write<12>(1080);
+			writer.write<4>(3); // 16:9
+			writer.write<4>(4); // 30000/1001
+			writer.write<18>(16000000 / 400);
+			writer.write<1>(1); // marker_bit
+			writer.write<10>(0x3FF);
+			writer.write<3>(0);
+			writer.write<32>(EXTENSION_START_CODE);
+			writer.write<4>(0x1); // Sequence Extension ID
+			writer.write<8>(0x44); // Main@High-1440
+			writer.write<1>(0); // progressive_sequence
+			writer.write<2>(1); // 4:2:0
+			writer.write<4>(0);
+			writer.write<12>(0);
+			writer.write<1>(1); // marker_bit
+			writer.write<8>(0);
+			writer.write<8>(0);
+			writer.write<32>(EXTENSION_START_CODE);
+			writer.write<4>(0x2); // Sequence Display Extension ID
+			writer.write<3>(0);
+			writer.write<1>(1); // colour_description
+			writer.write<8>(1);
+			writer.write<8>(1);
+			writer.write<8>(1);
+			writer.write<14>(1920);
+			writer.write<1>(1); // marker_bit
+			writer.write<14>(1080);
+			writer.byteAlign<false>();
+			writer.write<32>(0x1B8); // GOP
+			writer.write<25>(0);
+			writer.write<2>(2); // closed_gop, broken_link
+			writer.byteAlign<false>();
+		}
+		int codingType = (i % 15 == 0) ? 1 : (i % 3 == 0) ? 2 : 3;
+		if (i % 10 == 5) {
+			// tB[hsN`
+			writePicture(writer, codingType, 1);
+			writeSlices(writer, frameBytes / 2);
+			writePicture(writer, codingType, 2);
+			writeSlices(writer, frameBytes / 2);
+		}
+		else {
+			writePicture(writer, codingType, 3);
+			writeSlices(writer, frameBytes);
+		}
+		writer.flush();
+		pesList.emplace_back(buf.ptr(), buf.ptr() + buf.size());
+	}
+	return pesList;
+}
+
+// MPEG2wb_̂݃[hSꍇƓʂɂȂ邩Aǂꂭ炢Ȃ邩
+static int Mpeg2ScanPerformance(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	srand(0);
+	auto pesList = MakeSyntheticMpeg2Es(300, 16000000 / 8 * 1001 / 30000);
+	size_t totalBytes = 0;
+	for (const auto& pes : pesList) totalBytes += pes.size();
+
+	std::vector<VideoFrameInfo> result[2];
+	for (int headerOnly = 0; headerOnly < 2; ++headerOnly) {
+		MPEG2VideoParser parser(ctx);
+		parser.setHeaderOnlyScan(headerOnly != 0);
+		std::vector<VideoFrameInfo> info;
+		Stopwatch sw;
+		for (int k = 0; k < 10; ++k) {
+			result[headerOnly].clear();
+			parser.reset();
+			sw.start();
+			for (int i = 0; i < (int)pesList.size(); ++i) {
+				auto& pes = pesList[i];
+				if (!parser.inputFrame(MemoryChunk(pes.data(), pes.size()), info, i * 3003, i * 3003)) {
+					THROWF(TestException, "[Mpeg2ScanPerformance] inputFrame failed (frame=%d)", i);
+				}
+				result[headerOnly].insert(result[headerOnly].end(), info.begin(), info.end());
+			}
+			sw.stop();
+		}
+		printf("%s: %.1f MB/s skipped %.1f%%\n", headerOnly ? "header only" : "full scan",
+			totalBytes * 10 / sw.getTotal() / (1024 * 1024),
+			parser.getNumSkippedBytes() * 100.0 / parser.getNumInputBytes());
+		if (headerOnly && parser.getNumSkippedBytes() == 0) {
+			THROW(TestException, "[Mpeg2ScanPerformance] nothing is skipped");
+		}
+	}
+
+	if (result[0].size() != pesList.size() || result[1].size() != pesList.size()) {
+		THROW(TestException, "[Mpeg2ScanPerformance] number of frames does not match");
+	}
+	for (int i = 0; i < (int)pesList.size(); ++i) {
+		const auto& a = result[0][i];
+		const auto& b = result[1][i];
+		if (a.isGopStart != b.isGopStart || a.progressive != b.progressive ||
+			a.pic != b.pic || a.type != b.type || a.codedDataSize != b.codedDataSize ||
+			a.format != b.format)
+		{
+			THROWF(TestException, "[Mpeg2ScanPerformance] frame info does not match (frame=%d)", i);
+		}
+	}
+
+	return 0;
+}
+
 static int ReadBits(AMTContext& ctx, const ConfigWrapper& setting)
 {
-	uint8_t data[16];
-	srand(0);
-	for (int i = 0; i < sizeof(data); ++i) data[i] = rand();
+	uint8_t data[16];
+	srand(0);
+	for (int i = 0; i < sizeof(data); ++i) data[i] = rand();
+
+	//uint16_t a = read16(data);
+	//uint32_t b = read24(data);
+	//uint32_t c = read32(data);
+	//uint64_t d = read40(data);
+	uint64_t e = read48(data);
+
+	fprintf(stderr, "sum=%f\n", double(e));
+
+	return 0;
+}
+
+static int CheckAutoBuffer(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	srand(0);
+
+	std::unique_ptr<uint8_t[]> buf = std::unique_ptr<uint8_t[]>(new uint8_t[65536]);
+	int addCnt = 0;
+	int delCnt = 0;
+
+	AutoBuffer ab;
+	for (int i = 0; i < 10000; ++i) {
+		int addNum = rand();
+		int delNum = rand();
+
+		for (int c = 0; c < addNum; ++c) {
+			buf[c] = addCnt++;
+		}
+		//fprintf(stderr, "Add %d\n", addNum);
+		ab.add(MemoryChunk(buf.get(), addNum));
+
+		uint8_t *data = ab.ptr();
+		for (int c = 0; c < (int)ab.size(); ++c) {
+			if (data[c] != ((delCnt + c) & 0xFF)) {
+				fprintf(stderr, "[CheckAutoBuffer] Result does not match\n");
+				return 1;
+			}
+		}
+
+		delNum = std::min<int>(delNum, (int)ab.size());
+		//fprintf(stderr, "Del %d\n", delNum);
+		ab.trimHead(delNum);
+		delCnt += delNum;
+	}
+
+	return 0;
+}
+
+// yC[hTSpPbg𐶐
+// garbageInterval > 0 ̂Ƃ͂̃pPbgƂɃS~f[^}ēO
+static std::vector<uint8_t> MakeSyntheticTs(int numPackets, int garbageInterval, int maxGarbage)
+{
+	std::vector<uint8_t> ts;
+	ts.reserve(numPackets * (TS_PACKET_LENGTH + maxGarbage));
+	for (int i = 0; i < numPackets; ++i) {
+		if (garbageInterval > 0 && i > 0 && (i % garbageInterval) == 0) {
+			int len = rand() % (maxGarbage + 1);
+			for (int c = 0; c < len; ++c) {
+				ts.push_back((uint8_t)rand());
+			}
+		}
+		int pid = 0x100 + (i % 16);
+		ts.push_back(TS_SYNC_BYTE);
+		ts.push_back((pid >> 8) & 0x1F);
+		ts.push_back(pid & 0xFF);
+		ts.push_back(0x10 | (i & 0xF)); // yC[ĥ
+		for (int c = 4; c < TS_PACKET_LENGTH; ++c) {
+			ts.push_back((uint8_t)rand());
+		}
+	}
+	return ts;
+}
+
+// o͂ꂽpPbgSȂĕۑ邾̃p[T
+class TsPacketCollector : public TsPacketParser {
+public:
+	TsPacketCollector(AMTContext& ctx) : TsPacketParser(ctx), numSkipped(0) { }
+	std::vector<uint8_t> packets;
+	std::vector<int64_t> offsets;
+	std::vector<int> skippedBefore; // epPbg̑O܂łɎ̂ĂꂽpPbg
+	int numSkipped;
+protected:
+	virtual void onTsPacket(TsPacket packet) {
+		packets.insert(packets.end(), packet.data, packet.data + TS_PACKET_LENGTH);
+		offsets.push_back(getPacketOffset());
+		skippedBefore.push_back(numSkipped);
+	}
+	virtual void onTsPacketsSkipped(int numPackets) {
+		numSkipped += numPackets;
+	}
+};
+
+static int CheckTsPacketParser(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	srand(0);
+
+	// ȃXg[͍Ō̃pPbgȊOSoĂ
+	auto clean = MakeSyntheticTs(10000, 0, 0);
+	{
+		TsPacketCollector parser(ctx);
+		for (size_t pos = 0; pos < clean.size(); ) {
+			size_t len = std::min<size_t>(rand() % 5000 + 1, clean.size() - pos);
+			parser.inputTS(MemoryChunk(clean.data() + pos, len));
+			pos += len;
+		}
+		if (parser.packets.size() != clean.size() - TS_PACKET_LENGTH ||
+			memcmp(parser.packets.data(), clean.data(), parser.packets.size()) != 0)
+		{
+			THROW(TestException, "[CheckTsPacketParser] clean stream does not match");
+		}
+	}
+
+	// S~ĂĂ͂̋؂ɂČʂςȂ
+	auto noisy = MakeSyntheticTs(10000, 50, 400);
+	TsPacketCollector whole(ctx);
+	whole.inputTS(MemoryChunk(noisy.data(), noisy.size()));
+	whole.flush();
+	for (int i = 0; i < (int)whole.offsets.size(); ++i) {
+		if (memcmp(noisy.data() + whole.offsets[i], whole.packets.data() + i * TS_PACKET_LENGTH, TS_PACKET_LENGTH)) {
+			THROWF(TestException, "[CheckTsPacketParser] wrong packet offset (packet=%d)", i);
+		}
+	}
+	const int chunkSizes[] = { 1, 7, TS_PACKET_LENGTH, TS_PACKET_LENGTH + 1, 4096, -1 };
+	for (int chunkSize : chunkSizes) {
+		TsPacketCollector parser(ctx);
+		for (size_t pos = 0; pos < noisy.size(); ) {
+			size_t len = (chunkSize > 0) ? chunkSize : (rand() % 5000 + 1);
+			len = std::min<size_t>(len, noisy.size() - pos);
+			parser.inputTS(MemoryChunk(noisy.data() + pos, len));
+			pos += len;
+		}
+		parser.flush();
+		if (parser.packets != whole.packets || parser.offsets != whole.offsets) {
+			THROWF(TestException, "[CheckTsPacketParser] noisy stream does not match (chunk=%d)", chunkSize);
+		}
+	}
+
+	// PIDtB^: ʂpPbg̓tB^ȂƓŁÂĂpPbg͍
+	PidFilter filter;
+	for (int pid = 0x100; pid < 0x110; pid += 2) {
+		filter.set(pid);
+	}
+	TsPacketCollector filtered(ctx);
+	for (size_t pos = 0; pos < noisy.size(); ) {
+		size_t len = std::min<size_t>(rand() % 5000 + 1, noisy.size() - pos);
+		filtered.inputTS(MemoryChunk(noisy.data() + pos, len));
+		pos += len;
+		if (pos > noisy.size() / 2) {
+			// rtB^Lɂ
+			filtered.setPidFilter(&filter);
+		}
+	}
+	filtered.flush();
+	int numOut = 0;
+	for (int i = 0; i < (int)whole.offsets.size(); ++i) {
+		const uint8_t* packet = whole.packets.data() + i * TS_PACKET_LENGTH;
+		int pid = ((packet[1] & 0x1F) << 8) | packet[2];
+		if (numOut < (int)filtered.offsets.size() && filtered.offsets[numOut] == whole.offsets[i]) {
+			if (filtered.skippedBefore[numOut] != i - numOut) {
+				THROWF(TestException, "[CheckTsPacketParser] wrong skipped count (packet=%d)", i);
+			}
+			++numOut;
+		}
+		else if (filter.test(pid)) {
+			THROWF(TestException, "[CheckTsPacketParser] filtered packet is missing (packet=%d)", i);
+		}
+	}
+	if (numOut != (int)filtered.offsets.size() ||
+		numOut + filtered.numSkipped != (int)whole.offsets.size())
+	{
+		THROW(TestException, "[CheckTsPacketParser] PID filter result does not match");
+	}
+
+	return 0;
+}
+
+// ҂obt@ǂݒpPbgۑŐṼpPbgƈv邩
+static int CheckTsPacketBuffer(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	struct Collector : public TsPacketHandler {
+		std::vector<uint8_t> packets;
+		virtual void onTsPacket(int64_t clock, TsPacket packet) {
+			packets.insert(packets.end(), packet.data, packet.data + TS_PACKET_LENGTH);
+		}
+	};
+
+	srand(0);
+	auto ts = MakeSyntheticTs(3000, 0, 0);
+	int numOut = (int)ts.size() / TS_PACKET_LENGTH - 1; // Ō̃pPbgflush܂ŏoȂ
+	const int capacities[] = { 100, numOut, 5000 };
+	for (int capacity : capacities) {
+		TsPacketBuffer buffer(ctx);
+		Collector input, replay;
+		buffer.setNumBufferingPackets(capacity);
+		buffer.setEnableBuffering(true);
+		buffer.setHandler(&input);
+		buffer.inputTS(MemoryChunk(ts.data(), ts.size()));
+		buffer.setHandler(&replay);
+		buffer.backAndInput();
+
+		int numKept = std::min(capacity, numOut);
+		if (buffer.numBefferedPackets() != numKept ||
+			replay.packets.size() != (size_t)numKept * TS_PACKET_LENGTH ||
+			memcmp(replay.packets.data(), ts.data() + (size_t)(numOut - numKept) * TS_PACKET_LENGTH,
+				replay.packets.size()) != 0)
+		{
+			THROWF(TestException, "[CheckTsPacketBuffer] replayed packets do not match (capacity=%d)", capacity);
+		}
+		buffer.setEnableBuffering(false);
+		if (buffer.numBefferedPackets() != 0) {
+			THROWF(TestException, "[CheckTsPacketBuffer] buffer is not cleared (capacity=%d)", capacity);
+		}
+	}
+	return 0;
+}
+
+// H264NalScanneřʂG~[Vh~oCgS菜Ă番ʂƈv邩
+static int CheckH264NalScanner(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	struct RefUnit {
+		int type;
+		std::vector<uint8_t> payload; // rbsp_trailing_bits
+	};
+	// JnR[hŕĖ0i0NALjbg͖j
+	auto makeRef = [](const std::vector<uint8_t>& raw) {
+		std::vector<uint8_t> rbsp;
+		std::vector<int> starts;
+		for (int i = 0; i < (int)raw.size(); ++i) {
+			bool zz = (i >= 2 && raw[i - 1] == 0 && raw[i - 2] == 0);
+			if (zz && raw[i] == 3) continue;
+			if (zz && raw[i] == 1) {
+				starts.push_back((int)rbsp.size() + 1);
+			}
+			rbsp.push_back(raw[i]);
+		}
+		std::vector<RefUnit> units;
+		for (int k = 0; k < (int)starts.size(); ++k) {
+			int begin = starts[k];
+			int end = (k + 1 < (int)starts.size()) ? starts[k + 1] - 1 : (int)rbsp.size();
+			while (end > begin && rbsp[end - 1] == 0) --end;
+			if (end == begin) continue;
+			RefUnit unit;
+			unit.type = rbsp[begin] & 0x1F;
+			unit.payload.assign(rbsp.begin() + begin, rbsp.begin() + end);
+			uint8_t& last = unit.payload.back();
+			if (last == 0x80) {
+				unit.payload.pop_back();
+			}
+			else {
+				last &= last - 1;
+			}
+			units.push_back(unit);
+		}
+		return units;
+	};
+
+	// JnR[hƃG~[Vh~oCgof[^
+	const uint8_t symbols[] = { 0, 0, 0, 1, 3, 0x80, 0x06, 0x41, 0x65, 0x67, 0x68 };
+	H264NalScanner scanner;
+	srand(0);
+	for (int t = 0; t < 10000; ++t) {
+		std::vector<uint8_t> raw(4 + rand() % 1000);
+		for (auto& b : raw) {
+			b = (rand() % 4) ? symbols[rand() % sizeof(symbols)] : (uint8_t)rand();
+		}
+		raw[0] = raw[1] = 0; raw[2] = 1;
+
+		for (int begin = 2; begin < (int)raw.size(); begin += 13) {
+			int ref = FindNalCode(raw.data(), begin, (int)raw.size());
+			if (FindNalCode_SSE2(raw.data(), begin, (int)raw.size()) != ref ||
+				(IsAVX2Available() && FindNalCode_AVX2(raw.data(), begin, (int)raw.size()) != ref))
+			{
+				THROWF(TestException, "[CheckH264NalScanner] FindNalCode does not match (t=%d)", t);
+			}
+		}
+
+		auto ref = makeRef(raw);
+		auto copy = raw;
+		scanner.scan(MemoryChunk(copy.data(), copy.size()));
+		if (scanner.numUnits() != (int)ref.size()) {
+			THROWF(TestException, "[CheckH264NalScanner] number of NAL units does not match (t=%d)", t);
+		}
+		for (int i = 0; i < (int)ref.size(); ++i) {
+			const auto& nal = scanner.get(i);
+			if (nal.type != ref[i].type || nal.length != (int)ref[i].payload.size()) {
+				THROWF(TestException, "[CheckH264NalScanner] NAL unit does not match (t=%d,i=%d)", t, i);
+			}
+			if (nal.unescaped && memcmp(scanner.data(i), ref[i].payload.data(), nal.length) != 0) {
+				THROWF(TestException, "[CheckH264NalScanner] payload does not match (t=%d,i=%d)", t, i);
+			}
+		}
+		if (copy != raw) {
+			THROWF(TestException, "[CheckH264NalScanner] input data is modified (t=%d)", t);
+		}
+	}
+	return 0;
+}
+
+static int TsResyncPerformance(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	srand(0);
+
+	// MԂ̈z肵Đ\pPbgƂɑʂ̃S~
+	auto noisy = MakeSyntheticTs(100000, 20, 4000);
+	const uint8_t* data = noisy.data();
+	int size = (int)noisy.size();
+
+	struct Kernel {
+		const char* name;
+		int(*func)(const uint8_t* data, int size, int numPackets);
+	};
+	std::vector<Kernel> kernels = {
+		{ "C", FindTsSyncPosition },
+		{ "SSE2", FindTsSyncPosition_SSE2 },
+	};
+	if (IsAVX2Available()) {
+		kernels.push_back({ "AVX2", FindTsSyncPosition_AVX2 });
+	}
+
+	// Sʒu
+	std::vector<std::vector<int>> results(kernels.size());
+	for (int k = 0; k < (int)kernels.size(); ++k) {
+		Stopwatch sw;
+		sw.start();
+		for (int pos = 0; ; ) {
+			int ret = kernels[k].func(data + pos, size - pos, 8);
+			if (ret == -1) break;
+			results[k].push_back(pos + ret);
+			pos += ret + 1;
+		}
+		sw.stop();
+		printf("%s: %f sec (%d sync positions)\n",
+			kernels[k].name, sw.getTotal(), (int)results[k].size());
+		if (results[k] != results[0]) {
+			THROWF(TestException, "[TsResyncPerformance] %s result does not match", kernels[k].name);
+		}
+	}
+
+	// p[TS
+	TsPacketCollector parser(ctx);
+	Stopwatch sw;
+	sw.start();
+	for (int pos = 0; pos < size; pos += 4 * 1024 * 1024) {
+		parser.inputTS(MemoryChunk(noisy.data() + pos, std::min(size - pos, 4 * 1024 * 1024)));
+	}
+	parser.flush();
+	sw.stop();
+	printf("TsPacketParser: %f sec (%.1f MB/s)\n",
+		sw.getTotal(), size / sw.getTotal() / (1024 * 1024));
+
+	// 16PID1PIDʂidꂽ1T[rXoꍇzj
+	PidFilter filter;
+	filter.set(0x100);
+	TsPacketCollector filtered(ctx);
+	filtered.setPidFilter(&filter);
+	sw.reset();
+	sw.start();
+	for (int pos = 0; pos < size; pos += 4 * 1024 * 1024) {
+		filtered.inputTS(MemoryChunk(noisy.data() + pos, std::min(size - pos, 4 * 1024 * 1024)));
+	}
+	filtered.flush();
+	sw.stop();
+	printf("TsPacketParser with PID filter: %f sec (%.1f MB/s, %d skipped)\n",
+		sw.getTotal(), size / sw.getTotal() / (1024 * 1024), filtered.numSkipped);
+
+	return 0;
+}
+
+static int LogoCorrelationPerformance(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	srand(0);
+
+	// T^IȃS̈悭炢̃TCY
+	const int w = 256, h = 96;
+	const int numFrames = 2000;
+	// CalcCorrelation5x5_AVX͌3vf͂ݏoēǂ
+	std::vector<float> img(w * h + 8);
+	for (auto& v : img) v = (float)(rand() % 256);
+
+	struct Kernel {
+		const char* name;
+		CalcCorrelation5x5RowFunc func;
+	};
+	std::vector<Kernel> kernels = {
+		{ "C", CalcCorrelation5x5Row },
+	};
+	if (IsAVXAvailable()) {
+		kernels.push_back({ "AVX", CalcCorrelation5x5Row_AVX });
+	}
+	if (IsAVX2Available()) {
+		kernels.push_back({ "AVX2", CalcCorrelation5x5Row_AVX2 });
+	}
+	if (IsAVX512Available()) {
+		kernels.push_back({ "AVX512", CalcCorrelation5x5Row_AVX512 });
+	}
+
+	// rbgviԂ̈ʒuƒ̓_AE[܂œ͂̂܂߂j
+	for (int t = 0; t < 10000; ++t) {
+		int y = 2 + rand() % (h - 4);
+		int x = 2 + rand() % (w - 4);
+		int n = 1 + rand() % std::min(64, w - 2 - x);
+		std::vector<float> kT((n + 15) / 16 * 16 * 25);
+		for (auto& v : kT) v = (rand() % 2001 - 1000) / 1000.0f;
+		float ref[64], refavg[64];
+		kernels[0].func(kT.data(), img.data(), x, y, w, n, ref, refavg);
+		for (int k = 1; k < (int)kernels.size(); ++k) {
+			float sums[65], avgs[65];
+			sums[n] = avgs[n] = -1.0f;
+			kernels[k].func(kT.data(), img.data(), x, y, w, n, sums, avgs);
+			if (memcmp(ref, sums, n * sizeof(float)) || memcmp(refavg, avgs, n * sizeof(float))) {
+				THROWF(TestException, "[LogoCorrelationPerformance] %s result does not match (x=%d,y=%d,n=%d)",
+					kernels[k].name, x, y, n);
+			}
+			if (sums[n] != -1.0f || avgs[n] != -1.0f) {
+				THROWF(TestException, "[LogoCorrelationPerformance] %s wrote past the end", kernels[k].name);
+			}
+		}
+	}
+
+	// xiړ_̔䗦LogoFrameƓ35%j
+	std::vector<std::pair<int, int>> points;
+	for (int y = 2; y < h - 2; ++y) {
+		for (int x = 2; x < w - 2; ++x) {
+			if (rand() % 100 < 35) points.emplace_back(x, y);
+		}
+	}
+	std::vector<float> k5((points.size() + 8) * 25);
+	for (auto& v : k5) v = (rand() % 2001 - 1000) / 1000.0f;
+	{
+		auto func = IsAVXAvailable() ? CalcCorrelation5x5_AVX : CalcCorrelation5x5;
+		Stopwatch sw;
+		sw.start();
+		float total = 0;
+		for (int f = 0; f < numFrames; ++f) {
+			for (int i = 0; i < (int)points.size(); ++i) {
+				float avg;
+				total += func(&k5[i * 25], img.data(), points[i].first, points[i].second, w, &avg);
+			}
+		}
+		sw.stop();
+		printf("Per pixel (%s): %f sec (%g)\n", IsAVXAvailable() ? "AVX" : "C", sw.getTotal(), total);
+	}
+	// ԂƁiړ_AԂɂ܂Ƃ߂j
+	std::vector<std::pair<int, int>> runs; // (_̃CfbNX, )
+	for (int i = 0; i < (int)points.size(); ) {
+		int j = i + 1;
+		while (j < (int)points.size() && j - i < 64 &&
+			points[j].second == points[i].second && points[j].first == points[j - 1].first + 1) ++j;
+		runs.emplace_back(i, j - i);
+		i = j;
+	}
+	std::vector<float> kT(runs.size() * 64 * 25);
+	for (auto& v : kT) v = (rand() % 2001 - 1000) / 1000.0f;
+	for (int k = 0; k < (int)kernels.size(); ++k) {
+		Stopwatch sw;
+		sw.start();
+		float total = 0;
+		for (int f = 0; f < numFrames; ++f) {
+			for (int r = 0; r < (int)runs.size(); ++r) {
+				float sums[64], avgs[64];
+				const auto& pt = points[runs[r].first];
+				kernels[k].func(&kT[r * 64 * 25], img.data(), pt.first, pt.second, w, runs[r].second, sums, avgs);
+				total += sums[0];
+			}
+		}
+		sw.stop();
+		printf("Row (%s): %f sec (%d runs, %g)\n", kernels[k].name, sw.getTotal(), (int)runs.size(), total);
+	}
+
+	return 0;
+}
+
+static int LogoBackgroundCheck(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	srand(0);
+
+	// Sg͉̎fziPFɋ߂̂GȂ̂܂Łj
+	const int numSamples = 200000;
+	std::vector<std::vector<short>> samples(numSamples);
+	std::vector<int> thys(numSamples);
+	for (int i = 0; i < numSamples; ++i) {
+		int n = 4 + rand() % 800;
+		int base = rand() % 256;
+		int amp = (rand() % 4 == 0) ? rand() % 256 : rand() % 16;
+		samples[i].resize(n);
+		for (auto& v : samples[i]) {
+			v = (short)std::max(0, std::min(255, base + rand() % (amp + 1) - amp / 2));
+		}
+		thys[i] = rand() % 16;
+	}
+
+	// ƔwiF\[głƈv邱
+	std::vector<int> hist;
+	int numAccepted = 0;
+	for (int i = 0; i < numSamples; ++i) {
+		auto sorted = samples[i];
+		int bg0 = -1, bg1 = -1;
+		bool r0 = logo::LogoScan::CheckBackgroundSort(sorted, thys[i], bg0);
+		bool r1 = logo::LogoScan::CheckBackground(samples[i], thys[i], hist, bg1);
+		if (r0 != r1 || (r0 && bg0 != bg1)) {
+			THROWF(TestException, "[LogoBackgroundCheck] result does not match (sample %d: %d,%d vs %d,%d)",
+				i, r0, bg0, r1, bg1);
+		}
+		numAccepted += r0;
+	}
+	printf("%d/%d accepted\n", numAccepted, numSamples);
+
+	// x
+	{
+		Stopwatch sw;
+		sw.start();
+		int total = 0;
+		for (int i = 0; i < numSamples; ++i) {
+			auto sorted = samples[i];
+			int bg = 0;
+			total += logo::LogoScan::CheckBackgroundSort(sorted, thys[i], bg) ? bg : 0;
+		}
+		sw.stop();
+		printf("sort: %f sec (%d)\n", sw.getTotal(), total);
+	}
+	{
+		Stopwatch sw;
+		sw.start();
+		int total = 0;
+		for (int i = 0; i < numSamples; ++i) {
+			auto copied = samples[i]; // 𑵂邽߃Rs[
+			int bg = 0;
+			total += logo::LogoScan::CheckBackground(copied, thys[i], hist, bg) ? bg : 0;
+		}
+		sw.stop();
+		printf("histogram: %f sec (%d)\n", sw.getTotal(), total);
+	}
+
+	return 0;
+}
+
+static int LogoFilterPerformance(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	srand(0);
+
+	typedef logo::LogoFrame::FrameResult FrameResult;
+
+	// rawScoresiwriteResultƓO[̒lŖ߂j
+	auto makeScores = [](int numFrames, int halfWinFrames) {
+		std::vector<float> raw(numFrames + halfWinFrames * 2);
+		float level = 0;
+		for (int i = 0; i < numFrames; ++i) {
+			// SԂۂXx؂ւămCY悹
+			if (rand() % 500 == 0) level = (float)(rand() % 3 - 1) * 0.8f;
+			float v = level + (rand() % 2001 - 1000) / 2000.0f;
+			// lԏꍇmF邽ߗʎq
+			// iwriteResultrawScores-0͏oĂȂ̂+0ɂ낦j
+			raw[halfWinFrames + i] = (rand() % 4 == 0) ? std::round(v * 8) / 8 + 0.0f : v;
+		}
+		std::fill(raw.begin(), raw.begin() + halfWinFrames, raw[halfWinFrames]);
+		std::fill(raw.begin() + halfWinFrames + numFrames, raw.end(), raw[halfWinFrames + numFrames - 1]);
+		return raw;
+	};
+
+	// ʂ̈v
+	for (int t = 0; t < 500; ++t) {
+		int numFrames = 1 + rand() % 5000;
+		int halfAvg = 1 + rand() % 60;
+		int halfMedian = rand() % 60;
+		int halfWin = std::max(halfAvg, halfMedian);
+		auto raw = makeScores(numFrames, halfWin);
+		std::vector<FrameResult> r0(numFrames), r1(numFrames);
+		logo::LogoFrame::FilterScoresSort(&raw[halfWin], numFrames, halfAvg, halfMedian, 0.2f, 0.5f, r0.data());
+		logo::LogoFrame::FilterScores(&raw[halfWin], numFrames, halfAvg, halfMedian, 0.2f, 0.5f, r1.data());
+		for (int i = 0; i < numFrames; ++i) {
+			if (r0[i].result != r1[i].result || memcmp(&r0[i].score, &r1[i].score, sizeof(float))) {
+				THROWF(TestException, "[LogoFilterPerformance] result does not match (frame %d/%d, avg=%d, median=%d)",
+					i, numFrames, halfAvg, halfMedian);
+			}
+		}
+	}
+
+	// xi360fpsAEBhE͒ʏݒƑ傫ݒj
+	int numFrames = 60 * 60 * 60 * 3;
+	int halves[] = { 30, 300 };
+	for (int half : halves) {
+		auto raw = makeScores(numFrames, half);
+		std::vector<FrameResult> r(numFrames);
+		Stopwatch sw;
+		sw.start();
+		logo::LogoFrame::FilterScoresSort(&raw[half], numFrames, half, half, 0.2f, 0.5f, r.data());
+		sw.stop();
+		printf("window %d: sort %f sec, ", half * 2 + 1, sw.getTotal());
+		sw.reset();
+		sw.start();
+		logo::LogoFrame::FilterScores(&raw[half], numFrames, half, half, 0.2f, 0.5f, r.data());
+		sw.stop();
+		printf("sliding %f sec\n", sw.getTotal());
+	}
+
+	return 0;
+}
+
+class SplitResultChecker : public AMTSplitter {
+public:
+	SplitResultChecker(AMTContext& ctx, const ConfigWrapper& setting)
+		: AMTSplitter(ctx, setting)
+	{ }
+
+	void run(int numChunks) {
+		if (numChunks > 1) {
+			readParallel(numChunks);
+		}
+		else {
+			readAll();
+		}
+	}
+
+	void check(const SplitResultChecker& ref, int numChunks) const {
+		if (videoFrameList_.size() != ref.videoFrameList_.size()) {
+			THROWF(TestException, "[ParallelSplit] number of video frames does not match (chunks=%d %d vs %d)",
+				numChunks, (int)videoFrameList_.size(), (int)ref.videoFrameList_.size());
+		}
+		for (int i = 0; i < (int)videoFrameList_.size(); ++i) {
+			const auto& a = videoFrameList_[i];
+			const auto& b = ref.videoFrameList_[i];
+			if (a.PTS != b.PTS || a.DTS != b.DTS || a.type != b.type || a.pic != b.pic) {
+				THROWF(TestException, "[ParallelSplit] video frame %d does not match (chunks=%d)", i, numChunks);
+			}
+		}
+		if (audioFrameList_.size() != ref.audioFrameList_.size()) {
+			THROWF(TestException, "[ParallelSplit] number of audio frames does not match (chunks=%d %d vs %d)",
+				numChunks, (int)audioFrameList_.size(), (int)ref.audioFrameList_.size());
+		}
+		for (int i = 0; i < (int)audioFrameList_.size(); ++i) {
+			const auto& a = audioFrameList_[i];
+			const auto& b = ref.audioFrameList_[i];
+			// f[^͂̂܂ܘÂňʒuv
+			if (a.PTS != b.PTS || a.audioIdx != b.audioIdx ||
+				a.codedDataSize != b.codedDataSize || a.fileOffset != b.fileOffset) {
+				THROWF(TestException, "[ParallelSplit] audio frame %d does not match (chunks=%d)", i, numChunks);
+			}
+		}
+		if (streamEventList_.size() != ref.streamEventList_.size()) {
+			THROWF(TestException, "[ParallelSplit] number of stream events does not match (chunks=%d %d vs %d)",
+				numChunks, (int)streamEventList_.size(), (int)ref.streamEventList_.size());
+		}
+		if (videoFileCount_ != ref.videoFileCount_) {
+			THROWF(TestException, "[ParallelSplit] number of video files does not match (chunks=%d)", numChunks);
+		}
+		if (captionTextList_.size() != ref.captionTextList_.size()) {
+			THROWF(TestException, "[ParallelSplit] number of captions does not match (chunks=%d)", numChunks);
+		}
+		checkIndex(ref, numChunks);
+		printf("chunks=%d OK (video %d frames, audio %d frames)\n",
+			numChunks, (int)videoFrameList_.size(), (int)audioFrameList_.size());
+	}
+
+	// TSCfbNXʏ̕ƓɂȂ邩
+	void checkIndex(const SplitResultChecker& ref, int numChunks) const {
+		const auto& a = tsIndex_;
+		const auto& b = ref.tsIndex_;
+		if (a.keyFrames.size() != b.keyFrames.size()) {
+			THROWF(TestException, "[ParallelSplit] number of index key frames does not match (chunks=%d %d vs %d)",
+				numChunks, (int)a.keyFrames.size(), (int)b.keyFrames.size());
+		}
+		for (int i = 0; i < (int)a.keyFrames.size(); ++i) {
+			if (a.keyFrames[i].offset != b.keyFrames[i].offset || a.keyFrames[i].PTS != b.keyFrames[i].PTS) {
+				THROWF(TestException, "[ParallelSplit] index key frame %d does not match (chunks=%d)", i, numChunks);
+			}
+		}
+		// `NEŉԂ͕̏ς̂ŃXg[Ƃɔr
+		auto sortAudio = [](std::vector<TsIndexAudio> list) {
+			std::stable_sort(list.begin(), list.end(), [](const TsIndexAudio& x, const TsIndexAudio& y) {
+				return x.audioIdx < y.audioIdx;
+			});
+			return list;
+		};
+		auto audioA = sortAudio(a.audioPes);
+		auto audioB = sortAudio(b.audioPes);
+		if (audioA.size() != audioB.size()) {
+			THROWF(TestException, "[ParallelSplit] number of index audio PES does not match (chunks=%d)", numChunks);
+		}
+		for (int i = 0; i < (int)audioA.size(); ++i) {
+			if (audioA[i].offset != audioB[i].offset || audioA[i].PTS != audioB[i].PTS ||
+				audioA[i].numFrames != audioB[i].numFrames) {
+				THROWF(TestException, "[ParallelSplit] index audio PES %d does not match (chunks=%d)", i, numChunks);
+			}
+		}
+		if (a.captions.size() != b.captions.size()) {
+			THROWF(TestException, "[ParallelSplit] number of index captions does not match (chunks=%d)", numChunks);
+		}
+		for (int i = 0; i < (int)a.captions.size(); ++i) {
+			if (a.captions[i].offset != b.captions[i].offset) {
+				THROWF(TestException, "[ParallelSplit] index caption %d does not match (chunks=%d)", i, numChunks);
+			}
+		}
+	}
+
+	// CfbNẌʒuۂPES̐擪ɂȂĂ邩
+	void checkIndexOffsets() const {
+		File file(setting_.getSrcFilePath(), _T("rb"));
+		uint8_t buf[TS_PACKET_LENGTH];
+		auto checkPesStart = [&](int64_t offset, int pid, const char* name, int i) {
+			file.seek(offset, SEEK_SET);
+			file.read(MemoryChunk(buf, TS_PACKET_LENGTH));
+			TsPacket packet(buf);
+			if (!packet.parse() || !packet.check() ||
+				!packet.payload_unit_start_indicator() || packet.PID() != pid) {
+				THROWF(TestException, "[TsIndex] %s %d is not a PES start", name, i);
+			}
+		};
+		for (int i = 0; i < (int)tsIndex_.keyFrames.size(); ++i) {
+			const auto& e = tsIndex_.keyFrames[i];
+			checkPesStart(e.offset, tsIndex_.findProgram(e.offset)->videoPid, "key frame", i);
+		}
+		for (int i = 0; i < (int)tsIndex_.audioPes.size(); ++i) {
+			const auto& e = tsIndex_.audioPes[i];
+			checkPesStart(e.offset, tsIndex_.findProgram(e.offset)->audioPid[e.audioIdx], "audio PES", i);
+		}
+		for (int i = 0; i < (int)tsIndex_.captions.size(); ++i) {
+			const auto& e = tsIndex_.captions[i];
+			checkPesStart(e.offset, tsIndex_.findProgram(e.offset)->captionPid, "caption", i);
+		}
+		printf("index OK (%d key frames, %d audio PES, %d captions)\n", (int)tsIndex_.keyFrames.size(),
+			(int)tsIndex_.audioPes.size(), (int)tsIndex_.captions.size());
+	}
+
+	// ۑēǂݒCfbNXv邩
+	void checkIndexSaveLoad() {
+		saveTsIndex();
+		TsIndex loaded;
+		const tstring& srcpath = setting_.getSrcFilePath();
+		tstring path = TsIndex::GetIndexPath(srcpath);
+		if (!loaded.load(path, srcpath)) {
+			THROW(TestException, "[TsIndex] failed to load index");
+		}
+		removeT(path.c_str());
+		if (loaded.programs.size() != tsIndex_.programs.size() ||
+			loaded.clocks.size() != tsIndex_.clocks.size() ||
+			loaded.keyFrames.size() != tsIndex_.keyFrames.size() ||
+			loaded.audioPes.size() != tsIndex_.audioPes.size() ||
+			loaded.captions.size() != tsIndex_.captions.size() ||
+			memcmp(loaded.keyFrames.data(), tsIndex_.keyFrames.data(),
+				loaded.keyFrames.size() * sizeof(TsIndexVideo)) != 0)
+		{
+			THROW(TestException, "[TsIndex] loaded index does not match");
+		}
+		// _Ȉʒu璼ÕL[t[邩
+		for (int i = 1; i < (int)loaded.keyFrames.size(); ++i) {
+			int64_t mid = (loaded.keyFrames[i - 1].offset + loaded.keyFrames[i].offset) / 2;
+			if (loaded.findKeyFrame(mid) != &loaded.keyFrames[i - 1]) {
+				THROWF(TestException, "[TsIndex] findKeyFrame failed (%d)", i);
+			}
+		}
+	}
+
+	// oꂽwavef[^𓯊fR[hʂƔr
+	void checkWave() {
+		audioFile_.flush();
+		waveFile_.flush();
+		File audioFile(getAudioFilePath(setting_, -1), _T("rb"));
+		File waveFile(getWaveFilePath(setting_, -1), _T("rb"));
+
+		std::vector<std::unique_ptr<AdtsParser>> parsers;
+		std::vector<AudioFrameData> frames;
+		std::vector<uint8_t> coded, wave;
+		for (int i = 0; i < (int)audioFrameList_.size(); ++i) {
+			const auto& info = audioFrameList_[i];
+			while ((int)parsers.size() <= info.audioIdx) {
+				parsers.emplace_back(new AdtsParser(ctx));
+			}
+			coded.resize(info.codedDataSize);
+			audioFile.seek(info.fileOffset, SEEK_SET);
+			audioFile.read(MemoryChunk(coded.data(), coded.size()));
+			parsers[info.audioIdx]->inputFrame(MemoryChunk(coded.data(), coded.size()), frames, -1);
+			int expected = (frames.size() > 0) ? frames[0].decodedDataSize : 0;
+			if (info.waveDataSize != expected) {
+				THROWF(TestException, "[AsyncAudioDecode] wave size of audio frame %d does not match (%d vs %d)",
+					i, info.waveDataSize, expected);
+			}
+			if (expected > 0) {
+				wave.resize(expected);
+				waveFile.seek(info.waveOffset, SEEK_SET);
+				waveFile.read(MemoryChunk(wave.data(), wave.size()));
+				if (memcmp(wave.data(), frames[0].decodedData, expected) != 0) {
+					THROWF(TestException, "[AsyncAudioDecode] wave of audio frame %d does not match", i);
+				}
+			}
+		}
+		printf("wave OK (%d audio streams, %d frames)\n", (int)parsers.size(), (int)audioFrameList_.size());
+	}
+
+	void enableVirtualDemux() {
+		setVirtualDemux(true);
+	}
+
+	// ԉft@Ciz[hȂCfbNXj
+	void closeIntVideo() {
+		writeHandler.close();
+	}
+
+	int getNumIntVideoFiles() const {
+		return videoFileCount_;
+	}
+
+	// eft[̈ʒuPSpack擪wĂ邩
+	void checkPackOffsets(int fileIdx, MemoryChunk ps) const {
+		int frameBegin = videoFileStartFrame_[fileIdx];
+		int frameEnd = (fileIdx + 1 < videoFileCount_) ?
+			videoFileStartFrame_[fileIdx + 1] : (int)videoFrameList_.size();
+		for (int f = frameBegin; f < frameEnd; ++f) {
+			int64_t offset = videoFrameList_[f].fileOffset;
+			if (offset + 4 > (int64_t)ps.length || read32(ps.data + offset) != PACK_START_CODE) {
+				THROWF(TestException, "[VirtualDemux] frame %d does not point to a pack header", f);
+			}
+		}
+	}
+};
+
+// PS̉fPES̃yC[hA
+static std::vector<uint8_t> ExtractPsVideoEs(MemoryChunk ps)
+{
+	std::vector<uint8_t> es;
+	size_t pos = 0;
+	while (pos + 4 <= ps.length) {
+		uint32_t code = read32(ps.data + pos);
+		if (code == PACK_START_CODE) {
+			pos += 14 + (ps.data[pos + 13] & 7);
+		}
+		else if (code == MPEG_PROGRAM_END_CODE) {
+			break;
+		}
+		else if ((code >> 8) == 1 && pos + 6 <= ps.length) {
+			size_t end = pos + 6 + read16(ps.data + pos + 4);
+			if (end > ps.length) {
+				THROW(TestException, "[VirtualDemux] truncated PES");
+			}
+			if (code == 0x1E0) {
+				es.insert(es.end(), ps.data + pos + 9 + ps.data[pos + 8], ps.data + end);
+			}
+			pos = end;
+		}
+		else {
+			THROW(TestException, "[VirtualDemux] broken PS");
+		}
+	}
+	return es;
+}
+
+// z[hTSč\PS̉fԉft@Cƈv邩
+static int VirtualDemuxTest(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	std::vector<std::vector<uint8_t>> refEs;
+	{
+		SplitResultChecker ref(ctx, setting);
+		if (setting.getServiceId() > 0) {
+			ref.setServiceId(setting.getServiceId());
+		}
+		ref.run(1);
+		ref.closeIntVideo();
+		for (int i = 0; i < ref.getNumIntVideoFiles(); ++i) {
+			File file(setting.getIntVideoFilePath(i), _T("rb"));
+			std::vector<uint8_t> ps((size_t)file.size());
+			file.read(MemoryChunk(ps.data(), ps.size()));
+			refEs.push_back(ExtractPsVideoEs(MemoryChunk(ps.data(), ps.size())));
+		}
+	}
+
+	const int chunkCounts[] = { 1, 3 };
+	for (int numChunks : chunkCounts) {
+		SplitResultChecker splitter(ctx, setting);
+		if (setting.getServiceId() > 0) {
+			splitter.setServiceId(setting.getServiceId());
+		}
+		splitter.enableVirtualDemux();
+		splitter.run(numChunks);
+		splitter.closeIntVideo();
+		if (splitter.getNumIntVideoFiles() != (int)refEs.size()) {
+			THROWF(TestException, "[VirtualDemux] number of video files does not match (chunks=%d)", numChunks);
+		}
+		int64_t indexSize = 0, psSize = 0;
+		for (int i = 0; i < (int)refEs.size(); ++i) {
+			tstring path = setting.getIntVideoFilePath(i);
+			if (!VirtualPsIndex::IsIndexFile(path)) {
+				THROWF(TestException, "[VirtualDemux] index %d was not written (chunks=%d)", i, numChunks);
+			}
+			indexSize += File(path, _T("rb")).size();
+			av::VirtualPsReader reader(ctx, path);
+			std::vector<uint8_t> ps((size_t)reader.Size());
+			if (reader.ReadAt(0, MemoryChunk(ps.data(), ps.size())) != (int)ps.size()) {
+				THROWF(TestException, "[VirtualDemux] failed to read virtual PS %d (chunks=%d)", i, numChunks);
+			}
+			psSize += ps.size();
+			splitter.checkPackOffsets(i, MemoryChunk(ps.data(), ps.size()));
+			if (ExtractPsVideoEs(MemoryChunk(ps.data(), ps.size())) != refEs[i]) {
+				THROWF(TestException, "[VirtualDemux] video stream %d does not match (chunks=%d)", i, numChunks);
+			}
+		}
+		printf("chunks=%d OK (index %.1fKB for %.1fMB PS)\n",
+			numChunks, indexSize / 1024.0, psSize / (1024.0 * 1024.0));
+	}
+	return 0;
+}
+
+// 񕪊̌ʂʏ̕ƈv邩
+static int ParallelSplit(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	Stopwatch sw;
+	sw.start();
+	SplitResultChecker ref(ctx, setting);
+	if (setting.getServiceId() > 0) {
+		ref.setServiceId(setting.getServiceId());
+	}
+	ref.run(1);
+	printf("serial: %f sec\n", sw.getAndReset());
+
+	const int chunkCounts[] = { 2, 3, 8 };
+	for (int numChunks : chunkCounts) {
+		// o͐̈ꎞt@C͓Ȃ̂1
+		SplitResultChecker splitter(ctx, setting);
+		if (setting.getServiceId() > 0) {
+			splitter.setServiceId(setting.getServiceId());
+		}
+		sw.start();
+		splitter.run(numChunks);
+		printf("parallel(%d): %f sec\n", numChunks, sw.getAndReset());
+		splitter.check(ref, numChunks);
+	}
+
+	return 0;
+}
+
+// XbhƕʂɃfR[hwavefR[hʂƈv邩
+static int AsyncAudioDecode(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	Stopwatch sw;
+	sw.start();
+	SplitResultChecker splitter(ctx, setting);
+	if (setting.getServiceId() > 0) {
+		splitter.setServiceId(setting.getServiceId());
+	}
+	splitter.run(1);
+	printf("split: %f sec\n", sw.getAndReset());
+	splitter.checkWave();
+	return 0;
+}
+
+// ɍTSCfbNẌʒuAۑēǂݒ邩
+static int TsIndexTest(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	SplitResultChecker splitter(ctx, setting);
+	if (setting.getServiceId() > 0) {
+		splitter.setServiceId(setting.getServiceId());
+	}
+	splitter.run(1);
+	splitter.checkIndexOffsets();
+	splitter.checkIndexSaveLoad();
+	return 0;
+}
 
-	//uint16_t a = read16(data);
-	//uint32_t b = read24(data);
-	//uint32_t c = read32(data);
-	//uint64_t d = read40(data);
-	uint64_t e = read48(data);
+// pPbgPIDW߂
+class CaptionPidCollector : public SubtitleDetectorSplitter {
+public:
+	CaptionPidCollector(AMTContext& ctx, const ConfigWrapper& setting)
+		: SubtitleDetectorSplitter(ctx, setting)
+	{ }
 
-	fprintf(stderr, "sum=%f\n", double(e));
+	void readAllPackets() {
+		TsFileReader reader(ctx, setting_);
+		reader.read(*this, 0, reader.size(), [] { return true; });
+	}
+
+	const std::set<int>& getPids() const {
+		return pids_;
+	}
+
+protected:
+	std::set<int> pids_;
+
+	virtual void onCaptionPacket(int64_t clock, TsPacket packet) {
+		pids_.insert(packet.PID());
+	}
+};
+
+// t@C̑O̎pPbgNULLpPbgɂāA͈͂ォn܂TS
+// o͐-aŎw
+static int MakeLateCaptionTs(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	CaptionPidCollector collector(ctx, setting);
+	if (setting.getServiceId() > 0) {
+		collector.setServiceId(setting.getServiceId());
+	}
+	collector.readAllPackets();
+	const std::set<int>& pids = collector.getPids();
+	if (pids.size() == 0) {
+		THROW(TestException, "[LateCaptionTs] source has no captions");
+	}
+
+	File src(setting.getSrcFilePath(), _T("rb"));
+	File dst(setting.getModeArgs(), _T("wb"));
+	int64_t size = src.size();
+	int64_t cut = size / 2;
+	int numRemoved = 0, numKept = 0;
+	std::vector<uint8_t> buf(TS_PACKET_LENGTH * 1024);
+	for (int64_t pos = 0; pos < size; ) {
+		size_t sz = (size_t)std::min<int64_t>(buf.size(), size - pos);
+		src.read(MemoryChunk(buf.data(), sz));
+		for (size_t off = 0; off + TS_PACKET_LENGTH <= sz; off += TS_PACKET_LENGTH) {
+			uint8_t* p = &buf[off];
+			if (p[0] != 0x47) {
+				THROWF(TestException, "[LateCaptionTs] lost sync at %lld", pos + (int64_t)off);
+			}
+			if (pids.count(TsPacket(p).PID()) == 0) {
+				continue;
+			}
+			if (pos + (int64_t)off < cut) {
+				// PID0x1FFF
+				p[1] = (p[1] & 0xE0) | 0x1F;
+				p[2] = 0xFF;
+				++numRemoved;
+			}
+			else {
+				++numKept;
+			}
+		}
+		dst.write(MemoryChunk(buf.data(), sz));
+		pos += sz;
+	}
+	printf("removed %d caption packets, kept %d\n", numRemoved, numKept);
+	if (numKept == 0) {
+		THROW(TestException, "[LateCaptionTs] no captions after the cut");
+	}
+	return 0;
+}
 
+// probe_all̎肪probe_subtitlesiSubtitleDetectorSplitterjƈv邩
+static int ProbeAllSubtitleTest(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	SubtitleDetectorSplitter detector(ctx, setting);
+	ProbeSplitter probe(ctx, setting);
+	if (setting.getServiceId() > 0) {
+		detector.setServiceId(setting.getServiceId());
+		probe.setServiceId(setting.getServiceId());
+	}
+	detector.readAll(setting.getMaxFrames());
+	probe.readAll(setting.getMaxFrames());
+	printf("probe_subtitles: %s, probe_all: %s\n",
+		detector.getHasSubtitle() ? "true" : "false", probe.getHasSubtitle() ? "true" : "false");
+	if (detector.getHasSubtitle() != probe.getHasSubtitle()) {
+		THROW(TestException, "[ProbeAllSubtitle] probe_all does not match probe_subtitles");
+	}
 	return 0;
 }
 
-static int CheckAutoBuffer(AMTContext& ctx, const ConfigWrapper& setting)
+// BlockFileWriterŃooɏf[^̂܂܃t@CɂȂĂ邩
+static int CheckBlockFileWriter(AMTContext& ctx, const ConfigWrapper& setting)
 {
 	srand(0);
+	std::vector<uint8_t> data(12 * 1024 * 1024 + 123);
+	for (auto& b : data) b = (uint8_t)rand();
+
+	for (int noCache = 0; noCache < 2; ++noCache) {
+		tstring path = setting.getIntVideoFilePath(noCache);
+		{
+			BlockFileWriter writer(path, 64 * 1024 + 1, noCache != 0);
+			std::vector<MemoryChunk> chunks;
+			for (size_t pos = 0; pos < data.size(); ) {
+				// wb_A炢̃yC[hAubN傫f[^
+				size_t len = (rand() % 16 == 0) ? 300 * 1024 : (rand() % 3 == 0) ? 14 : rand() % 40000;
+				len = std::min(len, data.size() - pos);
+				chunks.push_back(MemoryChunk(data.data() + pos, len));
+				pos += len;
+				if (chunks.size() >= 4 || pos == data.size()) {
+					writer.write(chunks.data(), (int)chunks.size());
+					chunks.clear();
+				}
+			}
+			if (writer.size() != (int64_t)data.size()) {
+				THROWF(TestException, "[CheckBlockFileWriter] size does not match (noCache=%d)", noCache);
+			}
+			writer.close();
+		}
+		File file(path, _T("rb"));
+		std::vector<uint8_t> readData((size_t)file.size());
+		file.read(MemoryChunk(readData.data(), readData.size()));
+		if (readData != data) {
+			THROWF(TestException, "[CheckBlockFileWriter] file content does not match (noCache=%d)", noCache);
+		}
+	}
+	return 0;
+}
 
-	std::unique_ptr<uint8_t[]> buf = std::unique_ptr<uint8_t[]>(new uint8_t[65536]);
-	int addCnt = 0;
-	int delCnt = 0;
-
-	AutoBuffer ab;
-	for (int i = 0; i < 10000; ++i) {
-		int addNum = rand();
-		int delNum = rand();
+// DecodedFrameStoreŕۑt[̂܂ܓǂ߂邩Ar܂ł̃t@C͓ǂ܂Ȃ
+static int DecodedFrameStoreTest(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	auto env = make_unique_ptr(CreateScriptEnvironment2());
+	const int width = 64, height = 48, numFrames = 10;
+	const int refFrame = 8, refTarget = 3; // fR[hłȂt[Ƃ̒u
+	tstring path = setting.getTmpFrameStorePath(0);
+
+	VideoInfo vi = VideoInfo();
+	vi.width = width;
+	vi.height = height;
+	vi.pixel_type = VideoInfo::CS_YV12;
+	VideoInfo qpvi = VideoInfo();
+	qpvi.width = (width + 15) >> 4;
+	qpvi.height = (height + 15) >> 4;
+	qpvi.pixel_type = VideoInfo::CS_Y8;
 
-		for (int c = 0; c < addNum; ++c) {
-			buf[c] = addCnt++;
+	srand(0);
+	std::vector<PVideoFrame> frames;
+	for (int i = 0; i < numFrames; ++i) {
+		PVideoFrame frame = env->NewVideoFrame(vi);
+		const int planes[] = { PLANAR_Y, PLANAR_U, PLANAR_V };
+		for (int p = 0; p < 3; ++p) {
+			uint8_t* dst = frame->GetWritePtr(planes[p]);
+			for (int y = 0; y < frame->GetHeight(planes[p]); ++y) {
+				for (int x = 0; x < frame->GetRowSize(planes[p]); ++x) {
+					dst[x + y * frame->GetPitch(planes[p])] = (uint8_t)rand();
+				}
+			}
 		}
-		//fprintf(stderr, "Add %d\n", addNum);
-		ab.add(MemoryChunk(buf.get(), addNum));
+		frame->SetProperty("FrameType", (int)((i % 3 == 0) ? AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_B));
+		if (i % 2 == 0) {
+			PVideoFrame qp = env->NewVideoFrame(qpvi);
+			for (int y = 0; y < qpvi.height; ++y) {
+				for (int x = 0; x < qpvi.width; ++x) {
+					qp->GetWritePtr()[x + y * qp->GetPitch()] = (uint8_t)(rand() % 52);
+				}
+			}
+			frame->SetProperty("QP_Table", qp);
+			frame->SetProperty("QP_Table_Non_B", qp);
+			frame->SetProperty("QP_Stride", qp->GetPitch());
+			frame->SetProperty("QP_ScaleType", 1);
+		}
+		frames.push_back(frame);
+	}
 
-		uint8_t *data = ab.ptr();
-		for (int c = 0; c < (int)ab.size(); ++c) {
-			if (data[c] != ((delCnt + c) & 0xFF)) {
-				fprintf(stderr, "[CheckAutoBuffer] Result does not match\n");
-				return 1;
+	auto checkPlane = [&](const PVideoFrame& a, const PVideoFrame& b, int plane, int w, int h, int n) {
+		for (int y = 0; y < h; ++y) {
+			if (memcmp(a->GetReadPtr(plane) + y * a->GetPitch(plane),
+				b->GetReadPtr(plane) + y * b->GetPitch(plane), w)) {
+				THROWF(TestException, "[DecodedFrameStoreTest] frame %d plane %d does not match", n, plane);
 			}
 		}
+	};
 
-		delNum = std::min<int>(delNum, (int)ab.size());
-		//fprintf(stderr, "Del %d\n", delNum);
-		ab.trimHead(delNum);
-		delCnt += delNum;
+	{
+		// r܂łĂȂt@C͓ǂݍ݂ɎgȂ
+		DecodedFrameStore store(ctx, path, width, height, numFrames);
+		store.StartWrite();
+		for (int i = 0; i < numFrames / 2; ++i) {
+			store.WriteFrame(frames[i]);
+		}
+	}
+	if (File::exists(path)) {
+		THROWF(TestException, "[DecodedFrameStoreTest] partial file is left at the store path");
+	}
+	{
+		// 2̃\[XɏĂȂ
+		DecodedFrameStore store0(ctx, path, width, height, numFrames);
+		DecodedFrameStore store1(ctx, path, width, height, numFrames);
+		if (store0.IsReadable() || store1.IsReadable()) {
+			THROWF(TestException, "[DecodedFrameStoreTest] partial file is readable");
+		}
+		store0.StartWrite();
+		store1.StartWrite();
+		DecodedFrameStore* stores[] = { &store0, &store1 };
+		for (int i = 0; i < numFrames; ++i) {
+			for (auto store : stores) {
+				if (i == refFrame) {
+					store->WriteRef(refTarget);
+				}
+				else {
+					store->WriteFrame(frames[i]);
+				}
+			}
+			if (i == numFrames / 2) {
+				// ݒ̕ʂ̃\[Xǂݍ݂ɎgȂ
+				DecodedFrameStore store(ctx, path, width, height, numFrames);
+				if (store.IsReadable()) {
+					THROWF(TestException, "[DecodedFrameStoreTest] file being written is readable");
+				}
+			}
+		}
+		for (auto store : stores) {
+			if (store->GetNumWritten() != numFrames) {
+				THROWF(TestException, "[DecodedFrameStoreTest] written frames %d != %d", store->GetNumWritten(), numFrames);
+			}
+		}
+	}
+	{
+		// TCYႤƓǂݍ݂ɎgȂ
+		DecodedFrameStore store(ctx, path, width * 2, height, numFrames);
+		if (store.IsReadable()) {
+			THROWF(TestException, "[DecodedFrameStoreTest] file with different size is readable");
+		}
+	}
+	{
+		DecodedFrameStore store(ctx, path, width, height, numFrames);
+		if (!store.IsReadable()) {
+			THROWF(TestException, "[DecodedFrameStoreTest] complete file is not readable");
+		}
+		for (int i = 0; i < numFrames; ++i) {
+			const PVideoFrame& src = frames[(i == refFrame) ? refTarget : i];
+			PVideoFrame dst = store.ReadFrame(i, vi, true, env.get());
+			checkPlane(src, dst, PLANAR_Y, width, height, i);
+			checkPlane(src, dst, PLANAR_U, width / 2, height / 2, i);
+			checkPlane(src, dst, PLANAR_V, width / 2, height / 2, i);
+			if (dst->GetProperty("FrameType", -1) != src->GetProperty("FrameType", -2)) {
+				THROWF(TestException, "[DecodedFrameStoreTest] frame %d FrameType does not match", i);
+			}
+			PVideoFrame srcqp = src->GetProperty("QP_Table", PVideoFrame());
+			PVideoFrame dstqp = dst->GetProperty("QP_Table", PVideoFrame());
+			if (!srcqp != !dstqp) {
+				THROWF(TestException, "[DecodedFrameStoreTest] frame %d QP_Table existence does not match", i);
+			}
+			if (srcqp) {
+				checkPlane(srcqp, dstqp, PLANAR_Y, qpvi.width, qpvi.height, i);
+				checkPlane(srcqp, dst->GetProperty("QP_Table_Non_B", PVideoFrame()), PLANAR_Y, qpvi.width, qpvi.height, i);
+				if (dst->GetProperty("QP_Stride", -1) != src->GetProperty("QP_Stride", -2) ||
+					dst->GetProperty("QP_ScaleType", -1) != src->GetProperty("QP_ScaleType", -2)) {
+					THROWF(TestException, "[DecodedFrameStoreTest] frame %d QP properties do not match", i);
+				}
+			}
+		}
 	}
-
 	return 0;
 }
 
@@ -443,6 +1855,351 @@ static int LogoFrameTest(AMTContext& ctx, const ConfigWrapper& setting)
 	return 0;
 }
 
+// S͂̕]XbhςĂ]lƌʃt@CSɈv邩
+static int LogoFrameThreadsTest(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	auto env = make_unique_ptr(CreateScriptEnvironment2());
+	PClip clip = env->Invoke("Import", to_string(setting.getFilterScriptPath()).c_str()).AsClip();
+	int numFrames = clip->GetVideoInfo().num_frames;
+	int numLogos = (int)setting.getLogoPath().size();
+
+	const int threads[] = { 1, std::max(2, GetProcessorCount()) };
+	std::unique_ptr<logo::LogoFrame> logof[2];
+	std::vector<uint8_t> result[2];
+	for (int i = 0; i < 2; ++i) {
+		Stopwatch sw;
+		sw.start();
+		logof[i] = std::unique_ptr<logo::LogoFrame>(new logo::LogoFrame(ctx, setting.getLogoPath(), 0.1f));
+		logof[i]->setNumThreads(threads[i]);
+		logof[i]->scanFrames(clip, env.get());
+		logof[i]->writeResult(setting.getTmpLogoFramePath(i));
+		printf("threads=%d: %.2f sec\n", threads[i], sw.getAndReset());
+
+		File file(setting.getTmpLogoFramePath(i), _T("rb"));
+		result[i].resize((size_t)file.size());
+		file.read(MemoryChunk(result[i].data(), result[i].size()));
+	}
+
+	for (int n = 0; n < numFrames; ++n) {
+		for (int l = 0; l < numLogos; ++l) {
+			float r[2][2];
+			logof[0]->getEvalResult(n, l, r[0][0], r[0][1]);
+			logof[1]->getEvalResult(n, l, r[1][0], r[1][1]);
+			if (memcmp(r[0], r[1], sizeof(r[0]))) {
+				THROWF(TestException, "[LogoFrameThreadsTest] frame %d logo %d: (%f,%f) != (%f,%f)",
+					n, l, r[0][0], r[0][1], r[1][0], r[1][1]);
+			}
+		}
+	}
+	if (logof[0]->getBestLogo() != logof[1]->getBestLogo() ||
+		logof[0]->getLogoRatio() != logof[1]->getLogoRatio()) {
+		THROW(TestException, "[LogoFrameThreadsTest] best logo does not match");
+	}
+	if (result[0] != result[1]) {
+		THROW(TestException, "[LogoFrameThreadsTest] writeResult output does not match");
+	}
+
+	return 0;
+}
+
+// Sč쐬̕fade]̃t[Ƃ̒]Ƌe덷ňv邩
+// e덷: ŏfadẽCfbNX͕sv1%ȉ1iKi0.1jȓASA,B͑Sv[ō1e-3ȉ
+static int LogoRemakeTest(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	auto env = make_unique_ptr(CreateScriptEnvironment2());
+	PClip clip = env->Invoke("Import", to_string(setting.getFilterScriptPath()).c_str()).AsClip();
+	VideoInfo vi = clip->GetVideoInfo();
+	if (!vi.IsYV12() || vi.BitsPerComponent() != 8) {
+		THROW(TestException, "[LogoRemakeTest] input must be 8bit YV12");
+	}
+
+	// S̎ɗ]t͈͂XL
+	logo::LogoHeader header;
+	logo::LogoData::Load(setting.getLogoPath()[0], &header);
+	const int margin = 8, thy = 12, logUVx = 1, logUVy = 1;
+	int scanx = std::max(0, header.imgx - margin) & ~1;
+	int scany = std::max(0, header.imgy - margin) & ~1;
+	int scanw = (std::min(vi.width, header.imgx + header.w + margin) - scanx) & ~1;
+	int scanh = (std::min(vi.height, header.imgy + header.h + margin) - scany) & ~1;
+	int numMaxFrames = vi.num_frames;
+
+	// XLt@CiLt[̂݁jƏS
+	tstring workfile = setting.getOutFilePath(0, CMTYPE_BOTH);
+	auto codec = make_unique_ptr(CCodec::CreateInstance(UTVF_ULH0, "Amatsukaze"));
+	logo::LogoScan logoscan(scanw, scanh, logUVx, logUVy, thy);
+	int numFrames = 0;
+	{
+		LosslessVideoFile file(ctx, workfile, _T("wb"));
+		size_t scanDataSize = scanw * scanh * 3 / 2;
+		size_t outSize = codec->EncodeGetOutputSize(UTVF_YV12, scanw, scanh);
+		size_t extraSize = codec->EncodeGetExtraDataSize();
+		auto memScanData = std::unique_ptr<uint8_t[]>(new uint8_t[scanDataSize]);
+		auto memCoded = std::unique_ptr<uint8_t[]>(new uint8_t[outSize]);
+		std::vector<uint8_t> extra(extraSize);
+
+		if (codec->EncodeGetExtraData(extra.data(), extraSize, UTVF_YV12, scanw, scanh)) {
+			THROW(RuntimeException, "failed to EncodeGetExtraData (UtVideo)");
+		}
+		if (codec->EncodeBegin(UTVF_YV12, scanw, scanh, CBGROSSWIDTH_WINDOWS)) {
+			THROW(RuntimeException, "failed to EncodeBegin (UtVideo)");
+		}
+		file.writeHeader(scanw, scanh, numMaxFrames, extra);
+
+		for (int i = 0; i < numMaxFrames; ++i) {
+			PVideoFrame frame = clip->GetFrame(i, env.get());
+			int pitchY = frame->GetPitch(PLANAR_Y);
+			int pitchUV = frame->GetPitch(PLANAR_U);
+			const uint8_t* scanY = frame->GetReadPtr(PLANAR_Y) + scanx + scany * pitchY;
+			const uint8_t* scanU = frame->GetReadPtr(PLANAR_U) + (scanx >> logUVx) + (scany >> logUVy) * pitchUV;
+			const uint8_t* scanV = frame->GetReadPtr(PLANAR_V) + (scanx >> logUVx) + (scany >> logUVy) * pitchUV;
+			if (logoscan.AddFrame(scanY, scanU, scanV, pitchY, pitchUV)) {
+				++numFrames;
+				CopyYV12(memScanData.get(), scanY, scanU, scanV, pitchY, pitchUV, scanw, scanh);
+				bool keyFrame = false;
+				size_t codedSize = codec->EncodeFrame(memCoded.get(), &keyFrame, memScanData.get());
+				file.writeFrame(memCoded.get(), (int)codedSize);
+			}
+		}
+		codec->EncodeEnd();
+	}
+	logoscan.Normalize(255);
+	if (logoscan.GetLogo(false) == nullptr) {
+		THROWF(TestException, "[LogoRemakeTest] insufficient logo frames (%d)", numFrames);
+	}
+
+	// ]ƕ]łꂼ蒼
+	logo::LOGO_ANALYZE_CB cb = [](float progress, int nread, int total, int ngather) { return true; };
+	const bool serial[] = { true, false };
+	std::vector<int> minFades[2];
+	std::unique_ptr<logo::LogoData> logos[2];
+	for (int i = 0; i < 2; ++i) {
+		Stopwatch sw;
+		sw.start();
+		logo::LogoAnalyzer analyzer(ctx, _T(""), 0, workfile.c_str(), _T(""),
+			scanx, scany, scanw, scanh, thy, numMaxFrames, cb);
+		analyzer.setNumThreads(setting.getLogoThreads());
+		logos[i] = analyzer.ReMakeLogoFromWorkfile(logoscan.GetLogo(false),
+			numFrames, logUVx, logUVy, serial[i], minFades[i]);
+		printf("%s: %.2f sec\n", serial[i] ? "serial" : "pool", sw.getAndReset());
+	}
+
+	int numMismatch = 0;
+	for (int n = 0; n < numFrames; ++n) {
+		if (std::abs(minFades[0][n] - minFades[1][n]) > 1) {
+			THROWF(TestException, "[LogoRemakeTest] frame %d: min fade %d != %d",
+				n, minFades[0][n], minFades[1][n]);
+		}
+		numMismatch += (minFades[0][n] != minFades[1][n]);
+	}
+	printf("min fade mismatch: %d/%d\n", numMismatch, numFrames);
+	if (numMismatch * 100 > numFrames) {
+		THROWF(TestException, "[LogoRemakeTest] too many min fade mismatches (%d/%d)", numMismatch, numFrames);
+	}
+
+	const float tolerance = 1e-3f;
+	const int planes[] = { PLANAR_Y, PLANAR_U, PLANAR_V };
+	for (int p = 0; p < 3; ++p) {
+		int size = (p == 0) ? scanw * scanh : (scanw >> logUVx) * (scanh >> logUVy);
+		float maxDiff = 0;
+		for (int i = 0; i < size; ++i) {
+			maxDiff = std::max(maxDiff, std::abs(logos[0]->GetA(planes[p])[i] - logos[1]->GetA(planes[p])[i]));
+			maxDiff = std::max(maxDiff, std::abs(logos[0]->GetB(planes[p])[i] - logos[1]->GetB(planes[p])[i]));
+		}
+		printf("plane %d: max A/B diff %g\n", p, maxDiff);
+		if (maxDiff > tolerance) {
+			THROWF(TestException, "[LogoRemakeTest] plane %d: A/B differ by %g", p, maxDiff);
+		}
+	}
+
+	return 0;
+}
+
+// LumaProxyFileŏvLVikPxjtœǂ߂邩Ar܂ł̃t@C͓ǂ܂Ȃ
+static int LumaProxyFileTest(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	const int width = 96, height = 64, pitch = width + 7, numFrames = 5;
+	tstring path = setting.getTmpLumaProxyPath(0);
+
+	srand(0);
+	std::vector<std::vector<uint16_t>> frames(numFrames);
+	for (auto& frame : frames) {
+		frame.resize(pitch * height);
+		for (auto& v : frame) v = (uint16_t)(rand() & 1023);
+	}
+
+	{
+		// finishɕt@C͓r܂łȂ̂œǂ܂Ȃ
+		logo::LumaProxyFile proxy(ctx, path, width, height, 4, 10, numFrames);
+		for (int i = 0; i < numFrames - 1; ++i) {
+			proxy.writeFrame<uint16_t>(frames[i].data(), pitch);
+		}
+		bool thrown = false;
+		try {
+			proxy.finish();
+		}
+		catch (const InvalidOperationException&) {
+			thrown = true;
+		}
+		if (!thrown) {
+			THROW(TestException, "[LumaProxyFileTest] finish succeeded with missing frames");
+		}
+	}
+	if (logo::LumaProxyFile::IsComplete(ctx, path)) {
+		THROW(TestException, "[LumaProxyFileTest] partial file is complete");
+	}
+	{
+		bool thrown = false;
+		try {
+			logo::LumaProxyFile proxy(ctx, path);
+		}
+		catch (const FormatException&) {
+			thrown = true;
+		}
+		if (!thrown) {
+			THROW(TestException, "[LumaProxyFileTest] partial file is readable");
+		}
+	}
+
+	{
+		logo::LumaProxyFile proxy(ctx, path, width, height, 4, 10, numFrames);
+		for (int i = 0; i < numFrames; ++i) {
+			proxy.writeFrame<uint16_t>(frames[i].data(), pitch);
+		}
+		proxy.finish();
+	}
+	if (!logo::LumaProxyFile::IsComplete(ctx, path)) {
+		THROW(TestException, "[LumaProxyFileTest] complete file is not complete");
+	}
+
+	logo::LumaProxyFile proxy(ctx, path);
+	const int proxyWidth = proxy.getWidth(), proxyHeight = proxy.getHeight();
+	if (proxy.getNumFrames() != numFrames || proxyWidth != width / 4 || proxyHeight != height / 4) {
+		THROW(TestException, "[LumaProxyFileTest] header does not match");
+	}
+
+	for (int i = 0; i < numFrames; ++i) {
+		const uint16_t* src = frames[i].data();
+		const uint8_t* luma = proxy.readFrame(i);
+		for (int y = 0; y < proxyHeight; ++y) {
+			for (int x = 0; x < proxyWidth; ++x) {
+				int sum = 0;
+				for (int ky = 0; ky < 4; ++ky) {
+					for (int kx = 0; kx < 4; ++kx) {
+						sum += src[(x * 4 + kx) + (y * 4 + ky) * pitch];
+					}
+				}
+				if (luma[x + y * proxyWidth] != (((sum + 8) / 16) >> 2)) {
+					THROWF(TestException, "[LumaProxyFileTest] frame %d luma (%d,%d) does not match", i, x, y);
+				}
+			}
+		}
+	}
+
+	return 0;
+}
+
+// chapter_exȅo͂疳Ԃ̍sƃV[`FWʒuǂ
+static void ReadChapterExeOut(const tstring& path, std::vector<std::string>& mutes, std::vector<int>& scpos)
+{
+	File file(path, _T("r"));
+	std::string str;
+	while (file.getline(str)) {
+		if (starts_with(str, "----")) {
+			break;
+		}
+	}
+	std::regex re0("mute\\s*(\\d+):\\s*(\\d+)\\s*-\\s*(\\d+).*");
+	std::regex re1("\\s*SCPos:\\s*(\\d+).*");
+	while (file.getline(str)) {
+		std::smatch m;
+		if (std::regex_search(str, m, re0)) {
+			mutes.push_back(m[0].str());
+		}
+		else if (std::regex_search(str, m, re1)) {
+			scpos.push_back(std::stoi(m[1].str()));
+		}
+	}
+}
+
+// S͂ōvLVchapter_exesČfƓʂɂȂ邩
+// Ԃ͉Ō܂̂ŊSvAV[`FWʒu͏kPxŌô
+// 9ȏオf̈ʒu1t[ȓňv邱
+static int LumaProxyChapterTest(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	class ChapterExeProcess : public EventBaseSubProcess {
+	public:
+		ChapterExeProcess(const tstring& args, File* out)
+			: EventBaseSubProcess(args)
+			, out(out)
+		{ }
+	protected:
+		File* out;
+		virtual void onOut(bool isErr, MemoryChunk mc) {
+			if (!isErr) {
+				out->write(mc);
+			}
+		}
+	};
+
+	tstring scriptpath = setting.getFilterScriptPath();
+	tstring proxypath = setting.getTmpLumaProxyPath(0);
+	{
+		auto env = make_unique_ptr(CreateScriptEnvironment2());
+		PClip clip = env->Invoke("Import", to_string(scriptpath).c_str()).AsClip();
+		logo::LogoFrame logof(ctx, setting.getLogoPath(), 0.1f);
+		logof.scanFrames(clip, env.get(), proxypath);
+	}
+	if (!logo::LumaProxyFile::IsComplete(ctx, proxypath)) {
+		THROW(TestException, "[LumaProxyChapterTest] proxy file is not complete");
+	}
+
+	tstring proxyavs = setting.getTmpProxyAVSPath(0);
+	{
+		StringBuilder sb;
+		sb.append("LoadPlugin(\"%s\")\n", GetModulePath());
+		sb.append("src = Import(\"%s\")\n", scriptpath);
+		sb.append("AudioDub(AMTLumaProxySource(\"%s\").AssumeFPS(src), src)\n", proxypath);
+		File file(proxyavs, _T("w"));
+		file.write(sb.getMC());
+	}
+
+	const tstring avspaths[] = { scriptpath, proxyavs };
+	std::vector<std::string> mutes[2];
+	std::vector<int> scpos[2];
+	for (int i = 0; i < 2; ++i) {
+		tstring outpath = setting.getTmpChapterExeOutPath(i);
+		{
+			File stdoutf(outpath, _T("wb"));
+			ChapterExeProcess process(StringFormat(_T("\"%s\" -v \"%s\" -o \"%s\""),
+				setting.getChapterExePath(), avspaths[i], setting.getTmpChapterExePath(i)), &stdoutf);
+			int exitCode = process.join();
+			if (exitCode != 0) {
+				THROWF(TestException, "[LumaProxyChapterTest] chapter_exe returned %d", exitCode);
+			}
+		}
+		ReadChapterExeOut(outpath, mutes[i], scpos[i]);
+	}
+
+	if (mutes[0] != mutes[1]) {
+		THROW(TestException, "[LumaProxyChapterTest] mute sections do not match");
+	}
+	int matched = 0;
+	for (int pos : scpos[1]) {
+		for (int ref : scpos[0]) {
+			if (std::abs(pos - ref) <= 1) {
+				++matched;
+				break;
+			}
+		}
+	}
+	printf("SCPos: source %d proxy %d matched %d\n", (int)scpos[0].size(), (int)scpos[1].size(), matched);
+	if (scpos[0].size() != scpos[1].size() || matched * 10 < (int)scpos[1].size() * 9) {
+		THROW(TestException, "[LumaProxyChapterTest] scene changes do not match");
+	}
+
+	return 0;
+}
+
 class TestSplitDualMono : public DualMonoSplitter
 {
 	std::unique_ptr<File> file0;
@@ -487,6 +2244,78 @@ static int SplitDualMonoAAC(AMTContext& ctx, const ConfigWrapper& setting)
 	return 0;
 }
 
+// NeAACDecParseœGg̈ʒufR[hꍇƈv邩
+static int DualMonoParseTest(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	File src(setting.getSrcFilePath(), _T("rb"));
+	int sz = (int)src.size();
+	std::unique_ptr<uint8_t[]> buf = std::unique_ptr<uint8_t[]>(new uint8_t[sz]);
+	src.read(MemoryChunk(buf.get(), sz));
+
+	std::vector<std::pair<int, int>> frames;
+	for (int offset = 0; offset + 7 <= sz; ) {
+		AdtsHeader header;
+		if (!header.parse(buf.get() + offset, 7)) {
+			THROW(FormatException, "Failed to parse AAC frame ...");
+		}
+		if (offset + header.frame_length > sz) {
+			THROW(FormatException, "frame_length too long ...");
+		}
+		frames.push_back(std::make_pair(offset, (int)header.frame_length));
+		offset += header.frame_length;
+	}
+	if (frames.size() == 0) {
+		THROW(FormatException, "No AAC frame ...");
+	}
+
+	NeAACDecHandle hAacDec[2];
+	for (int k = 0; k < 2; ++k) {
+		hAacDec[k] = NeAACDecOpen();
+		NeAACDecConfigurationPtr conf = NeAACDecGetCurrentConfiguration(hAacDec[k]);
+		conf->outputFormat = FAAD_FMT_16BIT;
+		NeAACDecSetConfiguration(hAacDec[k], conf);
+		unsigned long samplerate;
+		unsigned char channels;
+		if (NeAACDecInit(hAacDec[k], buf.get() + frames[0].first, frames[0].second, &samplerate, &channels)) {
+			THROW(FormatException, "NeAACDecInitɎs");
+		}
+	}
+
+	Stopwatch sw[2];
+	for (int i = 0; i < (int)frames.size(); ++i) {
+		uint8_t* data = buf.get() + frames[i].first;
+		NeAACDecFrameInfo info[2];
+		sw[0].start();
+		NeAACDecDecode(hAacDec[0], &info[0], data, frames[i].second);
+		sw[0].stop();
+		sw[1].start();
+		NeAACDecParse(hAacDec[1], &info[1], data, frames[i].second);
+		sw[1].stop();
+		if (info[0].error != 0 || info[1].error != 0) {
+			THROWF(FormatException, "t[%d̉͂Ɏs %d %d", i, info[0].error, info[1].error);
+		}
+		if (info[0].fr_ch_ele != info[1].fr_ch_ele ||
+			info[0].bytesconsumed != info[1].bytesconsumed)
+		{
+			THROWF(TestException, "[DualMonoParseTest] element count does not match (frame=%d)", i);
+		}
+		for (int e = 0; e < info[0].fr_ch_ele; ++e) {
+			if (info[0].element_start[e] != info[1].element_start[e] ||
+				info[0].element_end[e] != info[1].element_end[e])
+			{
+				THROWF(TestException, "[DualMonoParseTest] element position does not match (frame=%d)", i);
+			}
+		}
+	}
+	printf("decode: %.3f sec, parse: %.3f sec (%d frames)\n",
+		sw[0].getTotal(), sw[1].getTotal(), (int)frames.size());
+
+	for (int k = 0; k < 2; ++k) {
+		NeAACDecClose(hAacDec[k]);
+	}
+	return 0;
+}
+
 static int AACDecodeTest(AMTContext& ctx, const ConfigWrapper& setting)
 {
 	File src(setting.getSrcFilePath(), _T("rb"));
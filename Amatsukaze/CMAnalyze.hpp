@@ -58,7 +58,14 @@ public:
 		// `v^[
 		ctx.info("[EV[`FW]");
 		sw.start();
-		chapterExe(videoFileIndex, avspath);
+		tstring proxypath = setting_.getTmpLumaProxyPath(videoFileIndex);
+		if (setting_.isLumaProxy() && logo::LumaProxyFile::IsComplete(ctx, proxypath)) {
+			// S͂ōvLVgifR[hȂj
+			chapterExe(videoFileIndex, makeProxyAVSFile(videoFileIndex));
+		}
+		else {
+			chapterExe(videoFileIndex, avspath);
+		}
 		ctx.infoF(": %.2fb", sw.getAndReset());
 
 		ctx.info("[EV[`FW͌]");
@@ -235,6 +242,21 @@ private:
 		return avspath;
 	}
 
+	// f͏kPx̃vLVAt[[gƉAMTSource
+	tstring makeProxyAVSFile(int videoFileIndex)
+	{
+		StringBuilder sb;
+		sb.append("LoadPlugin(\"%s\")\n", GetModulePath());
+		sb.append("src = AMTSource(\"%s\")\n", setting_.getTmpAMTSourcePath(videoFileIndex));
+		sb.append("AudioDub(AMTLumaProxySource(\"%s\").AssumeFPS(src), src)\n",
+			setting_.getTmpLumaProxyPath(videoFileIndex));
+		sb.append("Prefetch(1)\n");
+		tstring avspath = setting_.getTmpProxyAVSPath(videoFileIndex);
+		File file(avspath, _T("w"));
+		file.write(sb.getMC());
+		return avspath;
+	}
+
   std::string makePreamble() {
     StringBuilder sb;
     // VXẽvOCtH_𖳌
@@ -260,7 +282,9 @@ private:
 			int duration = vi.num_frames * vi.fps_denominator / vi.fps_numerator;
 
 			logo::LogoFrame logof(ctx, setting_.getLogoPath(), 0.35f);
-			logof.scanFrames(clip, env.get());
+			logof.setNumThreads(setting_.getLogoThreads());
+			logof.scanFrames(clip, env.get(),
+				setting_.isLumaProxy() ? setting_.getTmpLumaProxyPath(videoFileIndex) : tstring());
 #if 0
 			logof.dumpResult(setting_.getTmpLogoFramePath(videoFileIndex));
 #endif
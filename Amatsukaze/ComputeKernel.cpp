@@ -10,9 +10,10 @@
 #include <intrin.h>
 #include <immintrin.h>
 #include <stdio.h>
+#include <stdint.h>
 
 struct CPUInfo {
-	bool initialized, avx, avx2;
+	bool initialized, avx, avx2, avx512;
 };
 
 static CPUInfo g_cpuinfo;
@@ -24,6 +25,7 @@ static inline void InitCPUInfo() {
 		g_cpuinfo.avx = cpuinfo[2] & (1 << 28) || false;
 		bool osxsaveSupported = cpuinfo[2] & (1 << 27) || false;
 		g_cpuinfo.avx2 = false;
+		g_cpuinfo.avx512 = false;
 		if (osxsaveSupported && g_cpuinfo.avx)
 		{
 			// _XCR_XFEATURE_ENABLED_MASK = 0
@@ -32,6 +34,8 @@ static inline void InitCPUInfo() {
 			if (g_cpuinfo.avx) {
 				__cpuid(cpuinfo, 7);
 				g_cpuinfo.avx2 = cpuinfo[1] & (1 << 5) || false;
+				// AVX512FOSopmask/ZMMWX^ۑ(XCR0 bit5-7)
+				g_cpuinfo.avx512 = (cpuinfo[1] & (1 << 16)) && (xcrFeatureMask & 0xE0) == 0xE0;
 			}
 		}
 		g_cpuinfo.initialized = true;
@@ -48,6 +52,11 @@ bool IsAVX2Available() {
 	return g_cpuinfo.avx2;
 }
 
+bool IsAVX512Available() {
+	InitCPUInfo();
+	return g_cpuinfo.avx512;
+}
+
 // https://qiita.com/beru/items/fff00c19968685dada68
 // in  : ( x7, x6, x5, x4, x3, x2, x1, x0 )
 // out : ( -,  -,  -, xsum )
@@ -119,3 +128,223 @@ float CalcCorrelation5x5_AVX(const float* k, const float* Y, int x, int y, int w
 	if (pavg) *pavg = avg;
 	return sum;
 };
+
+// TSpPbg̓ʒui32ʒuɃ`FbNj
+// dlMpeg2TsParser.hppFindTsSyncPositionƓ
+int FindTsSyncPosition_AVX2(const uint8_t* data, int size, int numPackets)
+{
+	enum { TS_SYNC_BYTE = 0x47, TS_PACKET_LENGTH = 188 };
+
+	int last = size - numPackets * TS_PACKET_LENGTH;
+	const auto sync = _mm256_set1_epi8((char)TS_SYNC_BYTE);
+	int pos = 0;
+	for (; pos + 31 <= last; pos += 32) {
+		auto m = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(data + pos)), sync);
+		if (_mm256_movemask_epi8(m) == 0) continue;
+		for (int i = 1; i < numPackets; ++i) {
+			m = _mm256_and_si256(m, _mm256_cmpeq_epi8(
+				_mm256_loadu_si256((const __m256i*)(data + pos + TS_PACKET_LENGTH * i)), sync));
+		}
+		unsigned int mask = (unsigned int)_mm256_movemask_epi8(m);
+		if (mask != 0) {
+			unsigned long idx;
+			_BitScanForward(&idx, mask);
+			return pos + idx;
+		}
+	}
+	// c
+	for (; pos <= last; ++pos) {
+		int i = 0;
+		for (; i < numPackets; ++i) {
+			if (data[pos + TS_PACKET_LENGTH * i] != TS_SYNC_BYTE) break;
+		}
+		if (i == numPackets) {
+			return pos;
+		}
+	}
+	return -1;
+}
+
+// H.264̊JnR[h/G~[Vh~oCgi32ʒuɃ`FbNj
+// dlH264VideoParser.hppFindNalCodeƓ
+int FindNalCode_AVX2(const uint8_t* data, int begin, int size)
+{
+	const auto zero = _mm256_setzero_si256();
+	const auto two = _mm256_set1_epi8(2);
+	const auto three = _mm256_set1_epi8(3);
+	int pos = begin;
+	for (; pos + 32 <= size; pos += 32) {
+		auto z = _mm256_and_si256(
+			_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(data + pos - 2)), zero),
+			_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(data + pos - 1)), zero));
+		if (_mm256_movemask_epi8(z) == 0) continue;
+		auto m = _mm256_and_si256(z, _mm256_cmpeq_epi8(
+			_mm256_or_si256(_mm256_loadu_si256((const __m256i*)(data + pos)), two), three));
+		unsigned int mask = (unsigned int)_mm256_movemask_epi8(m);
+		if (mask != 0) {
+			unsigned long idx;
+			_BitScanForward(&idx, mask);
+			return pos + idx;
+		}
+	}
+	// c
+	for (; pos < size; ++pos) {
+		if ((data[pos] | 2) == 3 && data[pos - 1] == 0 && data[pos - 2] == 0) {
+			return pos;
+		}
+	}
+	return -1;
+}
+
+// sɘAnf5x5ւ܂Ƃ߂ČvZ
+// kT̓J[l16fƂ[25][16]̕тɓ]úiLogoScan.hppKLANESƓj
+// 5x5̕ς͏c5f̗aĂ牡ɂ炵đ̂ŁAaׂ͗̉fƋL
+// ZLogoScan.hppCalcCorrelation5x5RowƓȂ̂Ōʂ̓rbgPʂňv
+// ubN̒[͂͂ݏoȂ悤Ƀ}XNēǂ
+enum { KLANES = 16 };
+
+void CalcCorrelation5x5Row_AVX2(const float* kT, const float* Y, int x, int y, int w, int n, float* sums, float* avgs)
+{
+	const auto lane = _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+	const auto lane4 = _mm_set_epi32(3, 2, 1, 0);
+	const auto div = _mm256_set1_ps(25.0f);
+	__declspec(align(32)) float cs[16];
+	for (int i = 0; i < n; i += 8) {
+		int valid = (n - i < 8) ? (n - i) : 8;
+		const float* kb = kT + (i / KLANES) * KLANES * 25 + (i % KLANES);
+		// o͉f̃}XN
+		const auto m = _mm256_cmpgt_epi32(_mm256_set1_epi32(valid), lane);
+		// ax-2valid+4Kvi8𒴂镪͌4vfɓj
+		const auto mh = _mm256_cmpgt_epi32(_mm256_set1_epi32(valid + 4), lane);
+		const auto mc = _mm_cmpgt_epi32(_mm_set1_epi32(valid - 4), lane4);
+		const float* top = Y + (x + i - 2) + (y - 2) * w;
+
+		auto c0 = _mm256_maskload_ps(top, mh);
+		auto c1 = _mm_maskload_ps(top + 8, mc);
+		for (int ky = 1; ky < 5; ++ky) {
+			c0 = _mm256_add_ps(c0, _mm256_maskload_ps(top + ky * w, mh));
+			c1 = _mm_add_ps(c1, _mm_maskload_ps(top + 8 + ky * w, mc));
+		}
+		_mm256_store_ps(cs, c0);
+		_mm_store_ps(cs + 8, c1);
+
+		auto box = _mm256_add_ps(
+			_mm256_add_ps(
+				_mm256_add_ps(
+					_mm256_add_ps(_mm256_loadu_ps(cs + 0), _mm256_loadu_ps(cs + 1)),
+					_mm256_loadu_ps(cs + 2)),
+				_mm256_loadu_ps(cs + 3)),
+			_mm256_loadu_ps(cs + 4));
+		const auto vavg = _mm256_div_ps(box, div);
+
+		auto vsum = _mm256_setzero_ps();
+		for (int ky = 0; ky < 5; ++ky) {
+			for (int kx = 0; kx < 5; ++kx) {
+				const auto vy = _mm256_maskload_ps(top + kx + ky * w, m);
+				const auto vk = _mm256_loadu_ps(kb + (kx + ky * 5) * KLANES);
+				vsum = _mm256_add_ps(vsum, _mm256_mul_ps(vk, _mm256_sub_ps(vy, vavg)));
+			}
+		}
+
+		_mm256_maskstore_ps(sums + i, m, vsum);
+		_mm256_maskstore_ps(avgs + i, m, vavg);
+	}
+}
+
+// AVX2̂ȂiAVX݂̂́jCPUp
+// ri_mm256_cmpgt_epi32jAVX2Ȃ̂Ń}XN͕rō
+// ȊOAVX2łƓ
+void CalcCorrelation5x5Row_AVX(const float* kT, const float* Y, int x, int y, int w, int n, float* sums, float* avgs)
+{
+	const auto lane = _mm256_set_ps(7, 6, 5, 4, 3, 2, 1, 0);
+	const auto lane4 = _mm_set_ps(3, 2, 1, 0);
+	const auto div = _mm256_set1_ps(25.0f);
+	__declspec(align(32)) float cs[16];
+	for (int i = 0; i < n; i += 8) {
+		int valid = (n - i < 8) ? (n - i) : 8;
+		const float* kb = kT + (i / KLANES) * KLANES * 25 + (i % KLANES);
+		// o͉f̃}XN
+		const auto m = _mm256_castps_si256(_mm256_cmp_ps(_mm256_set1_ps((float)valid), lane, _CMP_GT_OQ));
+		// ax-2valid+4Kvi8𒴂镪͌4vfɓj
+		const auto mh = _mm256_castps_si256(_mm256_cmp_ps(_mm256_set1_ps((float)(valid + 4)), lane, _CMP_GT_OQ));
+		const auto mc = _mm_castps_si128(_mm_cmpgt_ps(_mm_set1_ps((float)(valid - 4)), lane4));
+		const float* top = Y + (x + i - 2) + (y - 2) * w;
+
+		auto c0 = _mm256_maskload_ps(top, mh);
+		auto c1 = _mm_maskload_ps(top + 8, mc);
+		for (int ky = 1; ky < 5; ++ky) {
+			c0 = _mm256_add_ps(c0, _mm256_maskload_ps(top + ky * w, mh));
+			c1 = _mm_add_ps(c1, _mm_maskload_ps(top + 8 + ky * w, mc));
+		}
+		_mm256_store_ps(cs, c0);
+		_mm_store_ps(cs + 8, c1);
+
+		auto box = _mm256_add_ps(
+			_mm256_add_ps(
+				_mm256_add_ps(
+					_mm256_add_ps(_mm256_loadu_ps(cs + 0), _mm256_loadu_ps(cs + 1)),
+					_mm256_loadu_ps(cs + 2)),
+				_mm256_loadu_ps(cs + 3)),
+			_mm256_loadu_ps(cs + 4));
+		const auto vavg = _mm256_div_ps(box, div);
+
+		auto vsum = _mm256_setzero_ps();
+		for (int ky = 0; ky < 5; ++ky) {
+			for (int kx = 0; kx < 5; ++kx) {
+				const auto vy = _mm256_maskload_ps(top + kx + ky * w, m);
+				const auto vk = _mm256_loadu_ps(kb + (kx + ky * 5) * KLANES);
+				vsum = _mm256_add_ps(vsum, _mm256_mul_ps(vk, _mm256_sub_ps(vy, vavg)));
+			}
+		}
+
+		_mm256_maskstore_ps(sums + i, m, vsum);
+		_mm256_maskstore_ps(avgs + i, m, vavg);
+	}
+}
+
+void CalcCorrelation5x5Row_AVX512(const float* kT, const float* Y, int x, int y, int w, int n, float* sums, float* avgs)
+{
+	const auto lane4 = _mm_set_epi32(3, 2, 1, 0);
+	const auto div = _mm512_set1_ps(25.0f);
+	__declspec(align(64)) float cs[32];
+	for (int i = 0; i < n; i += 16) {
+		int valid = (n - i < 16) ? (n - i) : 16;
+		const float* kb = kT + (i / KLANES) * KLANES * 25;
+		// o͉f̃}XN
+		const __mmask16 m = (__mmask16)((1u << valid) - 1);
+		// ax-2valid+4Kv
+		const __mmask16 mh = (__mmask16)((valid + 4 >= 16) ? 0xFFFF : ((1u << (valid + 4)) - 1));
+		const auto mc = _mm_cmpgt_epi32(_mm_set1_epi32(valid - 12), lane4);
+		const float* top = Y + (x + i - 2) + (y - 2) * w;
+
+		auto c0 = _mm512_maskz_loadu_ps(mh, top);
+		auto c1 = _mm_maskload_ps(top + 16, mc);
+		for (int ky = 1; ky < 5; ++ky) {
+			c0 = _mm512_add_ps(c0, _mm512_maskz_loadu_ps(mh, top + ky * w));
+			c1 = _mm_add_ps(c1, _mm_maskload_ps(top + 16 + ky * w, mc));
+		}
+		_mm512_store_ps(cs, c0);
+		_mm_store_ps(cs + 16, c1);
+
+		auto box = _mm512_add_ps(
+			_mm512_add_ps(
+				_mm512_add_ps(
+					_mm512_add_ps(_mm512_loadu_ps(cs + 0), _mm512_loadu_ps(cs + 1)),
+					_mm512_loadu_ps(cs + 2)),
+				_mm512_loadu_ps(cs + 3)),
+			_mm512_loadu_ps(cs + 4));
+		const auto vavg = _mm512_div_ps(box, div);
+
+		auto vsum = _mm512_setzero_ps();
+		for (int ky = 0; ky < 5; ++ky) {
+			for (int kx = 0; kx < 5; ++kx) {
+				const auto vy = _mm512_maskz_loadu_ps(m, top + kx + ky * w);
+				const auto vk = _mm512_loadu_ps(kb + (kx + ky * 5) * KLANES);
+				vsum = _mm512_add_ps(vsum, _mm512_mul_ps(vk, _mm512_sub_ps(vy, vavg)));
+			}
+		}
+
+		_mm512_mask_storeu_ps(sums + i, m, vsum);
+		_mm512_mask_storeu_ps(avgs + i, m, vavg);
+	}
+}
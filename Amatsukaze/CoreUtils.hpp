@@ -377,6 +377,13 @@ public:
 	static void copy(const tstring& srcpath, const tstring& dstpath) {
 		CopyFileW(srcpath.c_str(), dstpath.c_str(), FALSE);
 	}
+	// dstpathΒuigpȂǂŒuȂfalsej
+	static bool move(const tstring& srcpath, const tstring& dstpath) {
+		return MoveFileExW(srcpath.c_str(), dstpath.c_str(), MOVEFILE_REPLACE_EXISTING) != FALSE;
+	}
+	static void remove(const tstring& path) {
+		DeleteFileW(path.c_str());
+	}
 private:
 	FILE* fp_;
 };
@@ -617,11 +617,174 @@ public:
 };
 
 
-class H264VideoParser : public AMTObject, public IVideoParser {
+// data[i-2],data[i-1]0data[i]1iJnR[hj3iG~[Vh~oCgjɂȂ
+// beginȏōŏiԂibegin >= 2ł邱ƁjBȂ-1
+static int FindNalCode(const uint8_t* data, int begin, int size)
+{
+	for (int i = begin; i < size; ++i) {
+		if ((data[i] | 2) == 3 && data[i - 1] == 0 && data[i - 2] == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+// 16ʒuɃ`FbN
+static int FindNalCode_SSE2(const uint8_t* data, int begin, int size)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i two = _mm_set1_epi8(2);
+	const __m128i three = _mm_set1_epi8(3);
+	int pos = begin;
+	for (; pos + 16 <= size; pos += 16) {
+		__m128i z = _mm_and_si128(
+			_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data + pos - 2)), zero),
+			_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data + pos - 1)), zero));
+		if (_mm_movemask_epi8(z) == 0) continue;
+		__m128i m = _mm_and_si128(z, _mm_cmpeq_epi8(
+			_mm_or_si128(_mm_loadu_si128((const __m128i*)(data + pos)), two), three));
+		int mask = _mm_movemask_epi8(m);
+		if (mask != 0) {
+			unsigned long idx;
+			_BitScanForward(&idx, mask);
+			return pos + idx;
+		}
+	}
+	return FindNalCode(data, pos, size);
+}
+
+// ComputeKernel.cpp
+bool IsAVX2Available();
+int FindNalCode_AVX2(const uint8_t* data, int begin, int size);
+
+// H.264PESyC[hNALjbgɕ
+// G~[Vh~oCgăobt@ɃRs[̂͒gǂNALjbgiSEI,SPS,PPSj
+// ȊO͓̓f[^̂܂܎wi̓G~[Vh~oCgj
+class H264NalScanner {
+public:
 	struct NalUnit {
+		uint8_t type;   // nal_unit_type
+		bool unescaped; // trueȂbufferAfalseȂ̓f[^
 		int offset;
-		int length; // rbsp_trailing_bits
+		int length;     // rbsp_trailing_bits
 	};
+
+	H264NalScanner() {
+		pFindNalCode = IsAVX2Available() ? FindNalCode_AVX2 : FindNalCode_SSE2;
+	}
+
+	// frameNALjbggI܂ŗLł邱
+	void scan(MemoryChunk frame) {
+		this->frame = frame;
+		buffer.clear();
+		units.clear();
+		escapes.clear();
+
+		// ŏ̊JnR[hÕf[^NALjbgł͂Ȃ̂Ŏ̂Ă
+		int unitStart = -1;
+		int escapeStart = 0;
+		for (int pos = 2; ; ) {
+			int i = (pos < (int)frame.length) ? pFindNalCode(frame.data, pos, (int)frame.length) : -1;
+			if (i == -1) {
+				break;
+			}
+			if (frame.data[i] == 0x03) {
+				escapes.push_back(i);
+			}
+			else {
+				// JnR[h0x01̑O܂
+				if (unitStart != -1) {
+					pushNalUnit(unitStart, i, escapeStart);
+				}
+				unitStart = i + 1;
+				escapeStart = (int)escapes.size();
+			}
+			pos = i + 1;
+		}
+		if (unitStart != -1) {
+			pushNalUnit(unitStart, (int)frame.length, escapeStart);
+		}
+	}
+
+	int numUnits() const {
+		return (int)units.size();
+	}
+
+	const NalUnit& get(int i) const {
+		return units[i];
+	}
+
+	// NALjbg̐擪inal_unit_type܂ރoCgj
+	uint8_t* data(int i) {
+		const NalUnit& nal = units[i];
+		return (nal.unescaped ? buffer.ptr() : frame.data) + nal.offset;
+	}
+
+private:
+	MemoryChunk frame;
+	AutoBuffer buffer;
+	std::vector<NalUnit> units;
+	std::vector<int> escapes; // G~[Vh~oCg̓̓f[^̈ʒu
+	int(*pFindNalCode)(const uint8_t* data, int begin, int size);
+
+	static bool needsPayload(int type) {
+		return type == 6 || type == 7 || type == 8;
+	}
+
+	bool isEscape(int i) const {
+		return i >= 2 && frame.data[i] == 0x03 && frame.data[i - 1] == 0 && frame.data[i - 2] == 0;
+	}
+
+	// [begin,end)NALjbg
+	void pushNalUnit(int begin, int end, int escapeStart) {
+		// 0i̊JnR[h0cabac_zero_wordj
+		int last = end - 1;
+		while (last >= begin && (frame.data[last] == 0 || isEscape(last))) {
+			--last;
+		}
+		if (last < begin) {
+			return;
+		}
+		int escapeEnd = escapeStart;
+		while (escapeEnd < (int)escapes.size() && escapes[escapeEnd] < last) {
+			++escapeEnd;
+		}
+
+		NalUnit nal;
+		nal.type = bsm(frame.data[begin], 0, 5);
+		nal.length = (last + 1 - begin) - (escapeEnd - escapeStart);
+		// rbsp_stop_one_bit菜
+		uint8_t lastByte = frame.data[last];
+		if (lastByte == 0x80) {
+			// yC[h͂̃oCgɂ͂Ȃ̂1oCg
+			--nal.length;
+		}
+		if (needsPayload(nal.type)) {
+			nal.unescaped = true;
+			nal.offset = (int)buffer.size();
+			int pos = begin;
+			for (int e = escapeStart; e < escapeEnd; ++e) {
+				buffer.add(MemoryChunk(frame.data + pos, escapes[e] - pos));
+				pos = escapes[e] + 1;
+			}
+			buffer.add(MemoryChunk(frame.data + pos, last + 1 - pos));
+			if (lastByte == 0x80) {
+				buffer.trimTail(1);
+			}
+			else {
+				uint8_t& b = buffer.ptr()[buffer.size() - 1];
+				b &= b - 1;
+			}
+		}
+		else {
+			nal.unescaped = false;
+			nal.offset = begin;
+		}
+		units.push_back(nal);
+	}
+};
+
+class H264VideoParser : public AMTObject, public IVideoParser {
 public:
 
 	H264VideoParser(AMTContext& ctx)
@@ -645,8 +808,7 @@ public:
 			return false;
 		}
 
-		storeBuffer(frame);
-
+		nalScanner.scan(frame);
 
 		int receivedField = 0;
 		bool isGopStart = false;
@@ -657,18 +819,17 @@ public:
 		int64_t next_bp_DTS = beffering_period_DTS;
 		int codedDataSize = 0;
 
-		int numNalUnits = (int)nalUnits.size();
+		int numNalUnits = nalScanner.numUnits();
 		for (int i = 0; i < numNalUnits; ++i) {
-			codedDataSize += nalUnits[i].length;
+			codedDataSize += nalScanner.get(i).length;
 		}
 
 		for (int i = 0; i < numNalUnits; ++i) {
-			NalUnit nalUnit = nalUnits[i];
-			int payloadLength = nalUnit.length;
-			uint8_t* ptr = buffer.ptr() + nalUnit.offset;
+			int payloadLength = nalScanner.get(i).length;
+			uint8_t* ptr = nalScanner.data(i);
 
 			uint8_t nal_ref_idc = bsm(ptr[0], 5, 2);
-			uint8_t nal_unit_type = bsm(ptr[0], 0, 5);
+			uint8_t nal_unit_type = nalScanner.get(i).type;
 
 			++ptr; --payloadLength;
 
@@ -843,8 +1004,7 @@ public:
 	}
 
 private:
-	AutoBuffer buffer;
-	std::vector<NalUnit> nalUnits;
+	H264NalScanner nalScanner;
 
 	// O beffering period  DTS;
 	int64_t beffering_period_DTS;
@@ -872,57 +1032,4 @@ private:
 			break;
 		}
 	}
-
-	void pushNalUnit(int unitStart, int lastNonZero) {
-		if (lastNonZero > 0) {
-			NalUnit nal;
-			nal.offset = unitStart;
-			// rbsp_stop_one_bit菜
-			uint8_t& lastByte = buffer.ptr()[lastNonZero - 1];
-			if (lastByte == 0x80) {
-				// yC[h͂̃oCgɂ͂Ȃ̂1oCg
-				--lastNonZero;
-			}
-			else {
-				lastByte &= lastByte - 1;
-			}
-			nal.length = lastNonZero - unitStart;
-			nalUnits.push_back(nal);
-		}
-	}
-
-	void storeBuffer(MemoryChunk frame) {
-		buffer.clear();
-		nalUnits.clear();
-		buffer.add(MemoryChunk(frame.data, 2));
-		int32_t n3bytes = (frame.data[0] << 8) | frame.data[1];
-		int unitStart = 0;
-		int lastNonZero = 0;
-		int unitStartOrig = 0;
-		int lastNonZeroOrig = 0;
-		for (int i = 2; i < (int)frame.length; ++i) {
-			uint8_t inByte = frame.data[i];
-			n3bytes = ((n3bytes & 0xFFFF) << 8) | inByte;
-			if (n3bytes == 0x03) {
-				// skip one byte
-				//PRINTF("Skip one byte (H264 NAL)\n");
-			}
-			else {
-				buffer.add(inByte);
-				int k = (int)buffer.size();
-
-				if (n3bytes == 0x01) {
-					// start code prefix
-					pushNalUnit(unitStart, lastNonZero);
-					unitStart = k;
-					unitStartOrig = i;
-				}
-				if (inByte) {
-					lastNonZero = k;
-					lastNonZeroOrig = i;
-				}
-			}
-		}
-		pushNalUnit(unitStart, lastNonZero);
-	}
 };
@@ -9,6 +9,7 @@
 
 #include "ReaderWriterFFmpeg.hpp"
 #include "LogoScan.hpp"
+#include "TsIndex.hpp"
 
 namespace av {
 
@@ -25,6 +26,10 @@ class GUIMediaFile : public AMTObject
 
 	int64_t fileSize;
 
+	// TSCfbNX΃V[NL[t[̈ʒuɍ킹
+	TsIndex index;
+	bool hasIndex;
+
 	Frame prevframe;
 	int width, height;
 
@@ -105,11 +110,15 @@ public:
 		, width(-1)
 		, height(-1)
 		, swsctx(nullptr)
+		, hasIndex(false)
 	{
 		{
 			File file(tstring(filepath), _T("rb"));
 			fileSize = file.size();
 		}
+		if (index.load(TsIndex::GetIndexPath(filepath), filepath) && index.programs.size() > 0) {
+			hasIndex = (serviceid <= 0 || index.programs[0].serviceId == serviceid);
+		}
 		if (avformat_find_stream_info(inputCtx(), NULL) < 0) {
 			THROW(FormatException, "avformat_find_stream_info failed");
 		}
@@ -137,6 +146,12 @@ public:
 		ctx.setError(Exception());
 		try {
 			int64_t fileOffset = int64_t(fileSize * pos);
+			if (hasIndex) {
+				const TsIndexVideo* key = index.findKeyFrame(fileOffset);
+				if (key != nullptr) {
+					fileOffset = key->offset;
+				}
+			}
 			if (av_seek_frame(inputCtx(), -1, fileOffset, AVSEEK_FLAG_BYTE) < 0) {
 				THROW(FormatException, "av_seek_frame failed");
 			}
@@ -16,10 +16,15 @@
 #include "AMTLogo.hpp"
 #include "TsInfo.hpp"
 #include "TextOut.h"
+#include "ProcessThread.hpp"
 
 #include <cmath>
 #include <numeric>
 #include <fstream>
+#include <deque>
+#include <set>
+#include <mutex>
+#include <condition_variable>
 
 float CalcCorrelation5x5(const float* k, const float* Y, int x, int y, int w, float* pavg)
 {
@@ -40,9 +45,52 @@ float CalcCorrelation5x5(const float* k, const float* Y, int x, int y, int w, fl
 	return sum;
 };
 
+// 行方向に連続するn画素の5x5相関をまとめて計算（SIMD版の基準実装）
+// kTはカーネルを16画素ごとに[25][16]の並びに転置したもの
+// 平均は縦5画素の列和を横に5つ足して求める。SIMD版とは演算順序を揃えているので結果は一致する
+void CalcCorrelation5x5Row(const float* kT, const float* Y, int x, int y, int w, int n, float* sums, float* avgs)
+{
+	enum { KLANES = 16 };
+	for (int i = 0; i < n; ++i) {
+		const float* top = Y + (x + i - 2) + (y - 2) * w;
+		const float* k = kT + (i / KLANES) * KLANES * 25 + (i % KLANES);
+		float cs[5];
+		for (int kx = 0; kx < 5; ++kx) {
+			float c = top[kx];
+			for (int ky = 1; ky < 5; ++ky) {
+				c = c + top[kx + ky * w];
+			}
+			cs[kx] = c;
+		}
+		float avg = ((((cs[0] + cs[1]) + cs[2]) + cs[3]) + cs[4]) / 25.0f;
+		float sum = 0.0f;
+		for (int ky = 0; ky < 5; ++ky) {
+			for (int kx = 0; kx < 5; ++kx) {
+				sum = sum + k[(kx + ky * 5) * KLANES] * (top[kx + ky * w] - avg);
+			}
+		}
+		sums[i] = sum;
+		avgs[i] = avg;
+	}
+}
+
 // ComputeKernel.cpp
 bool IsAVXAvailable();
+bool IsAVX2Available();
+bool IsAVX512Available();
 float CalcCorrelation5x5_AVX(const float* k, const float* Y, int x, int y, int w, float* pavg);
+void CalcCorrelation5x5Row_AVX(const float* kT, const float* Y, int x, int y, int w, int n, float* sums, float* avgs);
+void CalcCorrelation5x5Row_AVX2(const float* kT, const float* Y, int x, int y, int w, int n, float* sums, float* avgs);
+void CalcCorrelation5x5Row_AVX512(const float* kT, const float* Y, int x, int y, int w, int n, float* sums, float* avgs);
+
+typedef void(*CalcCorrelation5x5RowFunc)(const float* kT, const float* Y, int x, int y, int w, int n, float* sums, float* avgs);
+
+static CalcCorrelation5x5RowFunc GetCalcCorrelation5x5Row() {
+	if (IsAVX512Available()) return CalcCorrelation5x5Row_AVX512;
+	if (IsAVX2Available()) return CalcCorrelation5x5Row_AVX2;
+	if (IsAVXAvailable()) return CalcCorrelation5x5Row_AVX;
+	return CalcCorrelation5x5Row;
+}
 
 #if 0
 float CalcCorrelation5x5_Debug(const float* k, const float* Y, int x, int y, int w, float* pavg)
@@ -64,11 +112,19 @@ class LogoDataParam : public LogoData
 		KSIZE = 5,
 		KLEN = KSIZE * KSIZE,
 		CSHIFT = 3,
-		CLEN = 256 >> CSHIFT
+		CLEN = 256 >> CSHIFT,
+		KLANES = 16,   // 転置カーネルの画素単位（ComputeKernel.cppと同じ）
+		MAX_RUN = 64   // 1回の行カーネル呼び出しで計算する最大画素数
 	};
 	int imgw, imgh, imgx, imgy; // この4つはすべて2の倍数
 	std::unique_ptr<uint8_t[]> mask;
 	std::unique_ptr<float[]> kernels;
+	// 行方向に連続する着目点の並び（kofsはkernelsTの位置）
+	struct MaskRun {
+		int x, y, n, kofs;
+	};
+	std::vector<MaskRun> runs;
+	std::unique_ptr<float[]> kernelsT;
 	struct ScaleLimit {
 		float scale;   // 正規化用スケール（想定される相関が1になるようにするため）
 		float scale2;  // キャップ用スケール（想定される相関が小さすぎる場合に値を小さくするため）
@@ -78,7 +134,7 @@ class LogoDataParam : public LogoData
 	int maskpixels;
 	float blackScore;
 
-	float(*pCalcCorrelation5x5)(const float* k, const float* Y, int x, int y, int w, float* pavg);
+	CalcCorrelation5x5RowFunc pCalcCorrelation5x5Row;
 public:
 	LogoDataParam() { }
 
@@ -120,7 +176,7 @@ public:
 		// 相関下限パラメータ
 		const float corrLowerLimit = 0.2f;
 
-		pCalcCorrelation5x5 = IsAVXAvailable() ? CalcCorrelation5x5_AVX : CalcCorrelation5x5;
+		pCalcCorrelation5x5Row = GetCalcCorrelation5x5Row();
 
 		int YSize = w * h;
 		auto memWork = std::unique_ptr<float[]>(new float[YSize * CLEN + 8]);
@@ -184,21 +240,58 @@ public:
 		// 各ピクセルx各単色背景での相関値スケール
 		scales = std::unique_ptr<ScaleLimit[]>(new ScaleLimit[maskpixels * CLEN]);
     int count = 0;
-		float avgCorr = 0.0f;
     for (int y = 2; y < h - 2; ++y) {
       for (int x = 2; x < w - 2; ++x) {
         if (mask[x + y * w]) {
 					float* k = &kernels[count * KLEN];
-					ScaleLimit* s = &scales[count * CLEN];
 					makeKernel(k, memWork.get(), x, y, w);
-					for (int i = 0; i < CLEN; ++i) {
-						float *slice = &memWork[i * YSize];
-						avgCorr += s[i].scale = std::abs(pCalcCorrelation5x5(k, slice, x, y, w, nullptr));
-					}
 					++count;
         }
       }
     }
+
+		// 行カーネル用に着目点の連続区間を作ってカーネルを転置
+		runs.clear();
+		int ktsize = 0;
+		for (int y = 2; y < h - 2; ++y) {
+			for (int x = 2; x < w - 2; ) {
+				if (mask[x + y * w] == 0) {
+					++x;
+					continue;
+				}
+				MaskRun run = { x, y, 0, ktsize };
+				while (x < w - 2 && mask[x + y * w] && run.n < MAX_RUN) {
+					++run.n;
+					++x;
+				}
+				runs.push_back(run);
+				ktsize += (run.n + KLANES - 1) / KLANES * KLANES * KLEN;
+			}
+		}
+		kernelsT = std::unique_ptr<float[]>(new float[ktsize + 8]());
+		count = 0;
+		for (const MaskRun& run : runs) {
+			for (int i = 0; i < run.n; ++i, ++count) {
+				float* kt = &kernelsT[run.kofs + (i / KLANES) * KLANES * KLEN + (i % KLANES)];
+				for (int j = 0; j < KLEN; ++j) {
+					kt[j * KLANES] = kernels[count * KLEN + j];
+				}
+			}
+		}
+
+		// 各単色背景での相関値（評価と同じ行カーネルで計算する）
+		float avgCorr = 0.0f;
+		for (int c = 0; c < CLEN; ++c) {
+			float *slice = &memWork[c * YSize];
+			count = 0;
+			for (const MaskRun& run : runs) {
+				float sums[MAX_RUN], avgs[MAX_RUN];
+				pCalcCorrelation5x5Row(&kernelsT[run.kofs], slice, run.x, run.y, w, run.n, sums, avgs);
+				for (int i = 0; i < run.n; ++i, ++count) {
+					avgCorr += scales[count * CLEN + c].scale = std::abs(sums[i]);
+				}
+			}
+		}
 		avgCorr /= maskpixels * CLEN;
 		// 相関下限（これより小さい相関のピクセルはスケールしない）
 		float limitCorr = avgCorr * corrLowerLimit;
@@ -254,6 +347,31 @@ public:
 		return CorrelationScore(work, maxv) / blackScore;
 	}
 
+	// 複数のfade値でまとめて評価（srcのstrideはw）
+	// ロゴを除去した背景と元画像の差分はfadeによらないので1回だけ計算し、
+	// 各fadeは src + fade * diff で作る（EvaluateLogoと数式は同じ）
+	void EvaluateLogoFades(const float *src, float maxv, const float* fades, int numFades,
+		float* work, float* diff, float* results)
+	{
+		const float *logoAY = GetA(PLANAR_Y);
+		const float *logoBY = GetB(PLANAR_Y);
+		int YSize = w * h;
+
+		for (int i = 0; i < YSize; ++i) {
+			float srcv = src[i];
+			float bg = logoAY[i] * srcv + logoBY[i] * maxv;
+			diff[i] = bg - srcv;
+		}
+
+		for (int fi = 0; fi < numFades; ++fi) {
+			float fade = fades[fi];
+			for (int i = 0; i < YSize; ++i) {
+				work[i] = src[i] + fade * diff[i];
+			}
+			results[fi] = CorrelationScore(work, maxv) / blackScore;
+		}
+	}
+
 	std::unique_ptr<LogoDataParam> MakeFieldLogo(bool bottom)
 	{
 		auto logo = std::unique_ptr<LogoDataParam>(
@@ -287,32 +405,25 @@ private:
   // 画素ごとにロゴとの相関を計算
   float CorrelationScore(const float *work, float maxv)
   {
-    const uint8_t* mask = GetMask();
-    const float* kernels = GetKernels();
-
-    // ロゴとの相関を評価
+    // ロゴとの相関を評価（着目点の連続区間ごとにまとめて計算）
     int count = 0;
     float result = 0;
-    for (int y = 2; y < h - 2; ++y) {
-      for (int x = 2; x < w - 2; ++x) {
-        if (mask[x + y * w]) {
-          const float* k = &kernels[count * KLEN];
-
-					float avg;
-					float sum = pCalcCorrelation5x5(k, work, x, y, w, &avg);
-					// avg単色の場合の相関値が1になるように正規化
-					ScaleLimit s = scales[count * CLEN + (std::max(0, std::min(255, (int)avg)) >> CSHIFT)];
-					// 1を超える部分は捨てる（ロゴによる相関ではない部分なので）
-					float normalized = std::max(-1.0f, std::min(1.0f, sum * s.scale));
-					// 相関が下限値以下の場合は一部元に戻す
-					float score = normalized * s.scale2;
-
-					result += score;
-
-					++count;
-        }
-      }
-    }
+		for (const MaskRun& run : runs) {
+			float sums[MAX_RUN], avgs[MAX_RUN];
+			pCalcCorrelation5x5Row(&kernelsT[run.kofs], work, run.x, run.y, w, run.n, sums, avgs);
+			for (int i = 0; i < run.n; ++i, ++count) {
+				float avg = avgs[i];
+				float sum = sums[i];
+				// avg単色の場合の相関値が1になるように正規化
+				ScaleLimit s = scales[count * CLEN + (std::max(0, std::min(255, (int)avg)) >> CSHIFT)];
+				// 1を超える部分は捨てる（ロゴによる相関ではない部分なので）
+				float normalized = std::max(-1.0f, std::min(1.0f, sum * s.scale));
+				// 相関が下限値以下の場合は一部元に戻す
+				float score = normalized * s.scale2;
+
+				result += score;
+			}
+		}
 
     return result;
   }
@@ -404,6 +515,7 @@ class LogoScan
 	int thy;
 
 	std::vector<short> tmpY, tmpU, tmpV;
+	std::vector<int> hist;
 
 	int nframes;
 	std::unique_ptr<LogoColor[]> logoY, logoU, logoV;
@@ -411,7 +523,7 @@ class LogoScan
 	/*--------------------------------------------------------------------
 	*	真中らへんを平均
 	*-------------------------------------------------------------------*/
-	int med_average(const std::vector<short>& s)
+	static int med_average(const std::vector<short>& s)
 	{
 		double t = 0;
 		int nn = 0;
@@ -427,6 +539,54 @@ class LogoScan
 		return ((int)t);
 	}
 
+public:
+	// 背景が単一色か判定して背景色を求める（ソートしない版）
+	// 最大と最小の差がthy以下のときだけ背景色が必要なので、
+	// 最小値からのヒストグラムでソート後の真中らへんの和を求める（結果はCheckBackgroundSortと同じ）
+	static bool CheckBackground(const std::vector<short>& s, int thy, std::vector<int>& hist, int& bg)
+	{
+		int n = (int)s.size();
+		int minv = SHRT_MAX, maxv = SHRT_MIN;
+		for (int i = 0; i < n; ++i) {
+			minv = std::min(minv, (int)s[i]);
+			maxv = std::max(maxv, (int)s[i]);
+		}
+		// 最小と最大が閾値以上離れている場合、単一色でないと判断
+		if (abs(minv - maxv) > thy) { // オリジナルだと thy * 8
+			return false;
+		}
+		hist.assign(maxv - minv + 1, 0);
+		for (int i = 0; i < n; ++i) {
+			hist[s[i] - minv]++;
+		}
+		// 真中らへんを平均
+		int lo = n / 4, hi = n - (n / 4);
+		double t = 0;
+		int nn = hi - lo;
+		for (int v = 0, pos = 0; v < (int)hist.size() && pos < hi; pos += hist[v++]) {
+			int b = std::max(pos, lo);
+			int e = std::min(pos + hist[v], hi);
+			if (b < e) {
+				t += (double)(v + minv) * (e - b);
+			}
+		}
+		t = (t + nn / 2) / nn;
+		bg = (int)t;
+		return true;
+	}
+
+	// ソートする版（CheckBackgroundの基準実装）
+	static bool CheckBackgroundSort(std::vector<short>& s, int thy, int& bg)
+	{
+		std::sort(s.begin(), s.end());
+		if (abs(s.front() - s.back()) > thy) { // オリジナルだと thy * 8
+			return false;
+		}
+		bg = med_average(s);
+		return true;
+	}
+
+private:
 	static float calcDist(float a, float b) {
 		return (1.0f / 3.0f) * (a - 1) * (a - 1) + (a - 1) * b + b * b;
 	}
@@ -635,23 +795,17 @@ public:
 		}
 
 		// 最小と最大が閾値以上離れている場合、単一色でないと判断
-		std::sort(tmpY.begin(), tmpY.end());
-		if (abs(tmpY.front() - tmpY.back()) > thy) { // オリジナルだと thy * 8
+		int bgY, bgU, bgV;
+		if (!CheckBackground(tmpY, thy, hist, bgY)) {
 			return false;
 		}
-		std::sort(tmpU.begin(), tmpU.end());
-		if (abs(tmpU.front() - tmpU.back()) > thy) { // オリジナルだと thy * 8
+		if (!CheckBackground(tmpU, thy, hist, bgU)) {
 			return false;
 		}
-		std::sort(tmpV.begin(), tmpV.end());
-		if (abs(tmpV.front() - tmpV.back()) > thy) { // オリジナルだと thy * 8
+		if (!CheckBackground(tmpV, thy, hist, bgV)) {
 			return false;
 		}
 
-		int bgY = med_average(tmpY);
-		int bgU = med_average(tmpU);
-		int bgV = med_average(tmpV);
-
 		// 有効フレームを追加
 		AddScanFrame(srcY, srcU, srcV, pitchY, pitchUV, bgY, bgU, bgV);
 
@@ -789,6 +943,11 @@ void CopyY(float* dst, const pixel_t* src, int srcPitch, int w, int h)
 	}
 }
 
+// ロゴ評価のスレッド数（0で自動）
+static int GetLogoThreads(int numThreads) {
+	return (numThreads > 0) ? numThreads : std::max(1, GetProcessorCount() - 1);
+}
+
 typedef bool(*LOGO_ANALYZE_CB)(float progress, int nread, int total, int ngather);
 
 class LogoAnalyzer : AMTObject
@@ -806,6 +965,7 @@ class LogoAnalyzer : AMTObject
 	int logUVx, logUVy;
 	int imgw, imgh;
 	int numFrames;
+	int numThreads;
 	std::unique_ptr<LogoData> logodata;
 
 	float progressbase;
@@ -920,9 +1080,139 @@ class LogoAnalyzer : AMTObject
 		creator.readAll(srcpath, serviceid);
 	}
 
-	void ReMakeLogo()
+	// 複数fade値でのロゴ評価をフレームごとに並列で行うワーカースレッド群
+	// メインスレッドがデコードしたバッチを渡すと、各ワーカーがフレームを取って
+	// 全fade値を評価し、最も評価値が小さいfadeのインデックスを書き込む
+	class FadeEvalPool
+	{
+	public:
+		FadeEvalPool(LogoDataParam& logo, int scanw, int scanh, int numFade, int numThreads)
+			: logo(logo)
+			, scanw(scanw)
+			, scanh(scanh)
+			, numFade(numFade)
+			, frames(nullptr)
+			, count(0)
+			, frameSize(0)
+			, outMinFades(nullptr)
+			, next(0)
+			, numDone(0)
+			, generation(0)
+			, finished(false)
+		{
+			for (int i = 0; i < numThreads; ++i) {
+				workers.emplace_back(new Worker(this));
+			}
+			for (auto& w : workers) {
+				w->start();
+			}
+		}
+
+		~FadeEvalPool() {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				finished = true;
+				condStart.notify_all();
+			}
+			for (auto& w : workers) {
+				w->join();
+			}
+		}
+
+		// バッチの評価を開始（wait()するまでframesとoutMinFadesは触らないこと）
+		void start(const uint8_t* frames_, int count_, size_t frameSize_, int* outMinFades_) {
+			std::lock_guard<std::mutex> lock(mutex);
+			frames = frames_;
+			count = count_;
+			frameSize = frameSize_;
+			outMinFades = outMinFades_;
+			next = 0;
+			numDone = 0;
+			++generation;
+			condStart.notify_all();
+		}
+
+		void wait() {
+			std::unique_lock<std::mutex> lock(mutex);
+			while (numDone < (int)workers.size()) {
+				condDone.wait(lock);
+			}
+		}
+
+	private:
+		class Worker : public ThreadBase {
+		public:
+			Worker(FadeEvalPool* pool) : pool(pool) { }
+		protected:
+			virtual void run() { pool->workerLoop(); }
+		private:
+			FadeEvalPool* pool;
+		};
+
+		LogoDataParam& logo;
+		int scanw, scanh, numFade;
+		const uint8_t* frames;
+		int count;
+		size_t frameSize;
+		int* outMinFades;
+		int next;
+		int numDone;
+		int generation;
+		bool finished;
+		std::mutex mutex;
+		std::condition_variable condStart;
+		std::condition_variable condDone;
+		std::vector<std::unique_ptr<Worker>> workers;
+
+		void workerLoop() {
+			size_t YSize = scanw * scanh;
+			auto memDeint = std::unique_ptr<float[]>(new float[YSize + 8]);
+			auto memWork = std::unique_ptr<float[]>(new float[YSize + 8]);
+			auto memDiff = std::unique_ptr<float[]>(new float[YSize + 8]);
+			std::vector<float> fades(numFade);
+			std::vector<float> results(numFade);
+			for (int fi = 0; fi < numFade; ++fi) {
+				fades[fi] = 0.1f * fi;
+			}
+			int lastGeneration = 0;
+			std::unique_lock<std::mutex> lock(mutex);
+			while (true) {
+				while (generation == lastGeneration) {
+					if (finished) return;
+					condStart.wait(lock);
+				}
+				lastGeneration = generation;
+				while (next < count) {
+					int i = next++;
+					lock.unlock();
+					// フレームをインタレ解除
+					DeintY(memDeint.get(), frames + frameSize * i, scanw, scanw, scanh);
+					logo.EvaluateLogoFades(memDeint.get(), 255.0f, fades.data(), numFade,
+						memWork.get(), memDiff.get(), results.data());
+					float minResult = FLT_MAX;
+					int minFadeIndex = 0;
+					for (int fi = 0; fi < numFade; ++fi) {
+						float result = std::abs(results[fi]);
+						if (result < minResult) {
+							minResult = result;
+							minFadeIndex = fi;
+						}
+					}
+					outMinFades[i] = minFadeIndex;
+					lock.lock();
+				}
+				if (++numDone == (int)workers.size()) {
+					condDone.notify_all();
+				}
+			}
+		}
+	};
+
+	// serialがtrueだとfade評価をスレッドを使わずフレームごとに逐次で行う（比較テスト用）
+	void ReMakeLogo(bool serial = false, std::vector<int>* outMinFades = nullptr)
 	{
 		// 複数fade値でロゴを評価 //
+		// フレームは1回だけデコードして、fade評価（並列）とロゴの再集計を同時に行う
 		auto codec = make_unique_ptr(CCodec::CreateInstance(UTVF_ULH0, "Amatsukaze"));
 
 		// ロゴを評価用にインタレ解除
@@ -931,17 +1221,25 @@ class LogoAnalyzer : AMTObject
 		deintLogo.CreateLogoMask(0.1f);
 
 		size_t scanDataSize = scanw * scanh * 3 / 2;
-		size_t YSize = scanw * scanh;
 		size_t codedSize = codec->EncodeGetOutputSize(UTVF_YV12, scanw, scanh);
-		size_t extraSize = codec->EncodeGetExtraDataSize();
-		auto memScanData = std::unique_ptr<uint8_t[]>(new uint8_t[scanDataSize]);
 		auto memCoded = std::unique_ptr<uint8_t[]>(new uint8_t[codedSize]);
 
-		auto memDeint = std::unique_ptr<float[]>(new float[YSize + 8]);
-		auto memWork = std::unique_ptr<float[]>(new float[YSize + 8]);
+		// デコードと評価を重ねるため2バッチ分持つ
+		const int batchFrames = 64;
+		std::vector<uint8_t> batches[2] = {
+			std::vector<uint8_t>(scanDataSize * batchFrames),
+			std::vector<uint8_t>(scanDataSize * batchFrames)
+		};
 
 		const int numFade = 20;
-		auto minFades = std::unique_ptr<int[]>(new int[numFrames]);
+		std::vector<int> minFades(numFrames);
+
+		int scanUVw = scanw >> logUVx;
+		int scanUVh = scanh >> logUVy;
+		int offU = scanw * scanh;
+		int offV = offU + scanUVw * scanUVh;
+
+		LogoScan logoscan(scanw, scanh, logUVx, logUVy, thy);
 		{
 			LosslessVideoFile file(ctx, workfile, _T("rb"));
 			file.readHeader();
@@ -951,34 +1249,75 @@ class LogoAnalyzer : AMTObject
 				THROW(RuntimeException, "failed to DecodeBegin (UtVideo)");
 			}
 
-			// 全フレームループ
-			for (int i = 0; i < numFrames; ++i) {
-				int64_t codedSize = file.readFrame(i, memCoded.get());
-				if (codec->DecodeFrame(memScanData.get(), memCoded.get()) != scanDataSize) {
-					THROW(RuntimeException, "failed to DecodeFrame (UtVideo)");
+			std::unique_ptr<FadeEvalPool> pool;
+			if (!serial) {
+				pool = std::unique_ptr<FadeEvalPool>(
+					new FadeEvalPool(deintLogo, scanw, scanh, numFade, GetLogoThreads(numThreads)));
+			}
+
+			// 逐次評価（1フレームずつ各fade値で評価）
+			size_t YSize = scanw * scanh;
+			auto memDeint = std::unique_ptr<float[]>(new float[YSize + 8]);
+			auto memWork = std::unique_ptr<float[]>(new float[YSize + 8]);
+			auto evalSerial = [&](const std::vector<uint8_t>& batch, int start, int count) {
+				for (int i = 0; i < count; ++i) {
+					DeintY(memDeint.get(), batch.data() + scanDataSize * i, scanw, scanw, scanh);
+					float minResult = FLT_MAX;
+					int minFadeIndex = 0;
+					for (int fi = 0; fi < numFade; ++fi) {
+						float result = std::abs(deintLogo.EvaluateLogo(memDeint.get(), 255.0f, 0.1f * fi, memWork.get()));
+						if (result < minResult) {
+							minResult = result;
+							minFadeIndex = fi;
+						}
+					}
+					minFades[start + i] = minFadeIndex;
 				}
-				// フレームをインタレ解除
-				DeintY(memDeint.get(), memScanData.get(), scanw, scanw, scanh);
-				// fade値ループ
-				float minResult = FLT_MAX;
-				int minFadeIndex = 0;
-				for (int fi = 0; fi < numFade; ++fi) {
-					float fade = 0.1f * fi;
-					// ロゴを評価
-					float result = std::abs(deintLogo.EvaluateLogo(memDeint.get(), 255.0f, fade, memWork.get()));
-					if (result < minResult) {
-						minResult = result;
-						minFadeIndex = fi;
+			};
+
+			// 評価が終わったバッチのロゴのあるフレームだけAddFrame（フレーム順）
+			auto addFrames = [&](const std::vector<uint8_t>& batch, int start, int count) {
+				for (int i = 0; i < count; ++i) {
+					if (minFades[start + i] > 8) { // TODO: 調整
+						const uint8_t* ptr = batch.data() + scanDataSize * i;
+						logoscan.AddFrame(ptr, ptr + offU, ptr + offV, scanw, scanUVw);
 					}
 				}
-				minFades[i] = minFadeIndex;
+			};
 
-				if ((i % 100) == 0) {
-					float progress = (float)i / numFrames * 25 + progressbase;
-					if (cb(progress, i, numFrames, numFrames) == false) {
-						THROW(RuntimeException, "Cancel requested");
+			// 全フレームループ
+			int evalStart = -1, evalCount = 0, evalBuf = 0;
+			for (int start = 0, cur = 0; start < numFrames; start += batchFrames, cur ^= 1) {
+				int count = std::min(batchFrames, numFrames - start);
+				for (int i = 0; i < count; ++i) {
+					file.readFrame(start + i, memCoded.get());
+					if (codec->DecodeFrame(batches[cur].data() + scanDataSize * i, memCoded.get()) != scanDataSize) {
+						THROW(RuntimeException, "failed to DecodeFrame (UtVideo)");
 					}
 				}
+				if (evalStart >= 0) {
+					if (pool) pool->wait();
+					addFrames(batches[evalBuf], evalStart, evalCount);
+				}
+				if (pool) {
+					pool->start(batches[cur].data(), count, scanDataSize, &minFades[start]);
+				}
+				else {
+					evalSerial(batches[cur], start, count);
+				}
+				evalStart = start;
+				evalCount = count;
+				evalBuf = cur;
+
+				float progress = (float)start / numFrames * 25 + progressbase;
+				if (cb(progress, start, numFrames, numFrames) == false) {
+					if (pool) pool->wait();
+					THROW(RuntimeException, "Cancel requested");
+				}
+			}
+			if (evalStart >= 0) {
+				if (pool) pool->wait();
+				addFrames(batches[evalBuf], evalStart, evalCount);
 			}
 
 			codec->DecodeEnd();
@@ -993,37 +1332,8 @@ class LogoAnalyzer : AMTObject
 		int maxi = (int)(std::max_element(numMinFades.begin(), numMinFades.end()) - numMinFades.begin());
 		printf("maxi = %d (%.1f%%)\n", maxi, numMinFades[maxi] / (float)numFrames * 100.0f);
 
-		LogoScan logoscan(scanw, scanh, logUVx, logUVy, thy);
-		{
-			LosslessVideoFile file(ctx, workfile, _T("rb"));
-			file.readHeader();
-			auto extra = file.getExtra();
-
-			if (codec->DecodeBegin(UTVF_YV12, scanw, scanh, CBGROSSWIDTH_WINDOWS, extra.data(), (int)extra.size())) {
-				THROW(RuntimeException, "failed to DecodeBegin (UtVideo)");
-			}
-
-			int scanUVw = scanw >> logUVx;
-			int scanUVh = scanh >> logUVy;
-			int offU = scanw * scanh;
-			int offV = offU + scanUVw * scanUVh;
-
-			// 全フレームループ
-			for (int i = 0; i < numFrames; ++i) {
-				int64_t codedSize = file.readFrame(i, memCoded.get());
-				if (codec->DecodeFrame(memScanData.get(), memCoded.get()) != scanDataSize) {
-					THROW(RuntimeException, "failed to DecodeFrame (UtVideo)");
-				}
-				// ロゴのあるフレームだけAddFrame
-				if (minFades[i] > 8) { // TODO: 調整
-					const uint8_t* ptr = memScanData.get();
-					logoscan.AddFrame(ptr, ptr + offU, ptr + offV, scanw, scanUVw);
-				}
-
-				if ((i % 2000) == 0) printf("%d frames\n", i);
-			}
-
-			codec->DecodeEnd();
+		if (outMinFades) {
+			*outMinFades = minFades;
 		}
 
 		// ロゴ作成
@@ -1050,11 +1360,30 @@ public:
 		, scanh(h)
 		, thy(thy)
 		, numMaxFrames(numMaxFrames)
+		, numThreads(0)
 		, cb(cb)
 	{
 		//
 	}
 
+	// ロゴ評価のスレッド数（0で自動）
+	void setNumThreads(int threads) {
+		numThreads = threads;
+	}
+
+	// スキャン済みの作業ファイルと初期ロゴからロゴを1回作り直す（テスト用）
+	std::unique_ptr<LogoData> ReMakeLogoFromWorkfile(std::unique_ptr<LogoData>&& initial,
+		int numFrames_, int logUVx_, int logUVy_, bool serial, std::vector<int>& outMinFades)
+	{
+		logodata = std::move(initial);
+		numFrames = numFrames_;
+		logUVx = logUVx_;
+		logUVy = logUVy_;
+		progressbase = 0;
+		ReMakeLogo(serial, &outMinFades);
+		return std::move(logodata);
+	}
+
 	void ScanLogo()
 	{
 		// 有効フレームデータと初期ロゴの取得
@@ -1517,6 +1846,210 @@ public:
 	}
 };
 
+// 解析用のプロキシ映像ファイル
+// 縮小した輝度プレーンを色差無彩色のYV12にしてUtVideoで可逆圧縮する
+// 形式はLosslessVideoFileそのまま（全フレームキーフレームなのでランダムアクセスできる）
+// フレームレートは持たないので使う側で元のソースに合わせる
+class LumaProxyFile : AMTObject
+{
+public:
+	// 読み込み（全フレーム書き込まれていないファイルは読まない）
+	LumaProxyFile(AMTContext& ctx, const tstring& path)
+		: AMTObject(ctx)
+		, file(ctx, path, _T("rb"))
+		, codec(make_unique_ptr(CCodec::CreateInstance(UTVF_ULH0, "Amatsukaze")))
+		, readMode(true)
+		, encoding(false)
+		, scale(0)
+		, shift(0)
+		, current(0)
+	{
+		file.readHeader();
+		if (!file.isComplete()) {
+			THROW(FormatException, "[LumaProxyFile] プロキシファイルが途中までしかありません");
+		}
+		width = file.getWidth();
+		height = file.getHeight();
+		numFrames = file.getNumFrames();
+		auto extra = file.getExtra();
+		if (codec->DecodeBegin(UTVF_YV12, width, height, CBGROSSWIDTH_WINDOWS, extra.data(), (int)extra.size())) {
+			THROW(RuntimeException, "failed to DecodeBegin (UtVideo)");
+		}
+		coded.resize(codec->EncodeGetOutputSize(UTVF_YV12, width, height));
+		raw.resize(width * height * 3 / 2);
+	}
+
+	// 書き込み（srcWidth,srcHeightは元映像のサイズ、scaleは縮小率）
+	LumaProxyFile(AMTContext& ctx, const tstring& path,
+		int srcWidth, int srcHeight, int scale, int bitsPerComponent, int numFrames)
+		: AMTObject(ctx)
+		, file(ctx, path, _T("wb"))
+		, codec(make_unique_ptr(CCodec::CreateInstance(UTVF_ULH0, "Amatsukaze")))
+		, readMode(false)
+		, encoding(false)
+		, width((srcWidth / scale) & ~1)
+		, height((srcHeight / scale) & ~1)
+		, numFrames(numFrames)
+		, scale(scale)
+		, shift(bitsPerComponent - 8)
+		, current(0)
+	{
+		size_t extraSize = codec->EncodeGetExtraDataSize();
+		std::vector<uint8_t> extra(extraSize);
+		if (codec->EncodeGetExtraData(extra.data(), extraSize, UTVF_YV12, width, height)) {
+			THROW(RuntimeException, "failed to EncodeGetExtraData (UtVideo)");
+		}
+		if (codec->EncodeBegin(UTVF_YV12, width, height, CBGROSSWIDTH_WINDOWS)) {
+			THROW(RuntimeException, "failed to EncodeBegin (UtVideo)");
+		}
+		encoding = true;
+		file.writeHeader(width, height, numFrames, extra);
+		coded.resize(codec->EncodeGetOutputSize(UTVF_YV12, width, height));
+		// 色差は無彩色で固定
+		raw.resize(width * height * 3 / 2);
+		std::fill(raw.begin() + width * height, raw.end(), 128);
+	}
+
+	~LumaProxyFile() {
+		if (readMode) {
+			codec->DecodeEnd();
+		}
+		else if (encoding) {
+			codec->EncodeEnd();
+		}
+	}
+
+	static bool IsComplete(AMTContext& ctx, const tstring& path) {
+		if (File::exists(path) == false) {
+			return false;
+		}
+		try {
+			LosslessVideoFile file(ctx, path, _T("rb"));
+			file.readHeader();
+			return file.isComplete();
+		}
+		catch (const IOException&) {
+			return false;
+		}
+	}
+
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+	int getNumFrames() const { return numFrames; }
+
+	// フレームは先頭から順に書く
+	template <typename pixel_t>
+	void writeFrame(const pixel_t* srcY, int pitchY)
+	{
+		int area = scale * scale;
+		uint8_t* proxy = raw.data();
+		for (int y = 0; y < height; ++y) {
+			for (int x = 0; x < width; ++x) {
+				const pixel_t* src = srcY + x * scale + y * scale * pitchY;
+				int sum = 0;
+				for (int ky = 0; ky < scale; ++ky) {
+					for (int kx = 0; kx < scale; ++kx) {
+						sum += src[kx + ky * pitchY];
+					}
+				}
+				proxy[x + y * width] = (uint8_t)(((sum + area / 2) / area) >> shift);
+			}
+		}
+		bool keyFrame = false;
+		size_t codedSize = codec->EncodeFrame(coded.data(), &keyFrame, raw.data());
+		file.writeFrame(coded.data(), (int)codedSize);
+		++current;
+	}
+
+	// 全フレーム書いたら呼ぶ
+	void finish()
+	{
+		if (current != numFrames) {
+			THROWF(InvalidOperationException, "[LumaProxyFile] フレーム数が合いません %d/%d", current, numFrames);
+		}
+		codec->EncodeEnd();
+		encoding = false;
+		file.flush();
+	}
+
+	// 縮小輝度（width x height、8bit）
+	const uint8_t* readFrame(int n)
+	{
+		n = std::max(0, std::min(numFrames - 1, n));
+		file.readFrame(n, coded.data());
+		if (codec->DecodeFrame(raw.data(), coded.data()) != raw.size()) {
+			THROWF(FormatException, "[LumaProxyFile] フレーム%dが読めません", n);
+		}
+		return raw.data();
+	}
+
+private:
+	LosslessVideoFile file;
+	CCodecPointer codec;
+	bool readMode;
+	bool encoding;
+	int width, height;
+	int numFrames;
+	int scale;
+	int shift;
+	int current;
+	std::vector<uint8_t> coded;
+	std::vector<uint8_t> raw;
+};
+
+// プロキシファイルの縮小輝度をYV12のクリップとして出す（色差は無彩色）
+// chapter_exeのシーンチェンジ検出用。フレームレートはAssumeFPSで元のソースに合わせること
+class AMTLumaProxySource : public IClip
+{
+	AMTContext ctx;
+	LumaProxyFile file;
+	VideoInfo vi;
+public:
+	AMTLumaProxySource(const tstring& path)
+		: ctx()
+		, file(ctx, path)
+		, vi()
+	{
+		vi.width = file.getWidth();
+		vi.height = file.getHeight();
+		vi.num_frames = file.getNumFrames();
+		vi.pixel_type = VideoInfo::CS_YV12;
+		vi.SetFPS(30000, 1001);
+	}
+
+	PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env)
+	{
+		const uint8_t* srcY = file.readFrame(n);
+		PVideoFrame dst = env->NewVideoFrame(vi);
+		env->BitBlt(dst->GetWritePtr(PLANAR_Y), dst->GetPitch(PLANAR_Y),
+			srcY, vi.width, vi.width, vi.height);
+		for (int plane : { PLANAR_U, PLANAR_V }) {
+			uint8_t* dstp = dst->GetWritePtr(plane);
+			int pitch = dst->GetPitch(plane);
+			for (int y = 0; y < vi.height / 2; ++y) {
+				memset(dstp + y * pitch, 128, vi.width / 2);
+			}
+		}
+		return dst;
+	}
+
+	void __stdcall GetAudio(void* buf, __int64 start, __int64 count, IScriptEnvironment* env) { return; }
+	const VideoInfo& __stdcall GetVideoInfo() { return vi; }
+	bool __stdcall GetParity(int n) { return false; }
+
+	int __stdcall SetCacheHints(int cachehints, int frame_range)
+	{
+		if (cachehints == CACHE_GET_MTMODE) return MT_SERIALIZED;
+		return 0;
+	};
+
+	static AVSValue __cdecl Create(AVSValue args, void* user_data, IScriptEnvironment* env)
+	{
+		return new AMTLumaProxySource(
+			to_tstring(args[0].AsString())); // path
+	}
+};
+
 class LogoFrame : AMTObject
 {
 	int numLogos;
@@ -1536,12 +2069,14 @@ class LogoFrame : AMTObject
 	int bestLogo;
 	float logoRatio;
 
+	// ロゴ評価スレッド数（0で自動）
+	int numThreads;
+
+	// srcYは画像の(originX,originY)の位置
 	template <typename pixel_t>
-	void ScanFrame(PVideoFrame& frame, float* memDeint, float* memWork, float maxv, EvalResult* outResult)
+	void ScanFrame(const pixel_t* srcY, int pitchY, int originX, int originY,
+		float* memDeint, float* memWork, float maxv, EvalResult* outResult)
 	{
-		const pixel_t* srcY = reinterpret_cast<const pixel_t*>(frame->GetReadPtr(PLANAR_Y));
-		int pitchY = frame->GetPitch(PLANAR_Y);
-
 		for (int i = 0; i < numLogos; ++i) {
 			LogoDataParam& logo = deintArr[i];
 			if (logo.isValid() == false ||
@@ -1554,7 +2089,7 @@ class LogoFrame : AMTObject
 			}
 
 			// フレームをインタレ解除
-			int off = logo.getImgX() + logo.getImgY() * pitchY;
+			int off = (logo.getImgX() - originX) + (logo.getImgY() - originY) * pitchY;
 			DeintY(memDeint, srcY + off, pitchY, logo.getWidth(), logo.getHeight());
 
 			// ロゴ評価
@@ -1563,30 +2098,202 @@ class LogoFrame : AMTObject
 		}
 	}
 
+	// ロゴ評価のワーカースレッド群
+	// デコード（GetFrame）はメインスレッドで行い、ロゴ領域だけコピーしたバッチを渡して
+	// ワーカーが並列に評価する。結果はフレーム番号の位置に書くので出力順は決定的
+	template <typename pixel_t>
+	class EvalPool
+	{
+	public:
+		struct Batch {
+			int start;
+			int count;
+			std::vector<pixel_t> crops; // ロゴ領域をcount枚
+		};
+
+		EvalPool(LogoFrame* pThis, float maxv, int cropX, int cropY, int cropW, int cropH, int numThreads)
+			: pThis(pThis)
+			, maxv(maxv)
+			, cropX(cropX)
+			, cropY(cropY)
+			, cropW(cropW)
+			, cropH(cropH)
+			, maxQueue(numThreads * 2)
+			, finished(false)
+		{
+			for (int i = 0; i < numThreads; ++i) {
+				workers.emplace_back(new Worker(this));
+			}
+			for (auto& w : workers) {
+				w->start();
+			}
+		}
+
+		~EvalPool() {
+			join();
+		}
+
+		void put(Batch&& batch) {
+			std::unique_lock<std::mutex> lock(mutex);
+			while (queue.size() >= maxQueue) {
+				condFull.wait(lock);
+			}
+			queue.push_back(std::move(batch));
+			condEmpty.notify_one();
+		}
+
+		// 全てのバッチを評価し終わるまで待つ
+		void join() {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				finished = true;
+				condEmpty.notify_all();
+			}
+			for (auto& w : workers) {
+				w->join();
+			}
+		}
+
+	private:
+		class Worker : public ThreadBase {
+		public:
+			Worker(EvalPool* pool) : pool(pool) { }
+		protected:
+			virtual void run() { pool->workerLoop(); }
+		private:
+			EvalPool* pool;
+		};
+
+		LogoFrame* pThis;
+		float maxv;
+		int cropX, cropY, cropW, cropH;
+		size_t maxQueue;
+		bool finished;
+		std::mutex mutex;
+		std::condition_variable condEmpty;
+		std::condition_variable condFull;
+		std::deque<Batch> queue;
+		std::vector<std::unique_ptr<Worker>> workers;
+
+		void workerLoop() {
+			auto memDeint = std::unique_ptr<float[]>(new float[pThis->maxYSize + 8]);
+			auto memWork = std::unique_ptr<float[]>(new float[pThis->maxYSize + 8]);
+			while (true) {
+				Batch batch;
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					while (queue.size() == 0) {
+						if (finished) return;
+						condEmpty.wait(lock);
+					}
+					batch = std::move(queue.front());
+					queue.pop_front();
+					condFull.notify_one();
+				}
+				for (int i = 0; i < batch.count; ++i) {
+					int n = batch.start + i;
+					pThis->ScanFrame<pixel_t>(&batch.crops[(size_t)i * cropW * cropH], cropW, cropX, cropY,
+						memDeint.get(), memWork.get(), maxv, &pThis->evalResults[n * pThis->numLogos]);
+				}
+			}
+		}
+	};
+
 	template <typename pixel_t>
-	void IterateFrames(PClip clip, IScriptEnvironment2* env)
+	void IterateFrames(PClip clip, IScriptEnvironment2* env, LumaProxyFile* proxy)
 	{
-		auto memDeint = std::unique_ptr<float[]>(new float[maxYSize + 8]);
-		auto memWork = std::unique_ptr<float[]>(new float[maxYSize + 8]);
 		float maxv = (float)((1 << vi.BitsPerComponent()) - 1);
 		evalResults = std::unique_ptr<EvalResult[]>(new EvalResult[vi.num_frames * numLogos]);
+
+		// 評価できるロゴがなければ全フレーム評価なし
+		int x0, y0, x1, y1;
+		bool hasLogo = GetLogoRect(x0, y0, x1, y1);
+		if (hasLogo == false) {
+			for (int i = 0; i < vi.num_frames * numLogos; ++i) {
+				evalResults[i].corr0 = 0;
+				evalResults[i].corr1 = -1;
+			}
+		}
+		int cropW = hasLogo ? (x1 - x0) : 0;
+		int cropH = hasLogo ? (y1 - y0) : 0;
+		size_t cropSize = (size_t)cropW * cropH;
+
+		const int batchFrames = 16;
+		std::unique_ptr<EvalPool<pixel_t>> pool;
+		if (hasLogo) {
+			pool = std::unique_ptr<EvalPool<pixel_t>>(
+				new EvalPool<pixel_t>(this, maxv, x0, y0, cropW, cropH, GetLogoThreads(numThreads)));
+		}
+		typename EvalPool<pixel_t>::Batch batch = typename EvalPool<pixel_t>::Batch();
+
 		for (int n = 0; n < vi.num_frames; ++n) {
 			PVideoFrame frame = clip->GetFrame(n, env);
-			ScanFrame<pixel_t>(frame, memDeint.get(), memWork.get(), maxv, &evalResults[n * numLogos]);
+			const pixel_t* srcY = reinterpret_cast<const pixel_t*>(frame->GetReadPtr(PLANAR_Y));
+			int pitchY = frame->GetPitch(PLANAR_Y) / sizeof(pixel_t);
+			if (pool) {
+				// ロゴ領域だけコピーしてワーカーに渡す
+				if (batch.count == 0) {
+					batch.start = n;
+					batch.crops.resize(cropSize * batchFrames);
+				}
+				pixel_t* dst = &batch.crops[cropSize * batch.count];
+				for (int y = 0; y < cropH; ++y) {
+					memcpy(dst + y * cropW, srcY + x0 + (y0 + y) * pitchY, cropW * sizeof(pixel_t));
+				}
+				if (++batch.count == batchFrames) {
+					pool->put(std::move(batch));
+					batch = typename EvalPool<pixel_t>::Batch();
+				}
+			}
+			if (proxy != nullptr) {
+				proxy->writeFrame<pixel_t>(srcY, pitchY);
+			}
 
 			if ((n % 5000) == 0) {
 				ctx.infoF("%6d/%d", n, vi.num_frames);
 			}
 		}
+		if (pool) {
+			if (batch.count > 0) {
+				pool->put(std::move(batch));
+			}
+			pool->join();
+		}
 		numFrames = vi.num_frames;
 		framesPerSec = (int)std::round((float)vi.fps_numerator / vi.fps_denominator);
 
+		if (proxy != nullptr) {
+			proxy->finish();
+		}
+
 		ctx.info("Finished");
 	}
 
+	// 評価対象になる全ロゴの外接矩形
+	bool GetLogoRect(int& x0, int& y0, int& x1, int& y1)
+	{
+		x0 = y0 = INT_MAX;
+		x1 = y1 = 0;
+		for (int i = 0; i < numLogos; ++i) {
+			LogoDataParam& logo = deintArr[i];
+			if (logo.isValid() == false ||
+				logo.getImgWidth() != vi.width ||
+				logo.getImgHeight() != vi.height)
+			{
+				continue;
+			}
+			x0 = std::min(x0, logo.getImgX());
+			y0 = std::min(y0, logo.getImgY());
+			x1 = std::max(x1, logo.getImgX() + logo.getWidth());
+			y1 = std::max(y1, logo.getImgY() + logo.getHeight());
+		}
+		return x0 < x1 && y0 < y1;
+	}
+
 public:
 	LogoFrame(AMTContext& ctx, const std::vector<tstring>& logofiles, float maskratio)
 		: AMTObject(ctx)
+		, numThreads(0)
 	{
 		numLogos = (int)logofiles.size();
 		logoArr = std::unique_ptr<LogoDataParam[]>(new LogoDataParam[logofiles.size()]);
@@ -1610,18 +2317,33 @@ public:
 		}
 	}
 
-	void scanFrames(PClip clip, IScriptEnvironment2* env)
+	// ロゴ評価のスレッド数（0で自動）
+	void setNumThreads(int threads) {
+		numThreads = threads;
+	}
+
+	// proxypathを指定するとスキャンしながら解析用プロキシファイルも作る
+	void scanFrames(PClip clip, IScriptEnvironment2* env, const tstring& proxypath = tstring())
 	{
 		vi = clip->GetVideoInfo();
 		int pixelSize = vi.ComponentSize();
-		switch (pixelSize) {
-		case 1:
-			return IterateFrames<uint8_t>(clip, env);
-		case 2:
-			return IterateFrames<uint16_t>(clip, env);
-		default:
+		if (pixelSize != 1 && pixelSize != 2) {
 			env->ThrowError("[LogoFrame] Unsupported pixel format");
 		}
+
+		std::unique_ptr<LumaProxyFile> proxy;
+		if (proxypath.size() > 0) {
+			// 1/4に縮小
+			proxy = std::unique_ptr<LumaProxyFile>(new LumaProxyFile(ctx, proxypath,
+				vi.width, vi.height, 4, vi.BitsPerComponent(), vi.num_frames));
+		}
+
+		if (pixelSize == 1) {
+			IterateFrames<uint8_t>(clip, env, proxy.get());
+		}
+		else {
+			IterateFrames<uint16_t>(clip, env, proxy.get());
+		}
 	}
 
 	void dumpResult(const tstring& basepath)
@@ -1637,6 +2359,102 @@ public:
 		}
 	}
 
+	struct FrameResult {
+		int result;
+		float score;
+	};
+
+	// MinMaxと移動平均で判定してメディアンで均したスコアを付ける
+	// rawScoresの前後max(halfAvgFrames,halfMedianFrames)は端の値で埋めてあること
+	// MinMaxは単調デック、メディアンは順序付き多重集合でウィンドウをずらしながら更新する
+	// 結果はFilterScoresSortと同じになる
+	static void FilterScores(const float* rawScores, int numFrames,
+		int halfAvgFrames, int halfMedianFrames, float thresh, float threshL, FrameResult* frameResult)
+	{
+		int aveFrames = halfAvgFrames * 2 + 1;
+
+		// 長さhalfAvgFramesの区間最大値 windowMax[s + halfAvgFrames] = max(rawScores[s, s+halfAvgFrames))
+		// （s = -halfAvgFrames ... numFrames）
+		std::vector<float> windowMax(numFrames + halfAvgFrames + 1);
+		std::deque<int> maxq;
+		for (int p = -halfAvgFrames; p < numFrames + halfAvgFrames; ++p) {
+			while (maxq.size() > 0 && rawScores[maxq.back()] <= rawScores[p]) {
+				maxq.pop_back();
+			}
+			maxq.push_back(p);
+			int s = p - halfAvgFrames + 1;
+			if (maxq.front() < s) {
+				maxq.pop_front();
+			}
+			if (s >= -halfAvgFrames) {
+				windowMax[s + halfAvgFrames] = rawScores[maxq.front()];
+			}
+		}
+
+		// メディアン用ウィンドウ（midが常に中央の要素を指す）
+		std::multiset<float> window(rawScores - halfMedianFrames, rawScores + halfMedianFrames + 1);
+		auto mid = std::next(window.begin(), halfMedianFrames);
+
+		for (int i = 0; i < numFrames; ++i) {
+			// MinMax
+			// 前の最大値と後ろの最大値の小さい方を取る
+			// 動きの多い映像でロゴがかき消されることがあるので、それを救済する
+			float beforeMax = windowMax[i];
+			float afterMax = windowMax[i + 1 + halfAvgFrames];
+			float minMax = std::min(beforeMax, afterMax);
+			int minMaxResult = (std::abs(minMax) < threshL) ? 1 : (minMax < 0.0f) ? 0 : 2;
+
+			// 移動平均
+			// MinMaxだけだと薄くても安定して表示されてるとかが識別できないので
+			// これも必要（累積和にすると丸めが変わるので窓ごとに足す）
+			float avg = std::accumulate(rawScores + i - halfAvgFrames,
+				rawScores + i + halfAvgFrames + 1, 0.0f) / aveFrames;
+			int avgResult = (std::abs(avg) < thresh) ? 1 : (avg < 0.0f) ? 0 : 2;
+
+			// 両者が違ってたら不明とする
+			frameResult[i].result = (minMaxResult != avgResult) ? 1 : minMaxResult;
+
+			// 生の値は動きが激しいので少しメディアンフィルタをかけておく
+			frameResult[i].score = *mid;
+
+			// ウィンドウを1つずらす
+			if (i + 1 < numFrames) {
+				float in = rawScores[i + halfMedianFrames + 1];
+				float out = rawScores[i - halfMedianFrames];
+				window.insert(in);
+				if (in < *mid) --mid;
+				if (out <= *mid) ++mid;
+				window.erase(window.lower_bound(out));
+			}
+		}
+	}
+
+	// ウィンドウごとにmax_elementとソートで求める版（FilterScoresの基準実装）
+	static void FilterScoresSort(const float* rawScores, int numFrames,
+		int halfAvgFrames, int halfMedianFrames, float thresh, float threshL, FrameResult* frameResult)
+	{
+		int aveFrames = halfAvgFrames * 2 + 1;
+		int medianFrames = halfMedianFrames * 2 + 1;
+		std::vector<float> medianBuf(medianFrames);
+		for (int i = 0; i < numFrames; ++i) {
+			float beforeMax = *std::max_element(rawScores + i - halfAvgFrames, rawScores + i);
+			float afterMax = *std::max_element(rawScores + i + 1, rawScores + i + 1 + halfAvgFrames);
+			float minMax = std::min(beforeMax, afterMax);
+			int minMaxResult = (std::abs(minMax) < threshL) ? 1 : (minMax < 0.0f) ? 0 : 2;
+
+			float avg = std::accumulate(rawScores + i - halfAvgFrames,
+				rawScores + i + halfAvgFrames + 1, 0.0f) / aveFrames;
+			int avgResult = (std::abs(avg) < thresh) ? 1 : (avg < 0.0f) ? 0 : 2;
+
+			frameResult[i].result = (minMaxResult != avgResult) ? 1 : minMaxResult;
+
+			std::copy(rawScores + i - halfMedianFrames,
+				rawScores + i + halfMedianFrames + 1, medianBuf.begin());
+			std::sort(medianBuf.begin(), medianBuf.end());
+			frameResult[i].score = medianBuf[halfMedianFrames];
+		}
+	}
+
 	void writeResult(const tstring& outpath)
 	{
 		// 絶対値<0.2fは不明とみなす
@@ -1695,40 +2513,10 @@ public:
 		// 両端を端の値で埋める
 		std::fill(rawScores_.begin(), rawScores, rawScores[0]);
 		std::fill(rawScores + numFrames, rawScores_.end(), rawScores[numFrames - 1]);
-		
-		struct FrameResult {
-			int result;
-			float score;
-		};
 
 		// フィルタで均す
 		std::vector<FrameResult> frameResult(numFrames);
-		std::vector<float> medianBuf(medianFrames);
-		for (int i = 0; i < numFrames; ++i) {
-			// MinMax
-			// 前の最大値と後ろの最大値の小さい方を取る
-			// 動きの多い映像でロゴがかき消されることがあるので、それを救済する
-			float beforeMax = *std::max_element(rawScores + i - halfAvgFrames, rawScores + i);
-			float afterMax = *std::max_element(rawScores + i + 1, rawScores + i + 1 + halfAvgFrames);
-			float minMax = std::min(beforeMax, afterMax);
-			int minMaxResult = (std::abs(minMax) < threshL) ? 1 : (minMax < 0.0f) ? 0 : 2;
-
-			// 移動平均
-			// MinMaxだけだと薄くても安定して表示されてるとかが識別できないので
-			// これも必要
-			float avg = std::accumulate(rawScores + i - halfAvgFrames,
-				rawScores + i + halfAvgFrames + 1, 0.0f) / aveFrames;
-			int avgResult = (std::abs(avg) < thresh) ? 1 : (avg < 0.0f) ? 0 : 2;
-
-			// 両者が違ってたら不明とする
-			frameResult[i].result = (minMaxResult != avgResult) ? 1 : minMaxResult;
-
-			// 生の値は動きが激しいので少しメディアンフィルタをかけておく
-			std::copy(rawScores + i - halfMedianFrames,
-				rawScores + i + halfMedianFrames + 1, medianBuf.begin());
-			std::sort(medianBuf.begin(), medianBuf.end());
-			frameResult[i].score = medianBuf[halfMedianFrames];
-		}
+		FilterScores(&rawScores[0], numFrames, halfAvgFrames, halfMedianFrames, thresh, threshL, frameResult.data());
 
 		// 不明部分を推測
 		// 両側がロゴありとなっていたらロゴありとする
@@ -1814,6 +2602,13 @@ public:
 	float getLogoRatio() const {
 		return logoRatio;
 	}
+
+	// フレームnのロゴlogoIndexの評価値
+	void getEvalResult(int n, int logoIndex, float& corr0, float& corr1) const {
+		const EvalResult& r = evalResults[n * numLogos + logoIndex];
+		corr0 = r.corr0;
+		corr1 = r.corr1;
+	}
 };
 
 } // namespace logo
@@ -318,6 +318,13 @@ public:
 	class EventHandler {
 	public:
 		virtual void onStreamData(MemoryChunk mc) = 0;
+		// 1pack\f[^iwb_PESyC[hʁX̃ɂj
+		// ܂Ƃ߂ď߂ꍇ̓I[o[Ch
+		virtual void onStreamData(const MemoryChunk* chunks, int numChunks) {
+			for (int i = 0; i < numChunks; ++i) {
+				onStreamData(chunks[i]);
+			}
+		}
 	};
 
 	PsStreamWriter(AMTContext& ctx)
@@ -331,6 +338,7 @@ public:
 		videoStreamType = 0;
 		audioStreamType = 0;
 		nextIsPSM = true;
+		headerEnd = 0;
 	}
 
 	void setHandler(EventHandler* handler) {
@@ -415,7 +423,16 @@ private:
 	bool nextIsPSM;
 
 	// outVideoPesPacket, outAudioPesPacket̍ŌŕKNA邱
+	// bufferɂ̓wb_AyC[h̓Rs[PESpPbgw
 	AutoBuffer buffer;
+	struct PackSegment {
+		const uint8_t* data; // NULLȂbuffer
+		size_t offset;
+		size_t length;
+	};
+	std::vector<PackSegment> segments;
+	std::vector<MemoryChunk> chunks;
+	size_t headerEnd; // buffer̂segmentsɓꂽʒu
 	
 	void initWhenNeeded(int64_t clock) {
 		if (systemClock.currentClock == -1) {
@@ -550,7 +567,7 @@ private:
 				// 擪ȊO
 				writePesPacketHeader(writer, stream_id, length, 0, 0, 0);
 			}
-			buffer.add(MemoryChunk(payload.data + offset, length));
+			addPayload(MemoryChunk(payload.data + offset, length));
 
 			offset += length;
 
@@ -580,16 +597,42 @@ private:
 		esBuffer.accessUnits.push_back(au);
 	}
 
+	// bufferɏ񂾃wb_؂ăyC[hǉ
+	void addPayload(MemoryChunk payload) {
+		closeHeaderSegment();
+		PackSegment seg = { payload.data, 0, payload.length };
+		segments.push_back(seg);
+	}
+
+	void closeHeaderSegment() {
+		if (buffer.size() > headerEnd) {
+			PackSegment seg = { NULL, headerEnd, buffer.size() - headerEnd };
+			segments.push_back(seg);
+			headerEnd = buffer.size();
+		}
+	}
+
 	// bufferɏpacko
 	void outPack() {
+		closeHeaderSegment();
+		// buffer͏ݒɍĊmۂ邱Ƃ̂łŃAhXɂ
+		size_t totalBytes = 0;
+		chunks.clear();
+		for (const auto& seg : segments) {
+			uint8_t* data = const_cast<uint8_t*>((seg.data != NULL) ? seg.data : buffer.ptr() + seg.offset);
+			chunks.push_back(MemoryChunk(data, seg.length));
+			totalBytes += seg.length;
+		}
 		// f[^o
 		if (handler != NULL) {
-			handler->onStreamData(buffer.get());
+			handler->onStreamData(chunks.data(), (int)chunks.size());
 		}
 		// NbNi߂
-		proceedClock((int)buffer.size());
+		proceedClock((int)totalBytes);
 		// obt@NAĂ
 		buffer.clear();
+		segments.clear();
+		headerEnd = 0;
 	}
 
 	static int audioBufferSize(int nChannel) {
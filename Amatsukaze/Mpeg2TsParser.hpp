@@ -7,6 +7,8 @@
 */
 #pragma once
 
+#include <emmintrin.h>
+
 #include "StreamUtils.hpp"
 
 /** @brief TSpPbg̃A_ve[VtB[h */
@@ -267,6 +269,82 @@ private:
 	int payload_offset;
 };
 
+// ʒu
+// data̒numPacketsATS_PACKET_LENGTHԊuœoCgłŏ̈ʒuԂ
+// numPackets̃pPbgSĂʒû݂Ώ
+// Ȃꍇ-1
+static int FindTsSyncPosition(const uint8_t* data, int size, int numPackets)
+{
+	int last = size - numPackets * TS_PACKET_LENGTH;
+	for (int pos = 0; pos <= last; ++pos) {
+		if (data[pos] == TS_SYNC_BYTE) {
+			int i = 1;
+			for (; i < numPackets; ++i) {
+				if (data[pos + TS_PACKET_LENGTH * i] != TS_SYNC_BYTE) break;
+			}
+			if (i == numPackets) {
+				return pos;
+			}
+		}
+	}
+	return -1;
+}
+
+// 16ʒuɃ`FbN
+static int FindTsSyncPosition_SSE2(const uint8_t* data, int size, int numPackets)
+{
+	int last = size - numPackets * TS_PACKET_LENGTH;
+	const __m128i sync = _mm_set1_epi8((char)TS_SYNC_BYTE);
+	int pos = 0;
+	for (; pos + 15 <= last; pos += 16) {
+		__m128i m = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data + pos)), sync);
+		if (_mm_movemask_epi8(m) == 0) continue;
+		for (int i = 1; i < numPackets; ++i) {
+			m = _mm_and_si128(m, _mm_cmpeq_epi8(
+				_mm_loadu_si128((const __m128i*)(data + pos + TS_PACKET_LENGTH * i)), sync));
+		}
+		int mask = _mm_movemask_epi8(m);
+		if (mask != 0) {
+			unsigned long idx;
+			_BitScanForward(&idx, mask);
+			return pos + idx;
+		}
+	}
+	// c
+	int ret = FindTsSyncPosition(data + pos, size - pos, numPackets);
+	return (ret == -1) ? -1 : pos + ret;
+}
+
+// ComputeKernel.cpp
+bool IsAVX2Available();
+int FindTsSyncPosition_AVX2(const uint8_t* data, int size, int numPackets);
+
+/** @brief PID̃rbg}bv */
+class PidFilter {
+public:
+	PidFilter() : bits() { }
+
+	void clear() {
+		for (auto& b : bits) b = 0;
+	}
+	void set(int pid) {
+		bits[pid >> 6] |= (uint64_t)1 << (pid & 63);
+	}
+	void reset(int pid) {
+		bits[pid >> 6] &= ~((uint64_t)1 << (pid & 63));
+	}
+	bool test(int pid) const {
+		return ((bits[pid >> 6] >> (pid & 63)) & 1) != 0;
+	}
+	void merge(const PidFilter& o) {
+		for (int i = 0; i < NUM_WORDS; ++i) bits[i] |= o.bits[i];
+	}
+
+private:
+	enum { NUM_WORDS = (MAX_PID + 1) / 64 };
+	uint64_t bits[NUM_WORDS];
+};
+
 /** @brief TSpPbg؂o
 * inputTS()Kv񐔌ĂяočŌflush()KĂяoƁB
 * flush()ĂяoȂƓ̃obt@Ɏcf[^ȂB
@@ -280,12 +358,32 @@ public:
 	TsPacketParser(AMTContext& ctx)
 		: AMTObject(ctx)
 		, syncOK(false)
-	{ }
+		, streamPos(0)
+		, packetOffset(-1)
+		, pidFilter(nullptr)
+		, numSkipped(0)
+	{
+		pFindTsSyncPosition = IsAVX2Available() ? FindTsSyncPosition_AVX2 : FindTsSyncPosition_SSE2;
+	}
 
-	/** @brief TSf[^ */
+	/** @brief TSf[^
+	* ĂԂ͓̓f[^璼ڃpPbg؂ô
+	* obt@ɂ̓pPbgE܂[Rs[Ȃ
+	* ionTsPacketɓnpPbginputTS߂܂łLłȂƂɒӁj
+	*/
 	void inputTS(MemoryChunk data) {
 
+		if (syncOK) {
+			size_t consumed = completeBuffer(data);
+			if (syncOK && buffer.size() == 0) {
+				consumed += outPacketsDirect(
+					MemoryChunk(data.data + consumed, data.length - consumed));
+			}
+			data = MemoryChunk(data.data + consumed, data.length - consumed);
+		}
+
 		buffer.add(data);
+		streamPos += data.length;
 
 		if (syncOK) {
 			outPackets();
@@ -297,11 +395,19 @@ public:
 				outPackets();
 			}
 			else {
-				// _̂1oCgXLbv
+				// _̂Ŏɓʒu܂ŃXLbv
 				syncOK = false;
-				buffer.trimHead(1);
+				int pos = pFindTsSyncPosition(buffer.ptr() + 1, (int)buffer.size() - 1, CHECK_PACKET_NUM);
+				if (pos == -1) {
+					// `FbNłʒuɂ͌Ȃ
+					buffer.trimHead(buffer.size() - (CHECK_PACKET_NUM*TS_PACKET_LENGTH - 1));
+				}
+				else {
+					buffer.trimHead(pos + 1);
+				}
 			}
 		}
+		outSkipped();
 	}
 
 	/** @brief obt@tbV */
@@ -310,13 +416,14 @@ public:
 			// 擪pPbg̓R[hĂΏo͂
 			if (checkSyncByte(buffer.ptr(), 1))
 			{
-				checkAndOutPacket(MemoryChunk(buffer.ptr(), TS_PACKET_LENGTH));
+				checkAndOutPacket(MemoryChunk(buffer.ptr(), TS_PACKET_LENGTH), bufferHeadOffset());
 				buffer.trimHead(TS_PACKET_LENGTH);
 			}
 			else {
 				buffer.trimHead(1);
 			}
 		}
+		outSkipped();
 	}
 
 	/** @brief cĂf[^SăNA */
@@ -325,13 +432,35 @@ public:
 		syncOK = false;
 	}
 
+	/** @brief onTsPacketŏ̃pPbg̓̓f[^擪̈ʒu */
+	int64_t getPacketOffset() const {
+		return packetOffset;
+	}
+
+	/** @brief filterɂȂPID̃pPbgonTsPacketĂ΂Ɏ̂ĂinullptrŖj
+	* filter̓p[T̊OōXVĂ悢ipPbgƂɎQƂj
+	* ̂ĂpPbg͐onTsPacketsSkippedł܂Ƃ߂Ēʒm
+	*/
+	void setPidFilter(const PidFilter* filter) {
+		outSkipped();
+		pidFilter = filter;
+	}
+
 protected:
 	/** @brief ؂肾ꂽTSpPbg */
 	virtual void onTsPacket(TsPacket packet) = 0;
 
+	/** @brief PIDtB^Ŏ̂ĂpPbgiɏo͂pPbgOɒʒmj */
+	virtual void onTsPacketsSkipped(int numPackets) { }
+
 private:
 	AutoBuffer buffer;
 	bool syncOK;
+	int64_t streamPos; // obt@i=̓̓f[^擪j̈ʒu
+	int64_t packetOffset;
+	const PidFilter* pidFilter;
+	int numSkipped;
+	int(*pFindTsSyncPosition)(const uint8_t* data, int size, int numPackets);
 
 	// numPacket̃pPbg̓oCgĂ邩`FbN
 	bool checkSyncByte(uint8_t* ptr, int numPacket) {
@@ -343,21 +472,90 @@ private:
 		return true;
 	}
 
+	// obt@擪̈ʒu
+	int64_t bufferHeadOffset() const {
+		return streamPos - buffer.size();
+	}
+
 	// u擪Ǝ̃pPbg̓oCgčĂΏóvJԂ
 	void outPackets() {
 		while (buffer.size() >= 2 * TS_PACKET_LENGTH &&
 			checkSyncByte(buffer.ptr(), 2))
 		{
-			checkAndOutPacket(MemoryChunk(buffer.ptr(), TS_PACKET_LENGTH));
+			checkAndOutPacket(MemoryChunk(buffer.ptr(), TS_PACKET_LENGTH), bufferHeadOffset());
 			// onTsPacketresetĂ΂邩Ȃ̂Œ
 			buffer.trimHead(TS_PACKET_LENGTH);
 		}
 	}
 
+	// O̒[pPbgE܂ŕďo͂
+	// ̓f[^̐擪̃pPbg̓oCgɂȂĂ΃obt@͋ɂȂ
+	// ߂l: obt@ɒǉoCg
+	size_t completeBuffer(MemoryChunk data) {
+		if (buffer.size() == 0) {
+			return 0;
+		}
+		size_t rem = buffer.size() % TS_PACKET_LENGTH;
+		size_t need = (rem > 0) ? (TS_PACKET_LENGTH - rem) : 0;
+		if (data.length <= need) {
+			// Ȃ̂őSobt@ɓ
+			return 0;
+		}
+		buffer.add(MemoryChunk(data.data, need));
+		streamPos += need;
+		int numPackets = (int)(buffer.size() / TS_PACKET_LENGTH);
+		if (checkSyncByte(buffer.ptr(), numPackets) && data.data[need] == TS_SYNC_BYTE) {
+			while (buffer.size() >= TS_PACKET_LENGTH) {
+				checkAndOutPacket(MemoryChunk(buffer.ptr(), TS_PACKET_LENGTH), bufferHeadOffset());
+				// onTsPacketresetĂ΂邩Ȃ̂Œ
+				buffer.trimHead(TS_PACKET_LENGTH);
+			}
+			if (!syncOK) {
+				// resetꂽ̂Ŏĉ͎Ă
+				streamPos += data.length - need;
+				return data.length;
+			}
+		}
+		return need;
+	}
+
+	// ̓f[^Rs[ɃpPbgo
+	// ߂l: oCg
+	size_t outPacketsDirect(MemoryChunk data) {
+		size_t pos = 0;
+		while (data.length - pos >= 2 * TS_PACKET_LENGTH &&
+			checkSyncByte(data.data + pos, 2))
+		{
+			checkAndOutPacket(MemoryChunk(data.data + pos, TS_PACKET_LENGTH), streamPos + pos);
+			pos += TS_PACKET_LENGTH;
+			if (!syncOK) {
+				// resetꂽ̂Ŏĉ͎Ă
+				streamPos += data.length;
+				return data.length;
+			}
+		}
+		streamPos += pos;
+		return pos;
+	}
+
+	void outSkipped() {
+		if (numSkipped > 0) {
+			int n = numSkipped;
+			numSkipped = 0;
+			onTsPacketsSkipped(n);
+		}
+	}
+
 	// pPbg`FbNďo
-	void checkAndOutPacket(MemoryChunk data) {
+	void checkAndOutPacket(MemoryChunk data, int64_t offset) {
 		TsPacket packet(data.data);
 		if (packet.parse() && packet.check()) {
+			if (pidFilter != nullptr && !pidFilter->test(packet.PID())) {
+				++numSkipped;
+				return;
+			}
+			outSkipped();
+			packetOffset = offset;
 			onTsPacket(packet);
 		}
 	}
@@ -366,11 +564,19 @@ private:
 class TsPacketHandler {
 public:
 	virtual void onTsPacket(int64_t clock, TsPacket packet) = 0;
+
+	// PIDtB^Ŏ̂ĂꂽpPbg̐
+	virtual void onTsPacketsSkipped(int numPackets) { }
 };
 
 class PesParser : public TsPacketHandler {
 public:
-	PesParser() : contCounter(0) {}
+	PesParser() : contCounter(0), packetOffset(-1), bufferOffset(-1), pesOffset(-1) {}
+
+	/** @brief ɓ͂TSpPbg̃t@C̈ʒuZbgiPES̈ʒuKvȏꍇ̂݁j */
+	void setPacketOffset(int64_t offset) {
+		packetOffset = offset;
+	}
 
 	/** @brief TSpPbg(`FbNς) */
 	virtual void onTsPacket(int64_t clock, TsPacket packet) {
@@ -397,6 +603,9 @@ public:
 			}
 
 			MemoryChunk payload = packet.payload();
+			if (buffer.size() == 0) {
+				bufferOffset = packetOffset;
+			}
 			buffer.add(payload);
 
 			// `FbN
@@ -408,17 +617,34 @@ public:
 					// pPbg̃XgA
 					checkAndOutPacket(clock, MemoryChunk(buffer.ptr(), lengthIncludeHeader));
 					buffer.trimHead(lengthIncludeHeader);
+					bufferOffset = packetOffset;
 				}
 			}
 		}
 	}
 
+	/** @brief ̃pPbgX^[g҂ɒ~ϒPESpPbgo */
+	void flush(int64_t clock) {
+		if (buffer.size() > 0) {
+			checkAndOutPacket(clock, buffer.get());
+			buffer.clear();
+		}
+	}
+
 protected:
 	virtual void onPesPacket(int64_t clock, PESPacket packet) = 0;
 
+	/** @brief onPesPacketŏo͒PES̐擪TSpPbg̈ʒuisȏꍇ-1j */
+	int64_t getPesOffset() const {
+		return pesOffset;
+	}
+
 private:
 	AutoBuffer buffer;
 	int contCounter;
+	int64_t packetOffset;
+	int64_t bufferOffset;
+	int64_t pesOffset;
 
 	// pPbg`FbNďo
 	void checkAndOutPacket(int64_t clock, MemoryChunk data) {
@@ -426,6 +652,7 @@ private:
 		// tH[}bg`FbN
 		if (packet.parse() && packet.check()) {
 			// OK
+			pesOffset = bufferOffset;
 			onPesPacket(clock, packet);
 		}
 	}
@@ -997,6 +1224,7 @@ public:
 	{
 		constHandlers[pid] = handler;
 		table[pid] = handler;
+		pidFilter.set(pid);
 	}
 
 	/** @brief ԍpidʒuhandlerZbg
@@ -1018,12 +1246,14 @@ public:
 		auto it = handlers.find(handler);
 		if (it != handlers.end()) {
 			table[it->second] = NULL;
+			pidFilter.reset(it->second);
 		}
 		if (table[pid] != NULL) {
 			handlers.erase(table[pid]);
 		}
 		table[pid] = handler;
 		handlers[handler] = pid;
+		pidFilter.set(pid);
 		return true;
 	}
 
@@ -1031,6 +1261,11 @@ public:
 		return table[pid];
 	}
 
+	// nhZbgĂPID
+	const PidFilter& getPidFilter() const {
+		return pidFilter;
+	}
+
 	void clear() {
 		for (auto pair : handlers) {
 			auto it = constHandlers.find(pair.second);
@@ -1040,6 +1275,7 @@ public:
 			}
 			else {
 				table[pair.second] = NULL;
+				pidFilter.reset(pair.second);
 			}
 		}
 		handlers.clear();
@@ -1058,6 +1294,7 @@ public:
 
 private:
 	TsPacketHandler *table[MAX_PID + 1];
+	PidFilter pidFilter;
 	std::map<int, TsPacketHandler*> constHandlers;
 	std::map<TsPacketHandler*, int> handlers;
 };
@@ -1111,6 +1348,7 @@ public:
 		initHandlerTable(curHandlerTable);
 		nextHandlerTable = new PidHandlerTable();
 		initHandlerTable(nextHandlerTable);
+		updatePassFilter();
 	}
 
 	~TsPacketSelector() {
@@ -1136,6 +1374,20 @@ public:
 		PsiParserPMT.clear();
 	}
 
+	// nhȂĂʂPIDiPCRȂǁj
+	void addPassPid(int pid) {
+		if (pid >= 0 && pid <= MAX_PID) {
+			passPids.set(pid);
+			updatePassFilter();
+		}
+	}
+
+	// inputTsPacketŏPIDiTsPacketParser::setPidFilterpj
+	// PAT,PMT̍XVŕς邪IuWFNgXV
+	const PidFilter* getPassFilter() const {
+		return &passFilter;
+	}
+
 	void inputTsPacket(int64_t clock, TsPacket packet) {
 
 		currentClock = clock;
@@ -1224,6 +1476,9 @@ private:
 	PidHandlerTable *curHandlerTable;
 	PidHandlerTable *nextHandlerTable;
 
+	PidFilter passPids;
+	PidFilter passFilter;
+
 	TsPacketSelectorHandler *selectorHandler;
 
 	// 27MHzNbN
@@ -1235,6 +1490,15 @@ private:
 		table->addConstant(0x0014, &PsiParserTDT);
 	}
 
+	void updatePassFilter() {
+		passFilter = curHandlerTable->getPidFilter();
+		passFilter.merge(passPids);
+		if (waitingNewVideo) {
+			// e[u؂ւ̂ɂȂ̂ŐVfʂ
+			passFilter.set(videoEs.pid);
+		}
+	}
+
 	void onPatUpdated(PsiSection section) {
 		if (selectorHandler == NULL) {
 			return;
@@ -1273,6 +1537,7 @@ private:
 				pmtPid = pid;
 				curHandlerTable->add(pmtPid, &PsiParserPMT);
 			}
+			updatePassFilter();
 		}
 	}
 
@@ -1348,6 +1613,7 @@ private:
 			if (captionEs.pid != -1) {
 				table->add(captionEs.pid, &captionDelegator);
 			}
+			updatePassFilter();
 
 			selectorHandler->onPmtUpdated(pmt.PCR_PID());
 			if (table == curHandlerTable) {
@@ -1404,6 +1670,7 @@ private:
 
 		// PMTp
 		curHandlerTable->add(pmtPid, &PsiParserPMT);
+		updatePassFilter();
 	}
 
 	void ensureAudioDelegators(int numAudios) {
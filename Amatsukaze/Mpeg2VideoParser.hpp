@@ -315,12 +315,32 @@ public:
 		, sequenceHeader()
 		, pictureHeader()
 		, format()
+		, headerOnlyScan(false)
+		, numInputBytes(0)
+		, numSkippedBytes(0)
 	{ }
 
 	virtual void reset() {
 		hasSequenceHeader = false;
 	}
 
+	// true: 1t[̃wb_iV[PXwb_AsN`wb_AsN`gj
+	// 炻PES̎ciXCXf[^j͌Ȃ
+	// 1PESɂ1ANZXjbgĂȂOiPTS,DTSPES1Ȃ̂Łj
+	void setHeaderOnlyScan(bool enable) {
+		headerOnlyScan = enable;
+	}
+
+	// ͂ꂽPESyC[h̍voCg
+	int64_t getNumInputBytes() const {
+		return numInputBytes;
+	}
+
+	// wb_̂݃[hŌɍς񂾃oCg
+	int64_t getNumSkippedBytes() const {
+		return numSkippedBytes;
+	}
+
 	virtual bool inputFrame(MemoryChunk frame, std::vector<VideoFrameInfo>& info, int64_t PTS, int64_t DTS) {
 		info.clear();
 
@@ -331,6 +351,8 @@ public:
 		FRAME_TYPE type = FRAME_NO_INFO;
 		int codedDataSize = (int)frame.length;
 
+		numInputBytes += frame.length;
+
 		for (int b = 0; b <= (int)frame.length - 4; ++b) {
 			switch (read32(&frame.data[b])) {
 			case SEQ_HEADER_START_CODE:
@@ -462,6 +484,11 @@ public:
 					picType = PIC_FRAME;
 					type = FRAME_NO_INFO;
 					codedDataSize = 0;
+
+					if (headerOnlyScan) {
+						numSkippedBytes += std::max(0, (int)frame.length - (b + 1));
+						return true;
+					}
 				}
 
 				break;
@@ -476,4 +503,8 @@ private:
 	MPEG2SequenceHeader sequenceHeader;
 	MPEG2PictureHeader pictureHeader[2];
 	VideoFormat format;
+
+	bool headerOnlyScan;
+	int64_t numInputBytes;
+	int64_t numSkippedBytes;
 };
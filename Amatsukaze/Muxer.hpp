@@ -90,6 +90,10 @@ public:
 					for (int frameIndex : frameList) {
 						splitter.inputPacket(audioCache_[frameIndex]);
 					}
+					if (splitter.getNumFallbackFrames() > 0) {
+						ctx.warnF("fAm: %dt[͉͂łȂ̂ŃfR[h܂",
+							splitter.getNumFallbackFrames());
+					}
 					audioFiles.push_back(filepath0);
 					audioFiles.push_back(filepath1);
 				}
@@ -92,3 +92,240 @@ int GetProcessorCount()
 	}
 	return 8; // sKȒlɂĂ
 }
+
+// t@C}bvēǂނ߂̃NX
+// ȃt@CłAhXԂg؂Ȃ悤ɁAw͈͂}bv
+// V͈͂}bvƑOɃ}bv͈͖͂ɂȂ
+class MemoryMappedFile : NonCopyable
+{
+public:
+	// sequential: 擪珇ɓǂޏꍇtrueiOS̐ǂ݂LɂȂj
+	MemoryMappedFile(const std::wstring& path, bool sequential)
+		: hFile_(INVALID_HANDLE_VALUE)
+		, hMap_(NULL)
+		, view_(NULL)
+		, fileSize_(0)
+	{
+		hFile_ = CreateFileW(path.c_str(), GENERIC_READ,
+			FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
+			sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS, NULL);
+		if (hFile_ == INVALID_HANDLE_VALUE) {
+			THROWF(IOException, "failed to open file %s", path);
+		}
+		LARGE_INTEGER size;
+		if (GetFileSizeEx(hFile_, &size) == FALSE) {
+			CloseHandle(hFile_);
+			THROWF(IOException, "failed to get file size %s", path);
+		}
+		fileSize_ = size.QuadPart;
+		// TCY0̃t@C̓}bvłȂ
+		if (fileSize_ > 0) {
+			hMap_ = CreateFileMappingW(hFile_, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (hMap_ == NULL) {
+				CloseHandle(hFile_);
+				THROWF(IOException, "failed to create file mapping %s", path);
+			}
+		}
+	}
+
+	~MemoryMappedFile() {
+		unmap();
+		if (hMap_ != NULL) {
+			CloseHandle(hMap_);
+		}
+		CloseHandle(hFile_);
+	}
+
+	int64_t size() const {
+		return fileSize_;
+	}
+
+	// offsetőlengthoCg}bvit@CI[𒴂镔͐؂l߂j
+	MemoryChunk map(int64_t offset, size_t length) {
+		unmap();
+		if (offset >= fileSize_) {
+			return MemoryChunk();
+		}
+		length = (size_t)std::min<int64_t>(length, fileSize_ - offset);
+		// }bvJnʒu̓AP[Vxɍ킹Kv
+		int64_t base = offset - offset % allocationGranularity();
+		size_t viewLength = (size_t)(offset - base) + length;
+		view_ = MapViewOfFile(hMap_, FILE_MAP_READ,
+			(DWORD)(base >> 32), (DWORD)base, viewLength);
+		if (view_ == NULL) {
+			THROWF(IOException, "failed to map view of file (offset=%lld)", offset);
+		}
+		return MemoryChunk((uint8_t*)view_ + (offset - base), length);
+	}
+
+	void unmap() {
+		if (view_ != NULL) {
+			UnmapViewOfFile(view_);
+			view_ = NULL;
+		}
+	}
+
+	// }bvς݂̗̈OSɐǂ݂Ă
+	// PrefetchVirtualMemoryWindows 8ȍ~Ȃ̂ŁAȂꍇ͉Ȃ
+	static void prefetch(MemoryChunk mc) {
+		struct RangeEntry {
+			PVOID VirtualAddress;
+			SIZE_T NumberOfBytes;
+		};
+		typedef BOOL(WINAPI *PrefetchVirtualMemoryFunc)(HANDLE, ULONG_PTR, RangeEntry*, ULONG);
+		static PrefetchVirtualMemoryFunc func = (PrefetchVirtualMemoryFunc)GetProcAddress(
+			GetModuleHandleW(L"kernel32.dll"), "PrefetchVirtualMemory");
+		if (func != nullptr && mc.length > 0) {
+			RangeEntry entry = { mc.data, mc.length };
+			func(GetCurrentProcess(), 1, &entry, 0);
+		}
+	}
+
+private:
+	HANDLE hFile_;
+	HANDLE hMap_;
+	void* view_;
+	int64_t fileSize_;
+
+	static int64_t allocationGranularity() {
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		return info.dwAllocationGranularity;
+	}
+};
+
+// ݂傫ȃubNɂ܂Ƃ߂Ăt@CɏNX
+// MemoryChunk܂Ƃ߂ēniwb_ƃyC[hʁXɎĂꍇȂǂɃRs[Ȃčςށj
+// noCache: OS̃t@CLbVʂɏiFILE_FLAG_NO_BUFFERINGj
+//   xǂ܂ȂȒԃt@CŃLbV̑̃t@CǂoȂ悤ɂ
+class BlockFileWriter : NonCopyable
+{
+	enum { SECTOR_ALIGN = 4096 }; // NO_BUFFERING̏ݒPʁi̔{Ȃǂ̃fBXNłOKj
+public:
+	BlockFileWriter(const std::wstring& path, size_t blockSize, bool noCache)
+		: path_(path)
+		, hFile_(INVALID_HANDLE_VALUE)
+		, noCache_(noCache)
+		, blockSize_((blockSize + SECTOR_ALIGN - 1) & ~(size_t)(SECTOR_ALIGN - 1))
+		, block_(NULL)
+		, filled_(0)
+		, written_(0)
+	{
+		hFile_ = CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS,
+			FILE_FLAG_SEQUENTIAL_SCAN | (noCache ? FILE_FLAG_NO_BUFFERING : 0), NULL);
+		if (hFile_ == INVALID_HANDLE_VALUE) {
+			THROWF(IOException, "failed to open file %s", path);
+		}
+		// NO_BUFFERING̓obt@̃AhXACĂKv̂VirtualAllocŊm
+		block_ = (uint8_t*)VirtualAlloc(NULL, blockSize_, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+		if (block_ == NULL) {
+			CloseHandle(hFile_);
+			THROW(RuntimeException, "failed to allocate write buffer");
+		}
+	}
+
+	~BlockFileWriter() {
+		try {
+			close();
+		}
+		catch (const Exception&) {
+			// fXgN^Ȃ̂Ŗ
+		}
+		if (block_ != NULL) {
+			VirtualFree(block_, 0, MEM_RELEASE);
+		}
+	}
+
+	void write(MemoryChunk mc) {
+		write(&mc, 1);
+	}
+
+	void write(const MemoryChunk* chunks, int numChunks) {
+		for (int i = 0; i < numChunks; ++i) {
+			const uint8_t* data = chunks[i].data;
+			size_t length = chunks[i].length;
+			// LbVgꍇ͑傫ȃf[^̓obt@ʂɒڏ
+			if (!noCache_ && filled_ == 0 && length >= blockSize_) {
+				writeFile(data, length);
+				continue;
+			}
+			while (length > 0) {
+				size_t n = std::min(length, blockSize_ - filled_);
+				memcpy(block_ + filled_, data, n);
+				filled_ += n;
+				data += n;
+				length -= n;
+				if (filled_ == blockSize_) {
+					writeFile(block_, blockSize_);
+					filled_ = 0;
+				}
+			}
+		}
+	}
+
+	// ܂łɏ܂ꂽoCgiobt@ɂ̂܂ށj
+	int64_t size() const {
+		return written_ + filled_;
+	}
+
+	// coĕ
+	void close() {
+		if (hFile_ == INVALID_HANDLE_VALUE) {
+			return;
+		}
+		HANDLE hFile = hFile_;
+		hFile_ = INVALID_HANDLE_VALUE;
+		if (filled_ > 0) {
+			size_t length = filled_;
+			if (noCache_) {
+				// ZN^PʂłȂ̂ŗ]ɏČŐ؂l߂
+				length = (filled_ + SECTOR_ALIGN - 1) & ~(size_t)(SECTOR_ALIGN - 1);
+				memset(block_ + filled_, 0, length - filled_);
+			}
+			DWORD writtenBytes;
+			if (WriteFile(hFile, block_, (DWORD)length, &writtenBytes, NULL) == FALSE ||
+				writtenBytes != length)
+			{
+				CloseHandle(hFile);
+				THROWF(IOException, "failed to write to file %s", path_);
+			}
+			written_ += filled_;
+			filled_ = 0;
+		}
+		CloseHandle(hFile);
+		if (noCache_ && (written_ % SECTOR_ALIGN) != 0) {
+			// NO_BUFFERINGłȂnhŐTCYɂ
+			HANDLE h = CreateFileW(path_.c_str(), GENERIC_WRITE, FILE_SHARE_READ, NULL,
+				OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+			LARGE_INTEGER pos;
+			pos.QuadPart = written_;
+			if (h == INVALID_HANDLE_VALUE) {
+				THROWF(IOException, "failed to open file %s", path_);
+			}
+			BOOL ok = SetFilePointerEx(h, pos, NULL, FILE_BEGIN) && SetEndOfFile(h);
+			CloseHandle(h);
+			if (!ok) {
+				THROWF(IOException, "failed to set end of file %s", path_);
+			}
+		}
+	}
+
+private:
+	std::wstring path_;
+	HANDLE hFile_;
+	bool noCache_;
+	size_t blockSize_;
+	uint8_t* block_;
+	size_t filled_;
+	int64_t written_;
+
+	void writeFile(const uint8_t* data, size_t length) {
+		DWORD writtenBytes;
+		if (WriteFile(hFile_, data, (DWORD)length, &writtenBytes, NULL) == FALSE ||
+			writtenBytes != length)
+		{
+			THROWF(IOException, "failed to write to file %s", path_);
+		}
+		written_ += length;
+	}
+};
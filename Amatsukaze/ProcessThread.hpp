@@ -179,6 +179,170 @@ private:
 	}
 };
 
+// t@CobNOEhXbhŐǂ݂
+// numBuffers̃obt@ԂɎg񂷂̂ŁAǂݍ݂ƏsĐi
+class ReadAheadFileReader : private ThreadBase
+{
+public:
+	ReadAheadFileReader(const tstring& path, size_t bufferSize, int numBuffers)
+		: file_(path, _T("rb"))
+		, fileSize_(file_.size())
+		, bufferSize_(bufferSize)
+		, buffers_(numBuffers)
+		, readIdx_(0)
+		, consumeIdx_(0)
+		, numFilled_(0)
+		, holding_(false)
+		, finished_(false)
+		, cancel_(false)
+		, error_(false)
+		, pos_(0)
+		, end_(0)
+	{
+		if (numBuffers < 2) {
+			THROW(ArgumentException, "ReadAheadFileReader needs at least 2 buffers");
+		}
+		for (auto& buf : buffers_) {
+			buf.data = std::unique_ptr<uint8_t[]>(new uint8_t[bufferSize]);
+			buf.length = 0;
+		}
+	}
+
+	~ReadAheadFileReader() {
+		stop();
+	}
+
+	int64_t size() const {
+		return fileSize_;
+	}
+
+	// [begin,end)̓ǂݍ݂Jn
+	void start(int64_t begin, int64_t end) {
+		stop();
+		file_.seek(begin, SEEK_SET);
+		pos_ = begin;
+		end_ = end;
+		readIdx_ = consumeIdx_ = numFilled_ = 0;
+		holding_ = finished_ = cancel_ = error_ = false;
+		readTime_.reset();
+		waitTime_.reset();
+		ThreadBase::start();
+	}
+
+	// ̃ubN擾iI[ɒB璷0j
+	// Ԃf[^͎next()ĂԂ܂ŗL
+	MemoryChunk next() {
+		std::unique_lock<std::mutex> lock(critical_section_);
+		if (holding_) {
+			// OԂobt@
+			holding_ = false;
+			consumeIdx_ = (consumeIdx_ + 1) % (int)buffers_.size();
+			--numFilled_;
+			cond_space_.notify_one();
+		}
+		if (numFilled_ == 0 && !finished_) {
+			waitTime_.start();
+			while (numFilled_ == 0 && !finished_) {
+				cond_filled_.wait(lock);
+			}
+			waitTime_.stop();
+		}
+		if (numFilled_ == 0) {
+			if (error_) {
+				THROW(IOException, "failed to read file in read-ahead thread");
+			}
+			return MemoryChunk();
+		}
+		holding_ = true;
+		auto& buf = buffers_[consumeIdx_];
+		return MemoryChunk(buf.data.get(), buf.length);
+	}
+
+	// ǂݍ݃Xbh~߂
+	void stop() {
+		{
+			std::unique_lock<std::mutex> lock(critical_section_);
+			cancel_ = true;
+			cond_space_.notify_one();
+		}
+		ThreadBase::join();
+	}
+
+	// IO҂ԁibj
+	double getWaitTime() const {
+		return waitTime_.getTotal();
+	}
+
+	// ǂݍ݃Xbhǂݍ݂ɂԁibj
+	double getReadTime() const {
+		return readTime_.getTotal();
+	}
+
+private:
+	struct Buffer {
+		std::unique_ptr<uint8_t[]> data;
+		size_t length;
+	};
+
+	File file_;
+	int64_t fileSize_;
+	size_t bufferSize_;
+	std::vector<Buffer> buffers_;
+
+	std::mutex critical_section_;
+	std::condition_variable cond_filled_;
+	std::condition_variable cond_space_;
+
+	int readIdx_;    // ɓǂݍރobt@
+	int consumeIdx_; // ɏɓnobt@
+	int numFilled_;  // ǂݍݍς݂̃obt@igp̂̂܂ށj
+	bool holding_;   // obt@gp
+	bool finished_;
+	bool cancel_;
+	bool error_;
+
+	int64_t pos_;
+	int64_t end_;
+
+	Stopwatch readTime_;
+	Stopwatch waitTime_;
+
+	virtual void run() {
+		try {
+			while (true) {
+				{
+					std::unique_lock<std::mutex> lock(critical_section_);
+					while (numFilled_ == (int)buffers_.size() && !cancel_) {
+						cond_space_.wait(lock);
+					}
+					if (cancel_) break;
+				}
+				// 󂢂Ăobt@͓ǂݍ݃XbhGȂ̂ŃbNsv
+				auto& buf = buffers_[readIdx_];
+				size_t length = (size_t)std::min<int64_t>(bufferSize_, end_ - pos_);
+				readTime_.start();
+				buf.length = (length > 0) ? file_.read(MemoryChunk(buf.data.get(), length)) : 0;
+				readTime_.stop();
+				if (buf.length == 0) break;
+				pos_ += buf.length;
+				{
+					std::unique_lock<std::mutex> lock(critical_section_);
+					readIdx_ = (readIdx_ + 1) % (int)buffers_.size();
+					++numFilled_;
+					cond_filled_.notify_one();
+				}
+			}
+		}
+		catch (const Exception&) {
+			std::unique_lock<std::mutex> lock(critical_section_);
+			error_ = true;
+		}
+		std::unique_lock<std::mutex> lock(critical_section_);
+		finished_ = true;
+		cond_filled_.notify_one();
+	}
+};
+
 class SubProcess
 {
 public:
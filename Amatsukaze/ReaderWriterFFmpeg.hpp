@@ -128,12 +128,57 @@ private:
 	AVCodecContext *ctx_;
 };
 
+class ReadIOContext : NonCopyable {
+public:
+	ReadIOContext(int bufsize)
+		: ctx_()
+	{
+		unsigned char* buffer = (unsigned char*)av_malloc(bufsize);
+		ctx_ = avio_alloc_context(buffer, bufsize, 0, this, read_packet_, NULL, seek_);
+	}
+	~ReadIOContext() {
+		av_free(ctx_->buffer);
+		av_free(ctx_);
+	}
+	AVIOContext* operator()() {
+		return ctx_;
+	}
+protected:
+	// ߂l: ǂ񂾃oCgiI[Ȃ0AG[Ȃ畉j
+	virtual int onRead(MemoryChunk mc) = 0;
+	// ߂l: V[N̈ʒuiAVSEEK_SIZEȂf[^TCYj
+	virtual int64_t onSeek(int64_t offset, int whence) = 0;
+private:
+	AVIOContext* ctx_;
+	static int read_packet_(void *opaque, uint8_t *buf, int buf_size) {
+		int ret = ((ReadIOContext*)opaque)->onRead(MemoryChunk(buf, buf_size));
+		return (ret == 0) ? AVERROR_EOF : (ret < 0) ? AVERROR(EIO) : ret;
+	}
+	static int64_t seek_(void *opaque, int64_t offset, int whence) {
+		return ((ReadIOContext*)opaque)->onSeek(offset, whence);
+	}
+};
+
 class InputContext : NonCopyable {
 public:
 	InputContext(const tstring& src)
+		: InputContext(src, nullptr, nullptr)
+	{ }
+	// ioCtx΃t@Cł͂ȂioCtxǂށisrc͖OƂĂgj
+	// format"mpeg"ȂǁinullptrȂ玩ʁj
+	InputContext(const tstring& src, ReadIOContext* ioCtx, const char* format)
 		: ctx_()
 	{
-		if (avformat_open_input(&ctx_, to_string(src).c_str(), NULL, NULL) != 0) {
+		if (ioCtx != nullptr) {
+			ctx_ = avformat_alloc_context();
+			if (ctx_ == NULL) {
+				THROW(IOException, "failed avformat_alloc_context");
+			}
+			ctx_->pb = (*ioCtx)();
+		}
+		AVInputFormat* fmt = (format != nullptr) ? av_find_input_format(format) : NULL;
+		// sctx_͉
+		if (avformat_open_input(&ctx_, to_string(src).c_str(), fmt, NULL) != 0) {
 			THROW(IOException, "failed avformat_open_input");
 		}
 	}
@@ -12,10 +12,15 @@
 #include <array>
 #include <map>
 #include <set>
+#include <mutex>
+#include <atomic>
 #include <fstream>
 #include <cctype>
 #include <locale>
 #include <codecvt>
+#include <intrin.h>
+#include <tmmintrin.h>
+#include <wmmintrin.h>
 
 #include "CoreUtils.hpp"
 #include "OSUtil.hpp"
@@ -270,23 +275,120 @@ private:
 	}
 };
 
+// MPEG2CRC32i0x04C11DB7Arbg]Ȃj
+// Zf[^slicing-by-8Af[^PCLMULQDQg΂ŌvZ
 class CRC32 {
+	enum {
+		// ZPCLMULQDQ̏ƍŌ̏k̃RXg̕傫
+		CLMUL_MIN_LENGTH = 64,
+	};
 public:
 	CRC32() {
-		createTable(table, 0x04C11DB7UL);
+		createTable(table[0], 0x04C11DB7UL);
+		for (int k = 1; k < 8; ++k) {
+			for (int i = 0; i < 256; ++i) {
+				uint32_t prev = table[k - 1][i];
+				table[k][i] = (prev << 8) ^ table[0][prev >> 24];
+			}
+		}
+		// D bitɏݍނ߂̒萔 x^(D+64) mod P, x^D mod P
+		foldConst128[0] = xPowMod(128 + 64);
+		foldConst128[1] = xPowMod(128);
+		foldConst512[0] = xPowMod(512 + 64);
+		foldConst512[1] = xPowMod(512);
+		enableCLMUL = IsCLMULAvailable();
 	}
 
 	uint32_t calc(const uint8_t* data, int length, uint32_t crc) const {
+		if (enableCLMUL && length >= CLMUL_MIN_LENGTH) {
+			return calcCLMUL(data, length, crc);
+		}
+		return calcSlice8(data, length, crc);
+	}
+
+	// 1oCge[uij
+	uint32_t calcBytewise(const uint8_t* data, int length, uint32_t crc) const {
 		for (int i = 0; i < length; ++i) {
-			crc = (crc << 8) ^ table[(crc >> 24) ^ data[i]];
+			crc = (crc << 8) ^ table[0][(crc >> 24) ^ data[i]];
 		}
 		return crc;
 	}
 
-	const uint32_t* getTable() const { return table; }
+	// 8oCg8̃e[u
+	uint32_t calcSlice8(const uint8_t* data, int length, uint32_t crc) const {
+		int i = 0;
+		for (; i + 8 <= length; i += 8) {
+			const uint8_t* p = data + i;
+			crc ^= ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+			crc = table[7][crc >> 24] ^ table[6][(crc >> 16) & 0xFF] ^
+				table[5][(crc >> 8) & 0xFF] ^ table[4][crc & 0xFF] ^
+				table[3][p[4]] ^ table[2][p[5]] ^ table[1][p[6]] ^ table[0][p[7]];
+		}
+		return calcBytewise(data + i, length - i, crc);
+	}
+
+	// 128bitJオȂZŏݍށiIsCLMULAvailable()truêƂĂԂƁj
+	// l͐擪4oCgXOR̂ƓȂ̂ōŏ̃ubNɓ
+	// ŌɎc128bit͕ʂCRCvZ
+	uint32_t calcCLMUL(const uint8_t* data, int length, uint32_t crc) const {
+		if (length < CLMUL_MIN_LENGTH) {
+			return calcSlice8(data, length, crc);
+		}
+		// rbOGfBAœǂbit ix^ǐWɂȂ悤ɂ
+		const __m128i bswap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+		const __m128i k128 = _mm_set_epi64x(foldConst128[1], foldConst128[0]);
+		const __m128i k512 = _mm_set_epi64x(foldConst512[1], foldConst512[0]);
+		auto load = [&](int pos) {
+			return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + pos)), bswap);
+		};
+		auto fold = [](__m128i x, __m128i k) {
+			return _mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x01), _mm_clmulepi64_si128(x, k, 0x10));
+		};
+		// 4[512bitݍ
+		__m128i x0 = _mm_xor_si128(load(0), _mm_slli_si128(_mm_cvtsi32_si128((int)crc), 12));
+		__m128i x1 = load(16), x2 = load(32), x3 = load(48);
+		int pos = 64;
+		for (; pos + 64 <= length; pos += 64) {
+			x0 = _mm_xor_si128(fold(x0, k512), load(pos));
+			x1 = _mm_xor_si128(fold(x1, k512), load(pos + 16));
+			x2 = _mm_xor_si128(fold(x2, k512), load(pos + 32));
+			x3 = _mm_xor_si128(fold(x3, k512), load(pos + 48));
+		}
+		x0 = _mm_xor_si128(fold(x0, k128), x1);
+		x0 = _mm_xor_si128(fold(x0, k128), x2);
+		x0 = _mm_xor_si128(fold(x0, k128), x3);
+		for (; pos + 16 <= length; pos += 16) {
+			x0 = _mm_xor_si128(fold(x0, k128), load(pos));
+		}
+		uint8_t rem[16];
+		_mm_storeu_si128((__m128i*)rem, _mm_shuffle_epi8(x0, bswap));
+		crc = calcSlice8(rem, 16, 0);
+		return calcSlice8(data + pos, length - pos, crc);
+	}
+
+	const uint32_t* getTable() const { return table[0]; }
+
+	// PCLMULQDQSSSE3(pshufb)g邩
+	static bool IsCLMULAvailable() {
+		int cpuinfo[4];
+		__cpuid(cpuinfo, 1);
+		return (cpuinfo[2] & (1 << 1)) && (cpuinfo[2] & (1 << 9));
+	}
 
 private:
-	uint32_t table[256];
+	uint32_t table[8][256];
+	uint64_t foldConst128[2];
+	uint64_t foldConst512[2];
+	bool enableCLMUL;
+
+	// x^n mod P
+	static uint32_t xPowMod(int n) {
+		uint32_t r = 1;
+		for (int i = 0; i < n; ++i) {
+			r = (r & 0x80000000UL) ? ((r << 1) ^ 0x04C11DB7UL) : (r << 1);
+		}
+		return r;
+	}
 
 	static void createTable(uint32_t* table, uint32_t exp) {
 		for (int i = 0; i < 256; ++i) {
@@ -393,11 +495,14 @@ public:
 		printProgress(StringFormat(fmt, args ...).c_str());
 	}
 
+	// 񕪊̃XbhĂ΂̂ŃbN
 	void registerTmpFile(const tstring& path) {
+		std::lock_guard<std::mutex> lock(tmpFilesLock);
 		tmpFiles.insert(path);
 	}
 
 	void clearTmpFiles() {
+		std::lock_guard<std::mutex> lock(tmpFilesLock);
 		for (auto& path : tmpFiles) {
       removeT(path.c_str());
 		}
@@ -462,8 +567,9 @@ private:
 	CRC32 crc;
 	int acp;
 
+	std::mutex tmpFilesLock;
 	std::set<tstring> tmpFiles;
-   std::array<int, AMT_ERR_MAX> errCounter;
+   std::array<std::atomic<int>, AMT_ERR_MAX> errCounter;
 	std::string errMessage;
 
 	std::map<std::string, std::wstring> drcsMap;
@@ -849,6 +955,15 @@ public:
 	int getHeight() const { return fh.height; }
 	int getNumFrames() const { return (int)framesizes.size(); }
 	const std::vector<uint8_t>& getExtra() const { return extra; }
+	int getFrameSize(int n) const { return framesizes[n]; }
+
+	// St[܂Ă邩i܂ĂȂt[̓TCY0j
+	bool isComplete() const {
+		for (int size : framesizes) {
+			if (size <= 0) return false;
+		}
+		return true;
+	}
 
 	void writeFrame(const uint8_t* data, int len)
 	{
@@ -878,6 +993,10 @@ public:
 		file.read(MemoryChunk(data, framesizes[n]));
 		return framesizes[n];
 	}
+
+	void flush() {
+		file.flush();
+	}
 };
 
 static void CopyYV12(uint8_t* dst, PVideoFrame& frame, int width, int height)
@@ -13,6 +13,7 @@
 #include <smmintrin.h>
 
 #include "TsSplitter.hpp"
+#include "TsIndex.hpp"
 #include "Encoder.hpp"
 #include "Muxer.hpp"
 #include "StreamReform.hpp"
@@ -24,29 +25,163 @@
 #include "EncoderOptionParser.hpp"
 #include "NicoJK.hpp"
 
+// TSt@Cݒ肳ꂽ@œǂݍTsSplitterɓ͂
+class TsFileReader : public AMTObject {
+	enum {
+		BLOCK_SIZE = 4 * 1024 * 1024, // p[Tւ̓͒P
+		VIEW_SIZE = 64 * 1024 * 1024, // }bvňxɃ}bvTCY
+		NUM_READAHEAD_BUFFERS = 4,
+	};
+public:
+	TsFileReader(AMTContext& ctx, const ConfigWrapper& setting)
+		: AMTObject(ctx)
+		, engine_(setting.getInputEngine())
+		, fileSize_(0)
+		, ioWait_(0)
+	{
+		tstring path = setting.getSrcFilePath();
+		switch (engine_) {
+		case INPUT_ENGINE_MMAP:
+			mappedFile_ = std::unique_ptr<MemoryMappedFile>(new MemoryMappedFile(path, true));
+			fileSize_ = mappedFile_->size();
+			break;
+		case INPUT_ENGINE_READAHEAD:
+			readAheadFile_ = std::unique_ptr<ReadAheadFileReader>(
+				new ReadAheadFileReader(path, BLOCK_SIZE, NUM_READAHEAD_BUFFERS));
+			fileSize_ = readAheadFile_->size();
+			break;
+		default:
+			file_ = std::unique_ptr<File>(new File(path, _T("rb")));
+			fileSize_ = file_->size();
+			break;
+		}
+	}
+
+	int64_t size() const {
+		return fileSize_;
+	}
+
+	// t@C[begin,end)splitterɓ͂
+	// ubN͂邲Ƃcond()ĂяoAfalseԂ炻ŏI
+	template <typename Cond>
+	void read(TsSplitter& splitter, int64_t begin, int64_t end, Cond cond) {
+		end = std::min(end, fileSize_);
+		switch (engine_) {
+		case INPUT_ENGINE_MMAP:
+			readMapped(splitter, begin, end, cond);
+			break;
+		case INPUT_ENGINE_READAHEAD:
+			readAhead(splitter, begin, end, cond);
+			break;
+		default:
+			readFile(splitter, begin, end, cond);
+			break;
+		}
+	}
+
+	void read(TsSplitter& splitter) {
+		read(splitter, 0, fileSize_, [] { return true; });
+	}
+
+	// p[TIO҂Ăԁibj
+	// }bv̏ꍇ̓y[WtHg̎ԂvłȂ̂0
+	double getIOWaitTime() const {
+		return ioWait_;
+	}
+
+private:
+	ENUM_INPUT_ENGINE engine_;
+	std::unique_ptr<File> file_;
+	std::unique_ptr<MemoryMappedFile> mappedFile_;
+	std::unique_ptr<ReadAheadFileReader> readAheadFile_;
+	int64_t fileSize_;
+	double ioWait_;
+
+	template <typename Cond>
+	void readFile(TsSplitter& splitter, int64_t begin, int64_t end, Cond cond) {
+		auto buffer_ptr = std::unique_ptr<uint8_t[]>(new uint8_t[BLOCK_SIZE]);
+		Stopwatch sw;
+		file_->seek(begin, SEEK_SET);
+		for (int64_t pos = begin; pos < end; ) {
+			size_t length = (size_t)std::min<int64_t>(BLOCK_SIZE, end - pos);
+			sw.start();
+			size_t readBytes = file_->read(MemoryChunk(buffer_ptr.get(), length));
+			sw.stop();
+			if (readBytes == 0) break;
+			splitter.inputTsData(MemoryChunk(buffer_ptr.get(), readBytes));
+			pos += readBytes;
+			if (!cond()) break;
+		}
+		ioWait_ = sw.getTotal();
+	}
+
+	// }bvt@CRs[Ƀp[Tɓ͂
+	template <typename Cond>
+	void readMapped(TsSplitter& splitter, int64_t begin, int64_t end, Cond cond) {
+		for (int64_t offset = begin; offset < end; offset += VIEW_SIZE) {
+			MemoryChunk view = mappedFile_->map(offset, (size_t)std::min<int64_t>(VIEW_SIZE, end - offset));
+			for (size_t pos = 0; pos < view.length; pos += BLOCK_SIZE) {
+				size_t len = std::min<size_t>(BLOCK_SIZE, view.length - pos);
+				size_t next = pos + len;
+				if (next < view.length) {
+					// p[XĂԂɎ̃ubNǂ܂Ă
+					MemoryMappedFile::prefetch(MemoryChunk(view.data + next,
+						std::min<size_t>(BLOCK_SIZE, view.length - next)));
+				}
+				// pPbgE܂[̓p[TɃRs[̂
+				// ͈̔͂}bvĂȂ
+				splitter.inputTsData(MemoryChunk(view.data + pos, len));
+				if (!cond()) return;
+			}
+		}
+	}
+
+	// ǂݍ݃XbhŐǂ݂obt@p[Tɓ͂
+	template <typename Cond>
+	void readAhead(TsSplitter& splitter, int64_t begin, int64_t end, Cond cond) {
+		readAheadFile_->start(begin, end);
+		while (true) {
+			MemoryChunk mc = readAheadFile_->next();
+			if (mc.length == 0) break;
+			splitter.inputTsData(mc);
+			if (!cond()) break;
+		}
+		readAheadFile_->stop();
+		ioWait_ = readAheadFile_->getWaitTime();
+	}
+};
+
 class AMTSplitter : public TsSplitter {
+	enum {
+		// 񕪊ꍇ1`N̍ŏTCY
+		MIN_CHUNK_SIZE = 256 * 1024 * 1024,
+	};
 public:
 	AMTSplitter(AMTContext& ctx, const ConfigWrapper& setting)
-		: TsSplitter(ctx, true, true, setting.isSubtitlesEnabled())
-		, setting_(setting)
-		, psWriter(ctx)
-		, writeHandler(*this)
-		, audioFile_(setting.getAudioFilePath(), _T("wb"))
-		, waveFile_(setting.getWaveFilePath(), _T("wb"))
-		, curVideoFormat_()
-		, videoFileCount_(0)
-		, videoStreamType_(-1)
-		, audioStreamType_(-1)
-		, audioFileSize_(0)
-		, waveFileSize_(0)
-		, srcFileSize_(0)
-	{
-		psWriter.setHandler(&writeHandler);
+		: AMTSplitter(ctx, setting, -1)
+	{ }
+
+	~AMTSplitter() {
+		// OŔĂꍇfR[hXbh͏I
+		for (auto& decoder : audioDecoders_) {
+			decoder->join();
+		}
 	}
 
 	StreamReformInfo split()
 	{
-		readAll();
+		int numChunks = getNumSplitChunks();
+		if (numChunks > 1) {
+			readParallel(numChunks);
+		}
+		else {
+			readAll();
+		}
+		writeHandler.close();
+
+		if (setting_.isTsIndexEnabled()) {
+			saveTsIndex();
+		}
 
 		// for debug
 		printInteraceCount();
@@ -64,44 +199,242 @@ public:
 	}
 
 protected:
+	// z[hł͒ԉft@C̑ɓOVirtualPsIndex
 	class StreamFileWriteHandler : public PsStreamWriter::EventHandler {
+		enum { WRITE_BLOCK_SIZE = 4 * 1024 * 1024 };
 		TsSplitter& this_;
-		std::unique_ptr<File> file_;
+		std::unique_ptr<BlockFileWriter> file_;
+		std::unique_ptr<VirtualPsIndex> index_;
+		tstring indexPath_;
+		tstring srcpath_;
 		int64_t totalIntVideoSize_;
+		bool noCache_;
+		bool virtualDemux_;
 	public:
 		StreamFileWriteHandler(TsSplitter& this_)
-			: this_(this_), totalIntVideoSize_() { }
+			: this_(this_), totalIntVideoSize_(), noCache_(false), virtualDemux_(false) { }
 		virtual void onStreamData(MemoryChunk mc) {
+			onStreamData(&mc, 1);
+		}
+		virtual void onStreamData(const MemoryChunk* chunks, int numChunks) {
 			if (file_ != NULL) {
-				file_->write(mc);
-				totalIntVideoSize_ += mc.length;
+				file_->write(chunks, numChunks);
+			}
+			else if (index_ != NULL) {
+				for (int i = 0; i < numChunks; ++i) {
+					index_->add(chunks[i]);
+				}
+			}
+			else {
+				return;
+			}
+			for (int i = 0; i < numChunks; ++i) {
+				totalIntVideoSize_ += chunks[i].length;
+			}
+		}
+		void setNoCache(bool noCache) {
+			noCache_ = noCache;
+		}
+		// srcpath: TSt@C
+		void setVirtualDemux(bool enable, const tstring& srcpath) {
+			virtualDemux_ = enable;
+			srcpath_ = srcpath;
+		}
+		bool isVirtualDemux() const {
+			return virtualDemux_;
+		}
+		// ɏo͂fPESpPbgTS͈̔́iz[ĥ݁j
+		void setCurrentPes(int64_t tsOffset, int64_t tsEnd, int pid, MemoryChunk packet) {
+			if (index_ != NULL) {
+				index_->setCurrentPes(tsOffset, tsEnd, pid, packet);
+			}
+		}
+		void clearCurrentPes() {
+			if (index_ != NULL) {
+				index_->clearCurrentPes();
+			}
+		}
+		// 񕪊̃`ÑCfbNXɌiz[ĥ݁j
+		void appendIndex(const VirtualPsIndex& o, int64_t tsOffsetBase) {
+			if (index_ != NULL) {
+				index_->append(o, tsOffsetBase);
+				totalIntVideoSize_ += o.size;
 			}
 		}
 		void open(const tstring& path) {
+			close();
 			totalIntVideoSize_ = 0;
-			file_ = std::unique_ptr<File>(new File(path, _T("wb")));
+			if (virtualDemux_) {
+				index_ = std::unique_ptr<VirtualPsIndex>(new VirtualPsIndex());
+				index_->srcpath = srcpath_;
+				indexPath_ = path;
+			}
+			else {
+				file_ = std::unique_ptr<BlockFileWriter>(new BlockFileWriter(path, WRITE_BLOCK_SIZE, noCache_));
+			}
 		}
 		void close() {
-			file_ = nullptr;
+			if (file_ != NULL) {
+				file_->close();
+				file_ = nullptr;
+			}
+			if (index_ != NULL) {
+				index_->save(indexPath_);
+				index_ = nullptr;
+			}
 		}
 		int64_t getTotalSize() const {
 			return totalIntVideoSize_;
 		}
 	};
 
+	// 񕪊1`NXbh
+	class ChunkSplitThread : private ThreadBase {
+	public:
+		ChunkSplitThread(AMTSplitter& splitter, int64_t begin)
+			: splitter_(splitter)
+			, begin_(begin)
+			, error_(false)
+		{ }
+		~ChunkSplitThread() {
+			join();
+		}
+		void start() {
+			ThreadBase::start();
+		}
+		void join() {
+			ThreadBase::join();
+		}
+		bool hasError() const {
+			return error_;
+		}
+		const std::string& getErrorMessage() const {
+			return errorMessage_;
+		}
+	private:
+		AMTSplitter& splitter_;
+		int64_t begin_;
+		bool error_;
+		std::string errorMessage_;
+
+		virtual void run() {
+			try {
+				splitter_.readChunk(begin_);
+			}
+			catch (const Exception& e) {
+				error_ = true;
+				errorMessage_ = e.message();
+			}
+		}
+	};
+
+	// fR[hwaveoXbhiƂ1j
+	// XbhAAC̃t[nŃfR[h͂ł
+	class AudioDecodeThread : public AMTObject, public DataPumpThread<std::vector<uint8_t>> {
+	public:
+		AudioDecodeThread(AMTContext& ctx, File& waveFile)
+			: AMTObject(ctx)
+			, DataPumpThread<std::vector<uint8_t>>(4 * 1024 * 1024)
+			, waveFile_(waveFile)
+			, hAacDec(NULL)
+			, totalSize_(0)
+		{ }
+		~AudioDecodeThread() {
+			closeDecoder();
+		}
+		// et[̃fR[hf[^TCYifR[hłȂt[0j
+		// join()ĂĂԂ
+		const std::vector<int>& getDecodedSizes() const {
+			return decodedSizes_;
+		}
+		int64_t getTotalSize() const {
+			return totalSize_;
+		}
+	protected:
+		virtual void OnDataReceived(std::vector<uint8_t>&& data) {
+			uint8_t* ptr = data.data();
+			int len = (int)data.size();
+			if (hAacDec == NULL) {
+				resetDecoder(MemoryChunk(ptr, len));
+			}
+			NeAACDecFrameInfo frameInfo;
+			void* samples = NeAACDecDecode(hAacDec, &frameInfo, ptr, len);
+			if (frameInfo.error != 0) {
+				// tH[}bgςƃG[f̂ŏĂPH킹
+				resetDecoder(MemoryChunk(ptr, len));
+				samples = NeAACDecDecode(hAacDec, &frameInfo, ptr, len);
+			}
+			int decodedSize = 0;
+			if (frameInfo.error == 0) {
+				// _E~bNXĂ̂2chɂȂ͂
+				int numChannels = frameInfo.num_front_channels +
+					frameInfo.num_back_channels + frameInfo.num_side_channels + frameInfo.num_lfe_channels;
+				if (numChannels != 2) {
+					ctx.incrementCounter(AMT_ERR_DECODE_AUDIO);
+					ctx.warnF("fR[hꂽ2chł͂܂(ch=%d)", numChannels);
+				}
+				else {
+					decodedSize = frameInfo.samples * 2;
+					waveFile_.write(MemoryChunk((uint8_t*)samples, decodedSize));
+				}
+			}
+			decodedSizes_.push_back(decodedSize);
+			totalSize_ += decodedSize;
+		}
+	private:
+		File& waveFile_;
+		NeAACDecHandle hAacDec;
+		std::vector<int> decodedSizes_;
+		int64_t totalSize_;
+
+		void closeDecoder() {
+			if (hAacDec != NULL) {
+				NeAACDecClose(hAacDec);
+				hAacDec = NULL;
+			}
+		}
+
+		bool resetDecoder(MemoryChunk data) {
+			closeDecoder();
+
+			hAacDec = NeAACDecOpen();
+			NeAACDecConfigurationPtr conf = NeAACDecGetCurrentConfiguration(hAacDec);
+			conf->outputFormat = FAAD_FMT_16BIT;
+			conf->downMatrix = 1; // WAVo͉͂͗pȂ̂2chΏ\
+			NeAACDecSetConfiguration(hAacDec, conf);
+
+			unsigned long samplerate;
+			unsigned char channels;
+			if (NeAACDecInit(hAacDec, data.data, (int)data.length, &samplerate, &channels)) {
+				ctx.warn("NeAACDecInitɎs");
+				return false;
+			}
+			return true;
+		}
+	};
+
 	const ConfigWrapper& setting_;
+	int part_; // 񕪊̃`Nԍi񕪊̃`NłȂ-1j
 	PsStreamWriter psWriter;
 	StreamFileWriteHandler writeHandler;
 	File audioFile_;
 	File waveFile_;
+	std::vector<std::unique_ptr<File>> subWaveFiles_; // 2Ԗڈȍ~̉wave
+	std::vector<std::unique_ptr<AudioDecodeThread>> audioDecoders_;
 	VideoFormat curVideoFormat_;
 
 	int videoFileCount_;
+	int videoPid_;
 	int videoStreamType_;
 	int audioStreamType_;
 	int64_t audioFileSize_;
 	int64_t waveFileSize_;
 	int64_t srcFileSize_;
+	int64_t chunkBegin_; // 񕪊̃`Ñt@C̊Jnʒu
+
+	// TSCfbNXiʒu͓͂̐擪j
+	TsIndex tsIndex_;
+	int64_t lastIndexClock_;
 
 	// f[^
 	std::vector<FileVideoFrameInfo> videoFrameList_;
@@ -110,17 +443,355 @@ protected:
 	std::vector<CaptionItem> captionTextList_;
 	std::vector<std::pair<int64_t, JSTTime>> timeList_;
 
+	// eԉft@C̍ŏ̃t[ԍ
+	std::vector<int> videoFileStartFrame_;
+
+	AMTSplitter(AMTContext& ctx, const ConfigWrapper& setting, int part)
+		: TsSplitter(ctx, true, true, setting.isSubtitlesEnabled())
+		, setting_(setting)
+		, part_(part)
+		, psWriter(ctx)
+		, writeHandler(*this)
+		, audioFile_(getAudioFilePath(setting, part), _T("wb"))
+		, waveFile_(getWaveFilePath(setting, part), _T("wb"))
+		, curVideoFormat_()
+		, videoFileCount_(0)
+		, videoPid_(-1)
+		, videoStreamType_(-1)
+		, audioStreamType_(-1)
+		, audioFileSize_(0)
+		, waveFileSize_(0)
+		, srcFileSize_(0)
+		, chunkBegin_(0)
+		, lastIndexClock_(-1)
+	{
+		psWriter.setHandler(&writeHandler);
+		writeHandler.setNoCache(setting.isIntVideoNoCache());
+		writeHandler.setVirtualDemux(setting.isVirtualDemux(), setting.getSrcFilePath());
+		setInitBufferSize(setting.getInitBufferSize());
+		// fR[hAudioDecodeThreadł
+		setAudioDecode(false);
+	}
+
+	static tstring getAudioFilePath(const ConfigWrapper& setting, int part) {
+		return (part < 0) ? setting.getAudioFilePath() : setting.getSplitPartFilePath(part, _T("audio.dat"));
+	}
+
+	static tstring getWaveFilePath(const ConfigWrapper& setting, int part) {
+		return (part < 0) ? setting.getWaveFilePath() : setting.getSplitPartFilePath(part, _T("audio.wav"));
+	}
+
+	static tstring getWaveFilePath(const ConfigWrapper& setting, int part, int audioIdx) {
+		return (part < 0) ? setting.getWaveFilePath(audioIdx) :
+			setting.getSplitPartFilePath(part, StringFormat(_T("audio%d.wav"), audioIdx));
+	}
+
+	// ԉft@C炸ɃCfbNXo͂
+	void setVirtualDemux(bool enable) {
+		writeHandler.setVirtualDemux(enable, setting_.getSrcFilePath());
+	}
+
+	tstring getIntVideoFilePath(int index) const {
+		return (part_ < 0) ? setting_.getIntVideoFilePath(index) :
+			setting_.getSplitPartFilePath(part_, StringFormat(_T("i%d.mpg"), index));
+	}
+
 	void readAll() {
+		TsFileReader reader(ctx, setting_);
+		srcFileSize_ = reader.size();
+		reader.read(*this);
+		ctx.infoF("TSǂݍIO҂: %.2fb", reader.getIOWaitTime());
+		printVideoScanStat(getNumMpeg2InputBytes(), getNumMpeg2SkippedBytes());
+		finishAudioDecode();
+	}
+
+	void printVideoScanStat(int64_t inputBytes, int64_t skippedBytes) {
+		if (inputBytes > 0) {
+			ctx.infoF("MPEG2f͂œǂݔ΂f[^: %.1fMB/%.1fMBi%.1f%%j",
+				skippedBytes / (1024.0 * 1024.0), inputBytes / (1024.0 * 1024.0),
+				skippedBytes * 100.0 / inputBytes);
+		}
+	}
+
+	int getNumSplitChunks() const {
+		int numThreads = setting_.getSplitThreads();
+		if (numThreads <= 1) {
+			return 1;
+		}
+		int64_t fileSize = File(setting_.getSrcFilePath(), _T("rb")).size();
+		return (int)std::max<int64_t>(1, std::min<int64_t>(numThreads, fileSize / MIN_CHUNK_SIZE));
+	}
+
+	// ͂numChunksɕĕɉ͂Ă猋
+	void readParallel(int numChunks) {
+		srcFileSize_ = File(setting_.getSrcFilePath(), _T("rb")).size();
+
+		std::vector<std::unique_ptr<AMTSplitter>> parts;
+		std::vector<std::unique_ptr<ChunkSplitThread>> threads;
+		for (int i = 0; i < numChunks; ++i) {
+			int64_t begin = srcFileSize_ * i / numChunks;
+			int64_t end = srcFileSize_ * (i + 1) / numChunks;
+			parts.emplace_back(new AMTSplitter(ctx, setting_, i));
+			parts.back()->setServiceId(preferedServiceId);
+			parts.back()->setChunkRange(i == 0, (i + 1 < numChunks) ? (end - begin) : -1);
+			parts.back()->setDeferCaption(true);
+			parts.back()->setVirtualDemux(writeHandler.isVirtualDemux());
+			threads.emplace_back(new ChunkSplitThread(*parts.back(), begin));
+		}
+
+		Stopwatch sw;
+		sw.start();
+		for (auto& thread : threads) {
+			thread->start();
+		}
+		for (auto& thread : threads) {
+			thread->join();
+		}
+		ctx.infoF("TŚi%d`Nj: %.2fb", numChunks, sw.getAndReset());
+		for (auto& thread : threads) {
+			if (thread->hasError()) {
+				THROWF(RuntimeException, "TS͂ŃG[܂: %s", thread->getErrorMessage());
+			}
+		}
+
+		int64_t mpeg2InputBytes = 0, mpeg2SkippedBytes = 0;
+		for (auto& part : parts) {
+			mpeg2InputBytes += part->getNumMpeg2InputBytes();
+			mpeg2SkippedBytes += part->getNumMpeg2SkippedBytes();
+		}
+		printVideoScanStat(mpeg2InputBytes, mpeg2SkippedBytes);
+
+		SplitMergeState state = SplitMergeState();
+		for (int i = 0; i < numChunks; ++i) {
+			mergePart(*parts[i], state);
+		}
+		// DLL̓XbhZ[tłȂ̂łł܂Ƃ߂ď
+		for (auto& part : parts) {
+			for (const auto& pes : part->deferredCaptionList) {
+				inputCaptionPes(pes.first, MemoryChunk((uint8_t*)pes.second.data(), pes.second.size()));
+			}
+		}
+		selectedServiceId = parts[0]->selectedServiceId;
+		ctx.infoF("TS͌ʂ̌: %.2fb", sw.getAndReset());
+	}
+
+	// 񕪊̃`NƂ[begin,I[)ǂ
+	void readChunk(int64_t begin) {
+		chunkBegin_ = begin;
+		TsFileReader reader(ctx, setting_);
+		reader.read(*this, begin, reader.size(), [&] { return !isChunkFinished(); });
+		writeHandler.close();
+		finishAudioDecode();
+		audioFile_.flush();
+		waveFile_.flush();
+	}
+
+	// ς݃Xg[̍Ō̏
+	struct SplitMergeState {
+		bool hasEvent;
+		int numAudio;
+		VideoFormat videoFormat;
+		std::vector<AudioFormat> audioFormat;
+	};
+
+	// `N̉͌ʂɌ
+	void mergePart(AMTSplitter& part, SplitMergeState& state) {
+		int videoBase = (int)videoFrameList_.size();
+		int audioBase = (int)audioFrameList_.size();
+
+		// `N擪̃Cxg̓p[T̏ɂ̂Ȃ̂
+		// Õ`N̏ԂƓȂ̂Ă
+		bool firstPid = true, firstVideo = true;
+		std::vector<bool> firstAudio;
+		for (StreamEvent ev : part.streamEventList_) {
+			bool redundant = false;
+			switch (ev.type) {
+			case PID_TABLE_CHANGED:
+				redundant = firstPid && state.hasEvent && state.numAudio == ev.numAudio;
+				firstPid = false;
+				state.numAudio = ev.numAudio;
+				ev.frameIdx += videoBase;
+				break;
+			case VIDEO_FORMAT_CHANGED:
+				if (ev.frameIdx < (int)part.videoFrameList_.size()) {
+					const VideoFormat& fmt = part.videoFrameList_[ev.frameIdx].format;
+					redundant = firstVideo && state.hasEvent && state.videoFormat == fmt;
+					state.videoFormat = fmt;
+				}
+				firstVideo = false;
+				ev.frameIdx += videoBase;
+				break;
+			case AUDIO_FORMAT_CHANGED:
+				if ((int)firstAudio.size() <= ev.audioIdx) {
+					firstAudio.resize(ev.audioIdx + 1, true);
+					state.audioFormat.resize(std::max<int>((int)state.audioFormat.size(), ev.audioIdx + 1));
+				}
+				if (ev.frameIdx < (int)part.audioFrameList_.size()) {
+					const AudioFormat& fmt = part.audioFrameList_[ev.frameIdx].format;
+					redundant = firstAudio[ev.audioIdx] && state.hasEvent && state.audioFormat[ev.audioIdx] == fmt;
+					state.audioFormat[ev.audioIdx] = fmt;
+				}
+				firstAudio[ev.audioIdx] = false;
+				ev.frameIdx += audioBase;
+				break;
+			}
+			if (!redundant) {
+				streamEventList_.push_back(ev);
+			}
+		}
+		state.hasEvent = state.hasEvent || part.streamEventList_.size() > 0;
+
+		// ԉft@C
+		// 擪̃tH[}bgOƓȂt@C𕪂ɑď
+		//iStreamReformƏ킹Ȃ΂ȂȂƂɒӁj
+		for (int i = 0; i < part.videoFileCount_; ++i) {
+			int frameBegin = part.videoFileStartFrame_[i];
+			int frameEnd = (i + 1 < part.videoFileCount_) ?
+				part.videoFileStartFrame_[i + 1] : (int)part.videoFrameList_.size();
+			const VideoFormat& fmt = part.videoFrameList_[frameBegin].format;
+			if (i > 0 || videoFileCount_ == 0 || !curVideoFormat_.isBasicEquals(fmt)) {
+				writeHandler.open(setting_.getIntVideoFilePath(videoFileCount_++));
+				videoFileStartFrame_.push_back((int)videoFrameList_.size());
+			}
+			curVideoFormat_ = part.videoFrameList_[frameEnd - 1].format;
+			int64_t offset = writeHandler.getTotalSize();
+			for (int f = frameBegin; f < frameEnd; ++f) {
+				videoFrameList_.push_back(part.videoFrameList_[f]);
+				videoFrameList_.back().fileOffset += offset;
+			}
+			tstring path = part.getIntVideoFilePath(i);
+			if (writeHandler.isVirtualDemux()) {
+				VirtualPsIndex index;
+				index.load(path);
+				writeHandler.appendIndex(index, part.chunkBegin_);
+			}
+			else {
+				AppendFileData(path, [&](MemoryChunk mc) { writeHandler.onStreamData(mc); });
+			}
+			removeT(path.c_str());
+		}
+
+		// 
+		for (FileAudioFrameInfo frame : part.audioFrameList_) {
+			frame.fileOffset += audioFileSize_;
+			frame.waveOffset += waveFileSize_;
+			audioFrameList_.push_back(frame);
+		}
+		tstring audioPath = getAudioFilePath(setting_, part.part_);
+		tstring wavePath = getWaveFilePath(setting_, part.part_);
+		AppendFileData(audioPath, [&](MemoryChunk mc) { audioFile_.write(mc); });
+		AppendFileData(wavePath, [&](MemoryChunk mc) { waveFile_.write(mc); });
+		removeT(audioPath.c_str());
+		removeT(wavePath.c_str());
+		audioFileSize_ += part.audioFileSize_;
+		waveFileSize_ += part.waveFileSize_;
+
+		timeList_.insert(timeList_.end(), part.timeList_.begin(), part.timeList_.end());
+		tsIndex_.append(part.tsIndex_, part.chunkBegin_);
+		numTotalPackets += part.numTotalPackets;
+		numScramblePackets += part.numScramblePackets;
+	}
+
+	void saveTsIndex() {
+		const tstring& srcpath = setting_.getSrcFilePath();
+		tsIndex_.captionIndexed = setting_.isSubtitlesEnabled();
+		if (!TsIndex::GetFileStamp(srcpath, tsIndex_.srcFileSize, tsIndex_.srcFileTime)) {
+			ctx.warn("TSCfbNXۑł܂łi̓t@C擾ł܂j");
+			return;
+		}
+		try {
+			tsIndex_.save(TsIndex::GetIndexPath(srcpath));
+		}
+		catch (const Exception& e) {
+			ctx.warnF("TSCfbNXۑł܂ł: %s", e.message());
+		}
+	}
+
+	// PCR̃Tv1b炢ŏ\
+	void addIndexClock(int64_t clock, int64_t offset) {
+		if (lastIndexClock_ == -1 || clock - lastIndexClock_ >= 27000000 || clock < lastIndexClock_) {
+			TsIndexClock e = { offset, clock };
+			tsIndex_.clocks.push_back(e);
+			lastIndexClock_ = clock;
+		}
+	}
+
+	AudioDecodeThread& getAudioDecoder(int audioIdx) {
+		while ((int)audioDecoders_.size() <= audioIdx) {
+			int idx = (int)audioDecoders_.size();
+			File* file = &waveFile_;
+			if (idx > 0) {
+				subWaveFiles_.emplace_back(new File(getWaveFilePath(setting_, part_, idx), _T("wb")));
+				file = subWaveFiles_.back().get();
+			}
+			audioDecoders_.emplace_back(new AudioDecodeThread(ctx, *file));
+			audioDecoders_.back()->start();
+		}
+		return *audioDecoders_[audioIdx];
+	}
+
+	// fR[hXbh̏I҂wavëʒum肳
+	// 1Ԗڂ̉wavewaveFile_ɒڏĂ̂
+	// 2Ԗڈȍ~̉wavěɏɌ
+	void finishAudioDecode() {
+		if (audioDecoders_.size() == 0) {
+			return;
+		}
+		Stopwatch sw;
+		sw.start();
+		for (auto& decoder : audioDecoders_) {
+			decoder->join();
+		}
+		double waitTime = sw.getAndReset();
+
+		int numAudio = (int)audioDecoders_.size();
+		std::vector<int64_t> waveOffset(numAudio);
+		waveFileSize_ = 0;
+		for (int i = 0; i < numAudio; ++i) {
+			waveOffset[i] = waveFileSize_;
+			if (i > 0) {
+				subWaveFiles_[i - 1] = nullptr; // 
+				tstring path = getWaveFilePath(setting_, part_, i);
+				AppendFileData(path, [&](MemoryChunk mc) { waveFile_.write(mc); });
+				removeT(path.c_str());
+			}
+			waveFileSize_ += audioDecoders_[i]->getTotalSize();
+		}
+		subWaveFiles_.clear();
+
+		std::vector<int> numFrames(numAudio);
+		for (const FileAudioFrameInfo& info : audioFrameList_) {
+			++numFrames[info.audioIdx];
+		}
+		for (int i = 0; i < numAudio; ++i) {
+			if (numFrames[i] != (int)audioDecoders_[i]->getDecodedSizes().size()) {
+				// ݃G[ȂǂŃfR[hXbhrŎ~܂
+				THROWF(RuntimeException, "%d̃fR[h܂ł", i);
+			}
+		}
+
+		std::vector<int> decodedIdx(numAudio);
+		for (FileAudioFrameInfo& info : audioFrameList_) {
+			int idx = info.audioIdx;
+			info.waveDataSize = audioDecoders_[idx]->getDecodedSizes()[decodedIdx[idx]++];
+			info.waveOffset = waveOffset[idx];
+			waveOffset[idx] += info.waveDataSize;
+		}
+		audioDecoders_.clear();
+
+		ctx.infoF("fR[h҂: %.2fb wavě: %.2fb", waitTime, sw.getAndReset());
+	}
+
+	// t@C̒g擪珇outɓn
+	template <typename F>
+	static void AppendFileData(const tstring& path, F out) {
 		enum { BUFSIZE = 4 * 1024 * 1024 };
 		auto buffer_ptr = std::unique_ptr<uint8_t[]>(new uint8_t[BUFSIZE]);
-		MemoryChunk buffer(buffer_ptr.get(), BUFSIZE);
-		File srcfile(setting_.getSrcFilePath(), _T("rb"));
-		srcFileSize_ = srcfile.size();
+		File file(path, _T("rb"));
 		size_t readBytes;
-		do {
-			readBytes = srcfile.read(buffer);
-			inputTsData(MemoryChunk(buffer.data, readBytes));
-		} while (readBytes == buffer.length);
+		while ((readBytes = file.read(MemoryChunk(buffer_ptr.get(), BUFSIZE))) > 0) {
+			out(MemoryChunk(buffer_ptr.get(), readBytes));
+		}
 	}
 
 	static bool CheckPullDown(PICTURE_TYPE p0, PICTURE_TYPE p1) {
@@ -224,11 +895,23 @@ protected:
 		const std::vector<VideoFrameInfo>& frames,
 		PESPacket packet)
 	{
+		int64_t offset = getPesOffset();
+		if (offset >= 0) {
+			addIndexClock(clock, offset);
+			if (frames.size() > 0 && frames[0].isGopStart) {
+				TsIndexVideo e = { offset, frames[0].PTS, frames[0].DTS };
+				tsIndex_.keyFrames.push_back(e);
+			}
+		}
 		for (const VideoFrameInfo& frame : frames) {
 			videoFrameList_.push_back(frame);
 			videoFrameList_.back().fileOffset = writeHandler.getTotalSize();
 		}
+		// PES̍Ō̃pPbg͏̃pPbgOɂ
+		int64_t tsEnd = (offset >= 0) ? tsPacketParser.getPacketOffset() + TS_PACKET_LENGTH : -1;
+		writeHandler.setCurrentPes(offset, tsEnd, videoPid_, packet);
 		psWriter.outVideoPesPacket(clock, frames, packet);
+		writeHandler.clearCurrentPes();
 	}
 
 	virtual void onVideoFormatChanged(VideoFormat fmt) {
@@ -253,7 +936,8 @@ protected:
 		if (!curVideoFormat_.isBasicEquals(fmt)) {
 			// AXyNgȊOύXĂt@C𕪂
 			//iStreamReformƏ킹Ȃ΂ȂȂƂɒӁj
-			writeHandler.open(setting_.getIntVideoFilePath(videoFileCount_++));
+			videoFileStartFrame_.push_back((int)videoFrameList_.size());
+			writeHandler.open(getIntVideoFilePath(videoFileCount_++));
 			psWriter.outHeader(videoStreamType_, audioStreamType_);
 		}
 		curVideoFormat_ = fmt;
@@ -270,22 +954,26 @@ protected:
 		const std::vector<AudioFrameData>& frames,
 		PESPacket packet)
 	{
+		int64_t offset = getPesOffset();
+		if (offset >= 0 && frames.size() > 0) {
+			TsIndexAudio e = { offset, frames[0].PTS, audioIdx, (int)frames.size() };
+			tsIndex_.audioPes.push_back(e);
+		}
 		for (const AudioFrameData& frame : frames) {
 			FileAudioFrameInfo info = frame;
 			info.audioIdx = audioIdx;
 			info.codedDataSize = frame.codedDataSize;
-			info.waveDataSize = frame.decodedDataSize;
 			info.fileOffset = audioFileSize_;
-			info.waveOffset = waveFileSize_;
+			// wavëʒu̓fR[hIĂifinishAudioDecodej
 			audioFile_.write(MemoryChunk(frame.codedData, frame.codedDataSize));
-			if (frame.decodedDataSize > 0) {
-				waveFile_.write(MemoryChunk((uint8_t*)frame.decodedData, frame.decodedDataSize));
-			}
+			getAudioDecoder(audioIdx).put(
+				std::vector<uint8_t>(frame.codedData, frame.codedData + frame.codedDataSize),
+				frame.codedDataSize);
 			audioFileSize_ += frame.codedDataSize;
-			waveFileSize_ += frame.decodedDataSize;
 			audioFrameList_.push_back(info);
 		}
-		if (videoFileCount_ > 0) {
+		// z[hł͉͒ԉft@CɓȂiAMTSourcewaveǂށj
+		if (videoFileCount_ > 0 && !writeHandler.isVirtualDemux()) {
 			psWriter.outAudioPesPacket(audioIdx, clock, frames, packet);
 		}
 	}
@@ -319,6 +1007,14 @@ protected:
 		return info;
 	}
 
+	virtual void onCaptionPes(int64_t clock, PESPacket packet) {
+		int64_t offset = getPesOffset();
+		if (offset >= 0) {
+			TsIndexCaption e = { offset, packet.has_PTS() ? packet.PTS : -1 };
+			tsIndex_.captions.push_back(e);
+		}
+	}
+
 	// TsPacketSelectorHandlerz֐ //
 
 	virtual void onPidTableChanged(const PMTESInfo video, const std::vector<PMTESInfo>& audio, const PMTESInfo caption) {
@@ -326,18 +1022,37 @@ protected:
 		TsSplitter::onPidTableChanged(video, audio, caption);
 
 		ASSERT(audio.size() > 0);
+		videoPid_ = video.pid;
 		videoStreamType_ = video.stype;
 		audioStreamType_ = audio[0].stype;
 
-		StreamEvent ev = StreamEvent();
-		ev.type = PID_TABLE_CHANGED;
-		ev.numAudio = (int)audio.size();
-		ev.frameIdx = (int)videoFrameList_.size();
-		streamEventList_.push_back(ev);
+		// 񕪊ŒS͈͂߂Ă玟̃`NɔC
+		if (isBeforeChunkEnd()) {
+			TsIndexProgram prog = TsIndexProgram();
+			// ǂݒi-1j͐擪Ƃ
+			prog.offset = std::max<int64_t>(0, tsPacketParser.getPacketOffset());
+			prog.serviceId = selectedServiceId;
+			prog.videoPid = video.pid;
+			prog.videoStreamType = video.stype;
+			prog.captionPid = caption.pid;
+			prog.numAudio = (int)audio.size();
+			for (int i = 0; i < std::min<int>(prog.numAudio, TSINDEX_MAX_AUDIO); ++i) {
+				prog.audioPid[i] = audio[i].pid;
+			}
+			tsIndex_.programs.push_back(prog);
+
+			StreamEvent ev = StreamEvent();
+			ev.type = PID_TABLE_CHANGED;
+			ev.numAudio = (int)audio.size();
+			ev.frameIdx = (int)videoFrameList_.size();
+			streamEventList_.push_back(ev);
+		}
 	}
 
 	virtual void onTime(int64_t clock, JSTTime time) {
-		timeList_.push_back(std::make_pair(clock, time));
+		if (isBeforeChunkEnd()) {
+			timeList_.push_back(std::make_pair(clock, time));
+		}
 	}
 };
 
@@ -557,7 +1272,8 @@ static void transcodeMain(AMTContext& ctx, const ConfigWrapper& setting)
 			fmt.videoFormat, fmt.audioFormat[0],
 			reformInfo.getFilterSourceFrames(videoFileIndex),
 			reformInfo.getFilterSourceAudioFrames(videoFileIndex),
-			setting.getDecoderSetting());
+			setting.getDecoderSetting(),
+			setting.isFrameStore() ? setting.getTmpFrameStorePath(videoFileIndex) : tstring());
 	}
 
 	// SECM
@@ -885,19 +1601,14 @@ public:
 	DrcsSearchSplitter(AMTContext& ctx, const ConfigWrapper& setting)
 		: TsSplitter(ctx, true, false, true)
 		, setting_(setting)
-	{ }
+	{
+		setInitBufferSize(setting.getInitBufferSize());
+	}
 
 	void readAll()
 	{
-		enum { BUFSIZE = 4 * 1024 * 1024 };
-		auto buffer_ptr = std::unique_ptr<uint8_t[]>(new uint8_t[BUFSIZE]);
-		MemoryChunk buffer(buffer_ptr.get(), BUFSIZE);
-		File srcfile(setting_.getSrcFilePath(), _T("rb"));
-		size_t readBytes;
-		do {
-			readBytes = srcfile.read(buffer);
-			inputTsData(MemoryChunk(buffer.data, readBytes));
-		} while (readBytes == buffer.length);
+		TsFileReader reader(ctx, setting_);
+		reader.read(*this);
 	}
 
 protected:
@@ -950,26 +1661,21 @@ public:
 		: TsSplitter(ctx, true, false, true)
 		, setting_(setting)
 		, hasSubtltle_(false)
-	{ }
+	{
+		setInitBufferSize(setting.getInitBufferSize());
+	}
 
 	void readAll(int maxframes)
 	{
-		enum { BUFSIZE = 4 * 1024 * 1024 };
-		auto buffer_ptr = std::unique_ptr<uint8_t[]>(new uint8_t[BUFSIZE]);
-		MemoryChunk buffer(buffer_ptr.get(), BUFSIZE);
-		File srcfile(setting_.getSrcFilePath(), _T("rb"));
-		auto fileSize = srcfile.size();
+		TsFileReader reader(ctx, setting_);
+		auto fileSize = reader.size();
 		// t@C擪10%̂Ƃ납ǂ
-		srcfile.seek(fileSize / 10, SEEK_SET);
-		int64_t totalRead = 0;
+		int64_t begin = fileSize / 10;
 		// Ō10%͓ǂ܂Ȃ
 		int64_t end = fileSize / 10 * 9;
-		size_t readBytes;
-		do {
-			readBytes = srcfile.read(buffer);
-			inputTsData(MemoryChunk(buffer.data, readBytes));
-			totalRead += readBytes;
-		} while (totalRead < end && !hasSubtltle_ && videoFrameList_.size() < maxframes);
+		reader.read(*this, begin, begin + end, [&] {
+			return !hasSubtltle_ && videoFrameList_.size() < maxframes;
+		});
 	}
 
 	bool getHasSubtitle() const {
@@ -1027,26 +1733,23 @@ public:
 	AudioDetectorSplitter(AMTContext& ctx, const ConfigWrapper& setting)
 		: TsSplitter(ctx, true, true, false)
 		, setting_(setting)
-	{ }
+	{
+		setInitBufferSize(setting.getInitBufferSize());
+		// tH[}bg΂̂ŃfR[hf[^͗vȂ
+		setAudioDecode(false);
+	}
 
 	void readAll(int maxframes)
 	{
-		enum { BUFSIZE = 4 * 1024 * 1024 };
-		auto buffer_ptr = std::unique_ptr<uint8_t[]>(new uint8_t[BUFSIZE]);
-		MemoryChunk buffer(buffer_ptr.get(), BUFSIZE);
-		File srcfile(setting_.getSrcFilePath(), _T("rb"));
-		auto fileSize = srcfile.size();
+		TsFileReader reader(ctx, setting_);
+		auto fileSize = reader.size();
 		// t@C擪10%̂Ƃ납ǂ
-		srcfile.seek(fileSize / 10, SEEK_SET);
-		int64_t totalRead = 0;
+		int64_t begin = fileSize / 10;
 		// Ō10%͓ǂ܂Ȃ
 		int64_t end = fileSize / 10 * 9;
-		size_t readBytes;
-		do {
-			readBytes = srcfile.read(buffer);
-			inputTsData(MemoryChunk(buffer.data, readBytes));
-			totalRead += readBytes;
-		} while (totalRead < end && videoFrameList_.size() < maxframes);
+		reader.read(*this, begin, begin + end, [&] {
+			return videoFrameList_.size() < maxframes;
+		});
 	}
 
 protected:
@@ -1093,6 +1796,183 @@ protected:
 	virtual void onTime(int64_t clock, JSTTime time) { }
 };
 
+// DRCSǑA̗LAtH[}bg̎擾1̓ǂݍ݂ōs
+// DRCS̓t@CŚAƉ̓t@C擪10%̂Ƃȍ~
+// Ɖ͓o炻ȍ~͏ȂiDRCŜ߂ɎpPbgŌ܂ŏj
+class ProbeSplitter : public TsSplitter {
+public:
+	ProbeSplitter(AMTContext& ctx, const ConfigWrapper& setting)
+		: TsSplitter(ctx, true, true, true)
+		, setting_(setting)
+		, maxframes_(0)
+		, firstVideoPTS_(-1)
+		, numWindowFrames_(0)
+		, windowActive_(false)
+		, hasSubtitle_(false)
+		, subtitleFinished_(false)
+		, audioFinished_(false)
+	{
+		setInitBufferSize(setting.getInitBufferSize());
+		// tH[}bg΂̂ŃfR[hf[^͗vȂ
+		setAudioDecode(false);
+	}
+
+	void readAll(int maxframes)
+	{
+		maxframes_ = maxframes;
+		TsFileReader reader(ctx, setting_);
+		auto fileSize = reader.size();
+		int64_t begin = fileSize / 10;
+		// 擪10%DRCŜ߂ɓǂ
+		reader.read(*this, 0, begin, [] { return true; });
+		startWindow();
+		reader.read(*this, begin, fileSize, [&] {
+			updateProbeState();
+			return true;
+		});
+		updateProbeState();
+	}
+
+	bool getHasSubtitle() const {
+		return hasSubtitle_;
+	}
+
+	// ʂJSONŏo
+	std::string getReportJson() const {
+		StringBuilder sb;
+		sb.append("{ \"srcpath\": \"%s\"", toJsonString(setting_.getSrcFilePath()))
+			.append(", \"subtitles\": %s", hasSubtitle_ ? "true" : "false")
+			.append(", \"audio\": [");
+		for (int i = 0; i < (int)audioReport_.size(); ++i) {
+			if (i > 0) sb.append(", ");
+			sb.append("{ \"index\": %d, \"channels\": \"%s\", \"samplerate\": %d }",
+				audioReport_[i].first, getAudioChannelString(audioReport_[i].second.channels),
+				audioReport_[i].second.sampleRate);
+		}
+		sb.append("], \"drcs\": [");
+		for (int i = 0; i < (int)drcsFiles_.size(); ++i) {
+			if (i > 0) sb.append(", ");
+			sb.append("\"%s\"", toJsonString(drcsFiles_[i]));
+		}
+		sb.append("] }");
+		return sb.str();
+	}
+
+protected:
+	const ConfigWrapper& setting_;
+	int maxframes_;
+	int64_t firstVideoPTS_;
+	int numWindowFrames_; // 10%̈ʒuȍ~̉ft[
+	bool windowActive_;
+	bool hasSubtitle_;
+	bool subtitleFinished_;
+	bool audioFinished_;
+	std::vector<AudioFormat> curAudioFormat_;
+	std::vector<std::pair<int, AudioFormat>> audioReport_;
+	std::set<std::string> drcsMd5_;
+	std::vector<tstring> drcsFiles_;
+
+	void startWindow() {
+		windowActive_ = true;
+		// ǂݎn߂ꍇƓɂȂ悤Ɍ݂̃tH[}bgo͂Ă
+		for (int i = 0; i < (int)curAudioFormat_.size(); ++i) {
+			if (curAudioFormat_[i].channels != AUDIO_NONE) {
+				audioReport_.emplace_back(i, curAudioFormat_[i]);
+			}
+		}
+	}
+
+	void updateProbeState() {
+		if (!windowActive_) return;
+		bool framesReached = numWindowFrames_ >= maxframes_;
+		if (!subtitleFinished_ && (hasSubtitle_ || framesReached)) {
+			subtitleFinished_ = true;
+			ctx.infoF("芮: %s", hasSubtitle_ ? "" : "Ȃ");
+		}
+		if (!audioFinished_ && framesReached) {
+			audioFinished_ = true;
+			ctx.info("tH[}bg擾");
+		}
+	}
+
+	// f͎Ɖ̔肪I܂ŕKv
+	bool isVideoNeeded() const {
+		return !(subtitleFinished_ && audioFinished_);
+	}
+
+	// TsSplitterz֐ //
+
+	virtual void onVideoPacket(int64_t clock, TsPacket packet) {
+		if (isVideoNeeded()) {
+			TsSplitter::onVideoPacket(clock, packet);
+		}
+	}
+
+	virtual void onAudioPacket(int64_t clock, TsPacket packet, int audioIdx) {
+		if (!audioFinished_) {
+			TsSplitter::onAudioPacket(clock, packet, audioIdx);
+		}
+	}
+
+	virtual void onCaptionPacket(int64_t clock, TsPacket packet) {
+		// 肪I̎DRCŜ߂ɏ
+		if (windowActive_ && !subtitleFinished_) {
+			hasSubtitle_ = true;
+		}
+		TsSplitter::onCaptionPacket(clock, packet);
+	}
+
+	virtual void onVideoPesPacket(
+		int64_t clock,
+		const std::vector<VideoFrameInfo>& frames,
+		PESPacket packet)
+	{
+		if (frames.size() > 0 && firstVideoPTS_ == -1) {
+			firstVideoPTS_ = frames[0].PTS;
+		}
+		if (windowActive_) {
+			numWindowFrames_ += (int)frames.size();
+		}
+	}
+
+	virtual void onVideoFormatChanged(VideoFormat fmt) { }
+
+	virtual void onAudioPesPacket(
+		int audioIdx,
+		int64_t clock,
+		const std::vector<AudioFrameData>& frames,
+		PESPacket packet)
+	{ }
+
+	virtual void onAudioFormatChanged(int audioIdx, AudioFormat fmt) {
+		if ((int)curAudioFormat_.size() <= audioIdx) {
+			curAudioFormat_.resize(audioIdx + 1);
+		}
+		curAudioFormat_[audioIdx] = fmt;
+		if (windowActive_) {
+			audioReport_.emplace_back(audioIdx, fmt);
+		}
+	}
+
+	virtual void onCaptionPesPacket(
+		int64_t clock,
+		std::vector<CaptionItem>& captions,
+		PESPacket packet)
+	{ }
+
+	virtual DRCSOutInfo getDRCSOutPath(int64_t PTS, const std::string& md5) {
+		DRCSOutInfo info;
+		info.elapsed = (firstVideoPTS_ != -1) ? (double)(PTS - firstVideoPTS_) : -1.0;
+		info.filename = setting_.getDRCSOutPath(md5);
+		if (drcsMd5_.insert(md5).second) {
+			drcsFiles_.push_back(info.filename);
+		}
+		return info;
+	}
+
+	virtual void onTime(int64_t clock, JSTTime time) { }
+};
+
 static void searchDrcsMain(AMTContext& ctx, const ConfigWrapper& setting)
 {
 	Stopwatch sw;
@@ -1105,8 +1985,42 @@ static void searchDrcsMain(AMTContext& ctx, const ConfigWrapper& setting)
 	ctx.infoF(": %.2fb", sw.getAndReset());
 }
 
+// TSCfbNXTSǂ܂Ɏ̗L𔻒肷
+// SubtitleDetectorSplitterƓt@C擪10%̂Ƃ납fmaxframest[
+static bool detectSubtitleByIndex(AMTContext& ctx, const ConfigWrapper& setting, bool& hasSubtitle)
+{
+	TsIndex index;
+	const tstring& srcpath = setting.getSrcFilePath();
+	if (!index.load(TsIndex::GetIndexPath(srcpath), srcpath) || !index.captionIndexed) {
+		return false;
+	}
+	int64_t begin = index.srcFileSize / 10;
+	int64_t end = index.srcFileSize / 10 * 9;
+	const TsIndexProgram* prog = index.findProgram(begin);
+	if (prog == nullptr || (setting.getServiceId() > 0 && prog->serviceId != setting.getServiceId())) {
+		return false;
+	}
+	const TsIndexClock* clock = TsIndex::FindByOffset(index.clocks, begin);
+	if (clock != nullptr) {
+		// 29.97fpsƂmaxframest[
+		int64_t duration = (int64_t)setting.getMaxFrames() * 27000000 * 1001 / 30000;
+		int64_t offset = index.findOffsetByClock(clock->clock + duration);
+		if (offset > begin) {
+			end = std::min(end, offset);
+		}
+	}
+	hasSubtitle = index.hasCaption(begin, end);
+	ctx.info("TSCfbNX画肵܂");
+	return true;
+}
+
 static void detectSubtitleMain(AMTContext& ctx, const ConfigWrapper& setting)
 {
+	bool hasSubtitle;
+	if (detectSubtitleByIndex(ctx, setting, hasSubtitle)) {
+		printf("%s\n", hasSubtitle ? "" : "Ȃ");
+		return;
+	}
 	auto splitter = std::unique_ptr<SubtitleDetectorSplitter>(new SubtitleDetectorSplitter(ctx, setting));
 	if (setting.getServiceId() > 0) {
 		splitter->setServiceId(setting.getServiceId());
@@ -1123,3 +2037,23 @@ static void detectAudioMain(AMTContext& ctx, const ConfigWrapper& setting)
 	}
 	splitter->readAll(setting.getMaxFrames());
 }
+
+static void probeAllMain(AMTContext& ctx, const ConfigWrapper& setting)
+{
+	Stopwatch sw;
+	sw.start();
+	auto splitter = std::unique_ptr<ProbeSplitter>(new ProbeSplitter(ctx, setting));
+	if (setting.getServiceId() > 0) {
+		splitter->setServiceId(setting.getServiceId());
+	}
+	splitter->readAll(setting.getMaxFrames());
+	ctx.infoF(": %.2fb", sw.getAndReset());
+
+	std::string str = splitter->getReportJson();
+	printf("%s\n", str.c_str());
+	if (setting.getOutInfoJsonPath().size() > 0) {
+		MemoryChunk mc(reinterpret_cast<uint8_t*>(const_cast<char*>(str.data())), str.size());
+		File file(setting.getOutInfoJsonPath(), _T("w"));
+		file.write(mc);
+	}
+}
@@ -98,6 +98,13 @@ enum ENUM_FORMAT {
 	FORMAT_TS,
 };
 
+// TSt@C̓ǂݍݕ@
+enum ENUM_INPUT_ENGINE {
+	INPUT_ENGINE_READ,	// freadœǂݍŃp[T֓
+	INPUT_ENGINE_MMAP,	// }bvăp[T֒ړ
+	INPUT_ENGINE_READAHEAD,	// ʃXbhŐǂ݂Ȃp[T֓
+};
+
 struct BitrateSetting {
 	double a, b;
 	double h264;
@@ -484,6 +491,24 @@ struct Config {
 	int cmoutmask;
 	// o[hp
 	int maxframes;
+	// TS̓ǂݍݕ@
+	ENUM_INPUT_ENGINE inputEngine;
+	// TS̕񐔁i0Ř_RAj
+	int splitThreads;
+	// TSTSCfbNXē̓t@C̉ɕۑ
+	bool tsIndex;
+	// iPAT,PMT,PCR҂jɕۑĂTS̃TCYiMBA0Ŋlj
+	int initBufferSize;
+	// ԉft@COS̃t@CLbVʂɏ
+	bool intVideoNoCache;
+	// ԉft@C炸AMTSourceœTS璼ړǂ
+	bool virtualDemux;
+	// ŏɃfR[ht[ۑ2ڈȍ~AMTSource͂ǂ
+	bool frameStore;
+	// S͎ɉ͗p̏kPxvLVchapter_exe͂ǂ
+	bool lumaProxy;
+	// S͂̕]Xbhi0Ŏj
+	int logoThreads;
 	// zXgvZXƂ̒ʐMp
 	HANDLE inPipe;
 	HANDLE outPipe;
@@ -702,6 +727,42 @@ public:
 		return conf.maxframes;
 	}
 
+	ENUM_INPUT_ENGINE getInputEngine() const {
+		return conf.inputEngine;
+	}
+
+	int getSplitThreads() const {
+		return (conf.splitThreads > 0) ? conf.splitThreads : GetProcessorCount();
+	}
+
+	bool isTsIndexEnabled() const {
+		return conf.tsIndex;
+	}
+
+	int getInitBufferSize() const {
+		return conf.initBufferSize;
+	}
+
+	bool isIntVideoNoCache() const {
+		return conf.intVideoNoCache;
+	}
+
+	bool isVirtualDemux() const {
+		return conf.virtualDemux;
+	}
+
+	bool isFrameStore() const {
+		return conf.frameStore;
+	}
+
+	bool isLumaProxy() const {
+		return conf.lumaProxy;
+	}
+
+	int getLogoThreads() const {
+		return conf.logoThreads;
+	}
+
 	HANDLE getInPipe() const {
 		return conf.inPipe;
 	}
@@ -734,10 +795,21 @@ public:
 		return regtmp(StringFormat(_T("%s/audio.wav"), tmpDir.path()));
 	}
 
+	// 2Ԗڈȍ~̉̃fR[hXbho͂ꎞt@C
+  tstring getWaveFilePath(int audioIdx) const {
+		return regtmp(StringFormat(_T("%s/audio%d.wav"), tmpDir.path(), audioIdx));
+	}
+
   tstring getIntVideoFilePath(int index) const {
 		return regtmp(StringFormat(_T("%s/i%d.mpg"), tmpDir.path(), index));
 	}
 
+	// 񕪊Ŋe`No͂ꎞt@C
+	// name: i%d.mpg, audio.dat, audio.wav ɑΉ閼O
+  tstring getSplitPartFilePath(int part, const tstring& name) const {
+		return regtmp(StringFormat(_T("%s/p%d-%s"), tmpDir.path(), part, name));
+	}
+
   tstring getStreamInfoPath() const {
 		return conf.outVideoPath + _T("-streaminfo.dat");
 	}
@@ -798,6 +870,18 @@ public:
 		return regtmp(StringFormat(_T("%s/amts%d.avs"), tmpDir.path(), vindex));
 	}
 
+	tstring getTmpFrameStorePath(int vindex) const {
+		return regtmp(StringFormat(_T("%s/frames%d.dat"), tmpDir.path(), vindex));
+	}
+
+	tstring getTmpLumaProxyPath(int vindex) const {
+		return regtmp(StringFormat(_T("%s/proxy%d.dat"), tmpDir.path(), vindex));
+	}
+
+	tstring getTmpProxyAVSPath(int vindex) const {
+		return regtmp(StringFormat(_T("%s/proxy%d.avs"), tmpDir.path(), vindex));
+	}
+
   tstring getTmpLogoFramePath(int vindex) const {
 		return regtmp(StringFormat(_T("%s/logof%d.txt"), tmpDir.path(), vindex));
 	}
@@ -1013,6 +1097,31 @@ public:
 		ctx.infoF("fR[_: MPEG2:%s H264:%s",
 			decoderToString(conf.decoderSetting.mpeg2),
 			decoderToString(conf.decoderSetting.h264));
+		ctx.infoF("͓ǂݍ: %s", inputEngineToString(conf.inputEngine));
+		if (getSplitThreads() > 1) {
+			ctx.infoF("TS: %d", getSplitThreads());
+		}
+		if (conf.tsIndex) {
+			ctx.info("TSCfbNX: 쐬");
+		}
+		if (conf.initBufferSize > 0) {
+			ctx.infoF("҂obt@: %dMB", conf.initBufferSize);
+		}
+		if (conf.intVideoNoCache) {
+			ctx.info("ԉft@C: LbVȂŏ");
+		}
+		if (conf.virtualDemux) {
+			ctx.info("ԉft@C: 炸ɓTS璼ړǂ");
+		}
+		if (conf.frameStore) {
+			ctx.info("fR[hς݃t[: ۑĎg");
+		}
+		if (conf.lumaProxy) {
+			ctx.info("͗pvLV: S͎ɍ쐬ăV[`FW͂Ɏg");
+		}
+		if (conf.logoThreads > 0) {
+			ctx.infoF("S̓Xbh: %d", conf.logoThreads);
+		}
 	}
 
 	void CreateTempDir() {
@@ -1033,6 +1142,14 @@ private:
 		return "default";
 	}
 
+	const char* inputEngineToString(ENUM_INPUT_ENGINE engine) const {
+		switch (engine) {
+		case INPUT_ENGINE_MMAP: return "mmap";
+		case INPUT_ENGINE_READAHEAD: return "readahead";
+		}
+		return "read";
+	}
+
 	const char* formatToString(ENUM_FORMAT fmt) const {
 		switch (fmt) {
 		case FORMAT_MP4: return "MP4";
@@ -0,0 +1,356 @@
+/**
+* Amtasukaze TS Index
+* Copyright (c) 2017-2018 Nekopanda
+*
+* This software is released under the MIT License.
+* http://opensource.org/licenses/mit-license.php
+*/
+#pragma once
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <vector>
+#include <algorithm>
+
+#include "StreamUtils.hpp"
+
+// TSt@C̍\L^CfbNX
+// ɍTSt@CƓꏊɕۑĂA
+// ȍ~̃V[N擾ōŏTS͂Ȃčςނ悤ɂ
+// ʒu͑STSt@C̃oCgʒu
+
+enum {
+	TSINDEX_MAX_AUDIO = 8,
+};
+
+// PMTŌ܂PID\ ̃Gg̈ʒu܂ŗL
+struct TsIndexProgram {
+	int64_t offset;
+	int32_t serviceId;
+	int32_t videoPid;
+	int32_t videoStreamType;
+	int32_t captionPid;
+	int32_t numAudio;
+	int32_t audioPid[TSINDEX_MAX_AUDIO];
+
+	bool isSameStream(const TsIndexProgram& o) const {
+		if (serviceId != o.serviceId || videoPid != o.videoPid ||
+			videoStreamType != o.videoStreamType || captionPid != o.captionPid ||
+			numAudio != o.numAudio) return false;
+		for (int i = 0; i < std::min<int>(numAudio, TSINDEX_MAX_AUDIO); ++i) {
+			if (audioPid[i] != o.audioPid[i]) return false;
+		}
+		return true;
+	}
+};
+
+// PCR̃Tviclock27MHzj
+struct TsIndexClock {
+	int64_t offset;
+	int64_t clock;
+};
+
+// f̃_ANZX\ȃt[iMPEG2̓V[PXwb_AH.264SPSj܂PESpPbg
+struct TsIndexVideo {
+	int64_t offset;
+	int64_t PTS;
+	int64_t DTS;
+};
+
+// PESpPbg
+struct TsIndexAudio {
+	int64_t offset;
+	int64_t PTS;
+	int32_t audioIdx;
+	int32_t numFrames;
+};
+
+// PESpPbg
+struct TsIndexCaption {
+	int64_t offset;
+	int64_t PTS;
+};
+
+class TsIndex {
+	static const int64_t MAGIC = 0x58444954544D41LL; // "AMTTIDX"
+	static const int32_t VERSION = 1;
+public:
+	TsIndex()
+		: srcFileSize(0)
+		, srcFileTime(0)
+		, captionIndexed(false)
+	{ }
+
+	int64_t srcFileSize;
+	int64_t srcFileTime;
+	bool captionIndexed; // ͂čifalseȂcaptions͋j
+	std::vector<TsIndexProgram> programs;
+	std::vector<TsIndexClock> clocks;
+	std::vector<TsIndexVideo> keyFrames;
+	std::vector<TsIndexAudio> audioPes;
+	std::vector<TsIndexCaption> captions;
+
+	static tstring GetIndexPath(const tstring& srcpath) {
+		return srcpath + _T(".amtidx");
+	}
+
+	// t@CTCYƍXV
+	static bool GetFileStamp(const tstring& path, int64_t& size, int64_t& time) {
+		struct _stat64 st;
+		if (_tstat64(path.c_str(), &st) != 0) {
+			return false;
+		}
+		size = st.st_size;
+		time = st.st_mtime;
+		return true;
+	}
+
+	void save(const tstring& path) const {
+		File file(path, _T("wb"));
+		file.writeValue((int64_t)MAGIC);
+		file.writeValue((int32_t)VERSION);
+		file.writeValue(srcFileSize);
+		file.writeValue(srcFileTime);
+		file.writeValue((int32_t)captionIndexed);
+		file.writeArray(programs);
+		file.writeArray(clocks);
+		file.writeArray(keyFrames);
+		file.writeArray(audioPes);
+		file.writeArray(captions);
+	}
+
+	// CfbNXȂAsrcpathTSt@C쐬ύXĂfalse
+	bool load(const tstring& path, const tstring& srcpath) {
+		int64_t size, time;
+		if (!GetFileStamp(srcpath, size, time) || !File::exists(path)) {
+			return false;
+		}
+		try {
+			File file(path, _T("rb"));
+			if (file.readValue<int64_t>() != MAGIC || file.readValue<int32_t>() != VERSION) {
+				return false;
+			}
+			srcFileSize = file.readValue<int64_t>();
+			srcFileTime = file.readValue<int64_t>();
+			if (srcFileSize != size || srcFileTime != time) {
+				return false;
+			}
+			captionIndexed = (file.readValue<int32_t>() != 0);
+			programs = file.readArray<TsIndexProgram>();
+			clocks = file.readArray<TsIndexClock>();
+			keyFrames = file.readArray<TsIndexVideo>();
+			audioPes = file.readArray<TsIndexAudio>();
+			captions = file.readArray<TsIndexCaption>();
+		}
+		catch (const Exception&) {
+			return false;
+		}
+		return true;
+	}
+
+	// offsetȑOōŌ̃GgiȂnullptrj
+	template <typename T>
+	static const T* FindByOffset(const std::vector<T>& list, int64_t offset) {
+		auto it = std::upper_bound(list.begin(), list.end(), offset,
+			[](int64_t off, const T& e) { return off < e.offset; });
+		return (it == list.begin()) ? nullptr : &*(it - 1);
+	}
+
+	const TsIndexProgram* findProgram(int64_t offset) const {
+		return FindByOffset(programs, offset);
+	}
+
+	const TsIndexVideo* findKeyFrame(int64_t offset) const {
+		return FindByOffset(keyFrames, offset);
+	}
+
+	// clockȑOōŌPCRTv̈ʒuiȂ-1j
+	int64_t findOffsetByClock(int64_t clock) const {
+		auto it = std::upper_bound(clocks.begin(), clocks.end(), clock,
+			[](int64_t c, const TsIndexClock& e) { return c < e.clock; });
+		return (it == clocks.begin()) ? -1 : (it - 1)->offset;
+	}
+
+	// [begin,end)Ɏ邩
+	bool hasCaption(int64_t begin, int64_t end) const {
+		auto it = std::lower_bound(captions.begin(), captions.end(), begin,
+			[](const TsIndexCaption& e, int64_t off) { return e.offset < off; });
+		return it != captions.end() && it->offset < end;
+	}
+
+	// 񕪊ŕʁXɍCfbNXɌ
+	// offsetBaseõ`Ñt@C̊Jnʒu
+	void append(const TsIndex& o, int64_t offsetBase) {
+		for (int i = 0; i < (int)o.programs.size(); ++i) {
+			TsIndexProgram e = o.programs[i];
+			// `N擪PMT͒Õ`NƓȂsv
+			if (i == 0 && programs.size() > 0 && programs.back().isSameStream(e)) continue;
+			e.offset += offsetBase;
+			programs.push_back(e);
+		}
+		AppendList(clocks, o.clocks, offsetBase);
+		AppendList(keyFrames, o.keyFrames, offsetBase);
+		AppendList(audioPes, o.audioPes, offsetBase);
+		AppendList(captions, o.captions, offsetBase);
+	}
+
+private:
+	template <typename T>
+	static void AppendList(std::vector<T>& dst, const std::vector<T>& src, int64_t offsetBase) {
+		for (T e : src) {
+			e.offset += offsetBase;
+			dst.push_back(e);
+		}
+	}
+};
+
+// z[hŒԉft@CiPSj̑ɏo͂CfbNX
+// PS̃oCĝpackwb_EPESwb_͕ۑĂA
+// fPES̃yC[h͌TSt@Cǂݒčč\
+// offsetPS̃oCgʒuAtsOffset,tsEndTSt@C̃oCgʒu
+
+// fPESpPbgTSt@C͈̔
+struct VirtualPsPes {
+	int64_t tsOffset; // PES̐擪TSpPbg̈ʒu
+	int64_t tsEnd; // PES̍ŌTSpPbg̈ʒu
+	int32_t pid;
+	int32_t length; // PESpPbgŜ̃oCg
+};
+
+// PS\f[^
+struct VirtualPsSegment {
+	int64_t offset;
+	int64_t srcOffset; // pes-1ȂheaderDatäʒuAłȂPESpPbg擪̈ʒu
+	int32_t pes; // pesList̃CfbNXi-1ȂheaderDataɂj
+	int32_t length;
+};
+
+class VirtualPsIndex {
+	static const int64_t MAGIC = 0x49535056544D41LL; // "AMTVPSI"
+	static const int32_t VERSION = 1;
+public:
+	VirtualPsIndex()
+		: size(0)
+		, curPes(-1)
+		, curPesData()
+	{ }
+
+	tstring srcpath; // TSt@C
+	int64_t size; // PSŜ̃oCg
+	std::vector<VirtualPsPes> pesList;
+	std::vector<VirtualPsSegment> segments;
+	std::vector<uint8_t> headerData;
+
+	// addf[^̂packet̃ɂ̂TSǂݒ
+	// TS̈ʒusitsOffset-1j̏ꍇ̓yC[hheaderDataɕۑ
+	void setCurrentPes(int64_t tsOffset, int64_t tsEnd, int pid, MemoryChunk packet) {
+		curPes = -1;
+		if (tsOffset >= 0 && tsEnd > tsOffset) {
+			VirtualPsPes pes = { tsOffset, tsEnd, pid, (int32_t)packet.length };
+			curPes = (int)pesList.size();
+			curPesData = packet;
+			pesList.push_back(pes);
+		}
+	}
+
+	void clearCurrentPes() {
+		curPes = -1;
+	}
+
+	// PS̃f[^ɒǉ
+	void add(MemoryChunk mc) {
+		if (mc.length == 0) return;
+		if (curPes >= 0 && mc.data >= curPesData.data &&
+			mc.data + mc.length <= curPesData.data + curPesData.length)
+		{
+			VirtualPsSegment seg = { size, mc.data - curPesData.data, curPes, (int32_t)mc.length };
+			segments.push_back(seg);
+		}
+		else {
+			if (segments.size() > 0 && segments.back().pes == -1) {
+				// OheaderDataȂ瑱
+				segments.back().length += (int32_t)mc.length;
+			}
+			else {
+				VirtualPsSegment seg = { size, (int64_t)headerData.size(), -1, (int32_t)mc.length };
+				segments.push_back(seg);
+			}
+			headerData.insert(headerData.end(), mc.data, mc.data + mc.length);
+		}
+		size += mc.length;
+	}
+
+	// offset܂ރf[^Ёi͈͊OȂnullptrj
+	const VirtualPsSegment* findSegment(int64_t offset) const {
+		if (offset < 0 || offset >= size) return nullptr;
+		auto it = std::upper_bound(segments.begin(), segments.end(), offset,
+			[](int64_t off, const VirtualPsSegment& e) { return off < e.offset; });
+		return &*(it - 1);
+	}
+
+	// 񕪊ŕʁXɍCfbNXɌ
+	// tsOffsetBaseõ`Ñt@C̊Jnʒu
+	void append(const VirtualPsIndex& o, int64_t tsOffsetBase) {
+		int pesBase = (int)pesList.size();
+		int64_t headerBase = (int64_t)headerData.size();
+		for (VirtualPsPes pes : o.pesList) {
+			pes.tsOffset += tsOffsetBase;
+			pes.tsEnd += tsOffsetBase;
+			pesList.push_back(pes);
+		}
+		for (VirtualPsSegment seg : o.segments) {
+			seg.offset += size;
+			if (seg.pes == -1) {
+				seg.srcOffset += headerBase;
+			}
+			else {
+				seg.pes += pesBase;
+			}
+			segments.push_back(seg);
+		}
+		headerData.insert(headerData.end(), o.headerData.begin(), o.headerData.end());
+		size += o.size;
+		curPes = -1;
+	}
+
+	void save(const tstring& path) const {
+		File file(path, _T("wb"));
+		file.writeValue((int64_t)MAGIC);
+		file.writeValue((int32_t)VERSION);
+		file.writeArray(std::vector<tchar>(srcpath.begin(), srcpath.end()));
+		file.writeValue(size);
+		file.writeArray(pesList);
+		file.writeArray(segments);
+		file.writeArray(headerData);
+	}
+
+	void load(const tstring& path) {
+		File file(path, _T("rb"));
+		if (file.readValue<int64_t>() != MAGIC || file.readValue<int32_t>() != VERSION) {
+			THROWF(FormatException, "zCfbNXł͂܂: %s", path);
+		}
+		auto srcpathv = file.readArray<tchar>();
+		srcpath = tstring(srcpathv.begin(), srcpathv.end());
+		size = file.readValue<int64_t>();
+		pesList = file.readArray<VirtualPsPes>();
+		segments = file.readArray<VirtualPsSegment>();
+		headerData = file.readArray<uint8_t>();
+		curPes = -1;
+	}
+
+	// pathzCfbNXiԉft@CƓOŏo͂̂ŒgŔʂj
+	static bool IsIndexFile(const tstring& path) {
+		try {
+			File file(path, _T("rb"));
+			return file.size() >= 8 && file.readValue<int64_t>() == MAGIC;
+		}
+		catch (const Exception&) {
+			return false;
+		}
+	}
+
+private:
+	int curPes;
+	MemoryChunk curPesData;
+};
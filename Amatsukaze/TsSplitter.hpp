@@ -35,7 +35,9 @@ public:
 		, mpeg2parser(ctx)
 		, h264parser(ctx)
 		, parser(&mpeg2parser)
-	{ }
+	{
+		mpeg2parser.setHeaderOnlyScan(true);
+	}
 
 	void setStreamFormat(VIDEO_STREAM_FORMAT streamFormat) {
 		if (videoStreamFormat != streamFormat) {
@@ -54,6 +56,16 @@ public:
 
 	VIDEO_STREAM_FORMAT getStreamFormat() { return videoStreamFormat; }
 
+	// MPEG2fPESyC[h̍voCg
+	int64_t getNumMpeg2InputBytes() const {
+		return mpeg2parser.getNumInputBytes();
+	}
+
+	// MPEG2fŃXCXf[^ǂ܂ɍς񂾃oCg
+	int64_t getNumMpeg2SkippedBytes() const {
+		return mpeg2parser.getNumSkippedBytes();
+	}
+
 	void reset() {
 		videoFormat = VideoFormat();
 		parser->reset();
@@ -148,6 +160,11 @@ public:
 
 	virtual void onAudioFormatChanged(AudioFormat fmt) = 0;
 
+	// false: fR[hf[^o͂Ȃ
+	void setDecodeEnabled(bool enabled) {
+		adtsParser.setDecodeEnabled(enabled);
+	}
+
 private:
 	AudioFormat format;
 
@@ -250,14 +267,20 @@ private:
 };
 
 // TSXg[ʂ߂悤ɂ
+// iPAT,PMT,PCR҂jI܂ŃpPbgۑĂ
+// Iŏǂݒ悤ɂp[T
+// ۑ͌Œ蒷̃Oobt@ŁAtɂȂÂpPbg㏑
 class TsPacketBuffer : public TsPacketParser {
 public:
 	TsPacketBuffer(AMTContext& ctx)
 		: TsPacketParser(ctx)
 		, handler(NULL)
+		, head(0)
 		, numBefferedPackets_(0)
 		, numMaxPackets(0)
 		, buffering(false)
+		, replaying(false)
+		, overflowed(false)
 	{ }
 
 	void setHandler(TsPacketHandler* handler) {
@@ -269,7 +292,9 @@ public:
 	}
 
 	void clearBuffer() {
-		buffer.clear();
+		// gȂ̂Ń
+		std::vector<uint8_t>().swap(ring);
+		head = 0;
 		numBefferedPackets_ = 0;
 	}
 
@@ -280,41 +305,73 @@ public:
 		}
 	}
 
+	// obt@O͕ύXȂ
 	void setNumBufferingPackets(int numPackets) {
 		numMaxPackets = numPackets;
+		clearBuffer();
 	}
 
+	// ۑpPbg擪꒼ipPbg̓Rs[Ȃj
 	void backAndInput() {
 		if (handler != NULL) {
-			for (int i = 0; i < (int)buffer.size(); i += TS_PACKET_LENGTH) {
-				TsPacket packet(buffer.ptr() + i);
-				if (packet.parse() && packet.check()) {
-					handler->onTsPacket(-1, packet);
-				}
+			replaying = true;
+			// nh̒clearBufferꂽI
+			for (int i = 0; i < numBefferedPackets_; ++i) {
+				TsPacket packet(ring.data() + (size_t)((head + i) % numMaxPackets) * TS_PACKET_LENGTH);
+				// ۑɃ`FbNς
+				packet.parse();
+				handler->onTsPacket(-1, packet);
 			}
+			replaying = false;
 		}
 	}
 
+	// ǂݒ̃pPbg͈ʒu킩Ȃ̂-1Ԃ
+	int64_t getPacketOffset() const {
+		return replaying ? -1 : TsPacketParser::getPacketOffset();
+	}
+
 	virtual void onTsPacket(TsPacket packet) {
-		if (buffering) {
-			if (numBefferedPackets_ >= numMaxPackets) {
-				buffer.trimHead((numMaxPackets - numBefferedPackets_ + 1) * TS_PACKET_LENGTH);
-				numBefferedPackets_ = numMaxPackets - 1;
+		if (buffering && numMaxPackets > 0) {
+			if (ring.size() == 0) {
+				ring.resize((size_t)numMaxPackets * TS_PACKET_LENGTH);
 			}
-			buffer.add(MemoryChunk(packet.data, TS_PACKET_LENGTH));
-			++numBefferedPackets_;
+			int slot;
+			if (numBefferedPackets_ < numMaxPackets) {
+				slot = (head + numBefferedPackets_++) % numMaxPackets;
+			}
+			else {
+				// tȂ̂ňԌÂpPbg㏑
+				if (!overflowed) {
+					ctx.warnF("҂̃obt@i%dpPbgjtɂȂ̂Ő擪̃pPbĝĂ܂",
+						numMaxPackets);
+					overflowed = true;
+				}
+				slot = head;
+				head = (head + 1) % numMaxPackets;
+			}
+			memcpy(ring.data() + (size_t)slot * TS_PACKET_LENGTH, packet.data, TS_PACKET_LENGTH);
 		}
 		if (handler != NULL) {
 			handler->onTsPacket(-1, packet);
 		}
 	}
 
+	virtual void onTsPacketsSkipped(int numPackets) {
+		if (handler != NULL) {
+			handler->onTsPacketsSkipped(numPackets);
+		}
+	}
+
 private:
 	TsPacketHandler* handler;
-	AutoBuffer buffer;
+	std::vector<uint8_t> ring;
+	int head; // ԌÂpPbg̃Xbg
 	int numBefferedPackets_;
 	int numMaxPackets;
 	bool buffering;
+	bool replaying;
+	bool overflowed;
 };
 
 class TsSystemClock {
@@ -351,6 +408,11 @@ public:
 		numTotakPacketsReveived = 0;
 	}
 
+	// ͂ȂpPbg̐ipPbg̈ʒuNbNvẐŐ͓邱Ɓj
+	void skipPackets(int numPackets) {
+		numTotakPacketsReveived += numPackets;
+	}
+
 	// TSXg[̑Sf[^邱
 	void inputTsPacket(TsPacket packet) {
 		if (packet.PID() == PcrPid) {
@@ -415,9 +477,18 @@ public:
 		, enableCaption(enableCaption)
 		, numTotalPackets(0)
 		, numScramblePackets(0)
+		, chunkMode(false)
+		, chunkEnd(-1)
+		, chunkCutOffset(-1)
+		, videoState(ES_ACTIVE)
+		, captionState(ES_ACTIVE)
+		, initialEsState(ES_ACTIVE)
+		, deferCaption(false)
+		, decodeAudio(true)
+		, pesOffset(-1)
 	{
 		tsPacketParser.setHandler(&tsPacketHandler);
-		tsPacketParser.setNumBufferingPackets(50 * 1024); // 9.6MB
+		tsPacketParser.setNumBufferingPackets(DEFAULT_INIT_BUFFER_PACKETS);
 		tsPacketSelector.setHandler(this);
 		reset();
 	}
@@ -427,6 +498,7 @@ public:
 		preferedServiceId = -1;
 		selectedServiceId = -1;
 		tsPacketParser.setEnableBuffering(true);
+		tsPacketParser.setPidFilter(nullptr);
 	}
 
 	// 0ȉŎw薳
@@ -434,6 +506,14 @@ public:
 		preferedServiceId = sid;
 	}
 
+	// iPAT,PMT,PCR҂jɕۑĂTS̃TCYiMBA0ȉŊlj
+	// ̓rn܂ĂPCRPMTȂȂȂt@Cp
+	// ͂n߂OɌĂԂ
+	void setInitBufferSize(int sizeMB) {
+		tsPacketParser.setNumBufferingPackets((sizeMB > 0) ?
+			(int)((int64_t)sizeMB * 1024 * 1024 / TS_PACKET_LENGTH) : DEFAULT_INIT_BUFFER_PACKETS);
+	}
+
 	int getActualServiceId() {
 		return selectedServiceId;
 	}
@@ -453,7 +533,72 @@ public:
 		return numScramblePackets;
 	}
 
+	int64_t getNumMpeg2InputBytes() const {
+		return videoParser.getNumMpeg2InputBytes();
+	}
+
+	int64_t getNumMpeg2SkippedBytes() const {
+		return videoParser.getNumMpeg2SkippedBytes();
+	}
+
+	// 񕪊œ͂̈ꕔS
+	// f̓_ANZX|CgAƎ͂̌̍ŏPESŒS؂ւ
+	// isFirstChunk: falseȂŏ̃_ANZX|CgÔ͎Ă
+	// chunkEnd: ͐擪炱̈ʒuȍ~̍ŏ̃_ANZX|CgŏIi̒lŖj
+	void setChunkRange(bool isFirstChunk, int64_t chunkEnd) {
+		this->chunkMode = !isFirstChunk || chunkEnd >= 0;
+		this->chunkEnd = chunkEnd;
+		initialEsState = isFirstChunk ? ES_ACTIVE : ES_WAITING;
+		videoState = captionState = initialEsState;
+		audioStates.assign(audioStates.size(), initialEsState);
+	}
+
+	// S̏SďI
+	bool isChunkFinished() const {
+		if (videoState != ES_FINISHED) {
+			return false;
+		}
+		// r؂ꂽĂI悤ɉf̏Iʂőł؂
+		if (tsPacketParser.getPacketOffset() >= chunkCutOffset + CHUNK_TAIL_MARGIN) {
+			return true;
+		}
+		for (auto state : audioStates) {
+			if (state != ES_FINISHED) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// PESpPbgDLLɒʂɕۑiDLL̓XbhZ[tłȂ߁j
+	void setDeferCaption(bool defer) {
+		deferCaption = defer;
+	}
+
+	// false: ̃fR[hf[^iAudioFrameData::decodedDatajo͂Ȃ
+	// fR[hsvȏꍇʃXbhŃfR[hꍇp
+	void setAudioDecode(bool decode) {
+		decodeAudio = decode;
+		for (auto parser : audioParsers) {
+			parser->setDecodeEnabled(decode);
+		}
+	}
+
+	// ۑꂽPESpPbg
+	void inputCaptionPes(int64_t clock, MemoryChunk data) {
+		PESPacket packet(data);
+		if (packet.parse() && packet.check()) {
+			// ۑonCaptionPes͌Ă΂Ă̂ŒڎDLLɒʂ
+			captionParser.CaptionParser::onPesPacket(clock, packet);
+		}
+	}
+
 protected:
+	enum {
+		CHUNK_TAIL_MARGIN = 8 * 1024 * 1024,
+		DEFAULT_INIT_BUFFER_PACKETS = 50 * 1024, // 9.6MB
+	};
+
 	enum INITIALIZATION_PHASE {
 		PMT_WAITING,	// PAT,PMT҂
 		PCR_WAITING,	// rbg[g擾̂PCR2M
@@ -472,6 +617,10 @@ protected:
 			int64_t packetClock = this_.tsSystemClock.getClock(0);
 			this_.tsPacketSelector.inputTsPacket(packetClock, packet);
 		}
+
+		virtual void onTsPacketsSkipped(int numPackets) {
+			this_.tsSystemClock.skipPackets(numPackets);
+		}
 	};
 	class PcrDetectionHandler : public TsPacketHandler {
 		TsSplitter& this_;
@@ -496,6 +645,8 @@ protected:
 				this_.tsPacketParser.backAndInput();
 				// KvȂ̂Ńobt@OOFF
 				this_.tsPacketParser.setEnableBuffering(false);
+				// ȍ~͎gȂPID̃pPbg̓p[TŎ̂Ă
+				this_.tsPacketParser.setPidFilter(this_.tsPacketSelector.getPassFilter());
 			}
 		}
 	};
@@ -506,6 +657,11 @@ protected:
 			: VideoFrameParser(ctx), this_(this_) { }
 
 	protected:
+		virtual void onPesPacket(int64_t clock, PESPacket packet) {
+			this_.pesOffset = getPesOffset();
+			VideoFrameParser::onPesPacket(clock, packet);
+		}
+
 		virtual void onVideoPesPacket(int64_t clock, const std::vector<VideoFrameInfo>& frames, PESPacket packet) {
 			if (clock == -1) {
 				ctx.error("Video PES Packet ɃNbN񂪂܂");
@@ -526,6 +682,11 @@ protected:
 			: AudioFrameParser(ctx), this_(this_), audioIdx(audioIdx) { }
 
 	protected:
+		virtual void onPesPacket(int64_t clock, PESPacket packet) {
+			this_.pesOffset = getPesOffset();
+			AudioFrameParser::onPesPacket(clock, packet);
+		}
+
 		virtual void onAudioPesPacket(int64_t clock, const std::vector<AudioFrameData>& frames, PESPacket packet) {
 			this_.onAudioPesPacket(audioIdx, clock, frames, packet);
 		}
@@ -540,6 +701,17 @@ protected:
 		SpCaptionParser(AMTContext&ctx, TsSplitter& this_)
 			: CaptionParser(ctx), this_(this_) { }
 
+		virtual void onPesPacket(int64_t clock, PESPacket packet) {
+			this_.pesOffset = getPesOffset();
+			this_.onCaptionPes(clock, packet);
+			if (this_.deferCaption) {
+				this_.deferredCaptionList.emplace_back(clock,
+					std::vector<uint8_t>(packet.data, packet.data + packet.length));
+				return;
+			}
+			CaptionParser::onPesPacket(clock, packet);
+		}
+
 	protected:
 		virtual void onCaptionPesPacket(int64_t clock, std::vector<CaptionItem>& captions, PESPacket packet) {
 			this_.onCaptionPesPacket(clock, captions, packet);
@@ -571,6 +743,28 @@ protected:
 	int64_t numTotalPackets;
 	int64_t numScramblePackets;
 
+	// 񕪊p
+	enum CHUNK_ES_STATE {
+		ES_WAITING,  // SJnO
+		ES_ACTIVE,   // S
+		ES_FINISHED, // ̃`NɈp
+	};
+	bool chunkMode;
+	int64_t chunkEnd;
+	int64_t chunkCutOffset; // f̃`NɈpʒu
+	CHUNK_ES_STATE videoState;
+	std::vector<CHUNK_ES_STATE> audioStates;
+	CHUNK_ES_STATE captionState;
+	CHUNK_ES_STATE initialEsState;
+
+	bool deferCaption;
+	std::vector<std::pair<int64_t, std::vector<uint8_t>>> deferredCaptionList;
+
+	bool decodeAudio;
+
+	// PES̐擪TSpPbg̈ʒu
+	int64_t pesOffset;
+
 	virtual void onVideoPesPacket(
 		int64_t clock,
 		const std::vector<VideoFrameInfo>& frames,
@@ -593,6 +787,9 @@ protected:
 
 	virtual DRCSOutInfo getDRCSOutPath(int64_t PTS, const std::string& md5) = 0;
 
+	// PESiDLLʂOȂ̂Ŏ̒xĂ΂j
+	virtual void onCaptionPes(int64_t clock, PESPacket packet) { }
+
 	// T[rXݒ肷ꍇ̓T[rXpidsł̃CfbNX
 	// ȂɂȂꍇ͕̒l̕Ԃ
 	virtual int onPidSelect(int TSID, const std::vector<int>& pids) {
@@ -627,6 +824,7 @@ protected:
 			// PCRnhɒuTSŏǂݒ
 			tsPacketParser.setHandler(&pcrDetectionHandler);
 			tsSystemClock.setPcrPid(PcrPid);
+			tsPacketSelector.addPassPid(PcrPid);
 			tsPacketSelector.resetParser();
 			tsSystemClock.backTs();
 			tsPacketParser.backAndInput();
@@ -651,6 +849,8 @@ protected:
 			while (audioParsers.size() < numAudios) {
 				int audioIdx = int(audioParsers.size());
 				audioParsers.push_back(new SpAudioFrameParser(ctx, *this, audioIdx));
+				audioParsers.back()->setDecodeEnabled(decodeAudio);
+				audioStates.push_back(initialEsState);
 				ctx.infoF("p[T %d ǉ", audioIdx);
 			}
 		}
@@ -665,19 +865,105 @@ protected:
 		return true;
 	}
 
+	// PES̐擪pPbg_ANZX\Ȉʒu
+	//iMPEG2̓V[PXwb_AH.264SPSOKƂj
+	static bool isRandomAccessPesStart(VIDEO_STREAM_FORMAT format, MemoryChunk payload) {
+		if (payload.length < 9 ||
+			payload.data[0] != 0 || payload.data[1] != 0 || payload.data[2] != 1) {
+			return false;
+		}
+		int esStart = 9 + payload.data[8];
+		for (int i = esStart; i + 3 < (int)payload.length; ++i) {
+			if (payload.data[i] == 0 && payload.data[i + 1] == 0 && payload.data[i + 2] == 1) {
+				uint8_t code = payload.data[i + 3];
+				if (format == VS_H264) {
+					if ((code & 0x1F) == 7) return true;
+				}
+				else if (code == 0xB3) {
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	// eESo͒PES̐擪TSpPbg̈ʒuiǂݒȂǂŕsȏꍇ-1j
+	// 񕪊͓̓`N̐擪̈ʒu
+	int64_t getPesOffset() const {
+		return pesOffset;
+	}
+
+	// ̃pPbg񕪊̒S͈͓
+	bool isBeforeChunkEnd() const {
+		return chunkEnd < 0 || tsPacketParser.getPacketOffset() < chunkEnd;
+	}
+
+	// 񕪊ɂ̃`NŏfpPbg
+	bool checkChunkVideo(int64_t clock, TsPacket packet) {
+		if (videoState == ES_FINISHED) {
+			return false;
+		}
+		if (!packet.payload_unit_start_indicator() ||
+			!isRandomAccessPesStart(videoParser.getStreamFormat(), packet.payload()))
+		{
+			return videoState == ES_ACTIVE;
+		}
+		int64_t offset = tsPacketParser.getPacketOffset();
+		if (chunkEnd >= 0 && offset >= chunkEnd) {
+			// 玟̃`N̒SȂ̂ŗ܂ĂPESoďI
+			videoParser.flush(clock);
+			videoState = ES_FINISHED;
+			chunkCutOffset = offset;
+			return false;
+		}
+		videoState = ES_ACTIVE;
+		return true;
+	}
+
+	// 񕪊ɂ̃`Nŏ鉹EpPbg
+	bool checkChunkEs(CHUNK_ES_STATE& state, PesParser& parser, int64_t clock, TsPacket packet) {
+		if (state == ES_FINISHED) {
+			return false;
+		}
+		if (packet.payload_unit_start_indicator()) {
+			if (videoState == ES_FINISHED) {
+				parser.flush(clock);
+				state = ES_FINISHED;
+				return false;
+			}
+			if (videoState == ES_ACTIVE) {
+				state = ES_ACTIVE;
+			}
+		}
+		return state == ES_ACTIVE;
+	}
+
 	virtual void onVideoPacket(int64_t clock, TsPacket packet) {
-		if(enableVideo && checkScramble(packet)) videoParser.onTsPacket(clock, packet);
+		if (!enableVideo) return;
+		if (chunkMode && !checkChunkVideo(clock, packet)) return;
+		if (checkScramble(packet)) {
+			videoParser.setPacketOffset(tsPacketParser.getPacketOffset());
+			videoParser.onTsPacket(clock, packet);
+		}
 	}
 
 	virtual void onAudioPacket(int64_t clock, TsPacket packet, int audioIdx) {
-		if (enableAudio && checkScramble(packet)) {
-			ASSERT(audioIdx < (int)audioParsers.size());
+		if (!enableAudio) return;
+		ASSERT(audioIdx < (int)audioParsers.size());
+		if (chunkMode && !checkChunkEs(audioStates[audioIdx], *audioParsers[audioIdx], clock, packet)) return;
+		if (checkScramble(packet)) {
+			audioParsers[audioIdx]->setPacketOffset(tsPacketParser.getPacketOffset());
 			audioParsers[audioIdx]->onTsPacket(clock, packet);
 		}
 	}
 
 	virtual void onCaptionPacket(int64_t clock, TsPacket packet) {
-		if (enableCaption && checkScramble(packet)) captionParser.onTsPacket(clock, packet);
+		if (!enableCaption) return;
+		if (chunkMode && !checkChunkEs(captionState, captionParser, clock, packet)) return;
+		if (checkScramble(packet)) {
+			captionParser.setPacketOffset(tsPacketParser.getPacketOffset());
+			captionParser.onTsPacket(clock, packet);
+		}
 	}
 };
 
@@ -155,6 +155,24 @@ TEST(CRC, CheckCRC)
 	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
 }
 
+TEST(CRC, CRCEngines)
+{
+	const wchar_t* args[] = { L"AmatsukazeTest.exe", L"--mode", L"test_crc_engines" };
+	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
+}
+
+TEST(CRC, CRCPerformance)
+{
+	const wchar_t* args[] = { L"AmatsukazeTest.exe", L"--mode", L"test_crc_perf" };
+	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
+}
+
+TEST(Util, Mpeg2ScanPerformance)
+{
+	const wchar_t* args[] = { L"AmatsukazeTest.exe", L"--mode", L"test_mpeg2_scan_perf" };
+	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
+}
+
 TEST(Util, readOpt)
 {
 	const wchar_t* args[] = { L"AmatsukazeTest.exe", L"--mode", L"test_read_bits" };
@@ -167,6 +185,48 @@ TEST(Util, AutoBufferTest)
 	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
 }
 
+TEST(Util, TsPacketParserTest)
+{
+	const wchar_t* args[] = { L"AmatsukazeTest.exe", L"--mode", L"test_ts_packet_parser" };
+	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
+}
+
+TEST(Util, TsPacketBufferTest)
+{
+	const wchar_t* args[] = { L"AmatsukazeTest.exe", L"--mode", L"test_ts_packet_buffer" };
+	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
+}
+
+TEST(Util, H264NalScannerTest)
+{
+	const wchar_t* args[] = { L"AmatsukazeTest.exe", L"--mode", L"test_h264_nal_scan" };
+	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
+}
+
+TEST(Util, TsResyncPerformance)
+{
+	const wchar_t* args[] = { L"AmatsukazeTest.exe", L"--mode", L"test_ts_resync_perf" };
+	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
+}
+
+TEST(Util, LogoCorrelationPerformance)
+{
+	const wchar_t* args[] = { L"AmatsukazeTest.exe", L"--mode", L"test_logo_corr_perf" };
+	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
+}
+
+TEST(Util, LogoBackgroundCheck)
+{
+	const wchar_t* args[] = { L"AmatsukazeTest.exe", L"--mode", L"test_logo_bg_check" };
+	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
+}
+
+TEST(Util, LogoFilterPerformance)
+{
+	const wchar_t* args[] = { L"AmatsukazeTest.exe", L"--mode", L"test_logo_filter_perf" };
+	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
+}
+
 void VerifyMpeg2Ps(std::wstring srcfile)
 {
 	const wchar_t* args[] = { L"AmatsukazeTest.exe", L"--mode", L"test_verifympeg2ps", L"-i", srcfile.c_str() };
@@ -220,6 +280,127 @@ TEST_F(TestBase, LargeTsParse) {
 	ParserTest(LargeTsFile, false);
 }
 
+// 񕪊̌ʂʏ̕ƈv邩
+TEST_F(TestBase, ParallelSplitTest) {
+	std::wstring srcfile = TestDataDir + L"\\" + MPEG2VideoTsFile + L".ts";
+	std::wstring dstDir = TestWorkDir + L"\\";
+
+	if (MPEG2VideoTsFile.size() == 0 || !fileExists(srcfile.c_str())) {
+		fprintf(stderr, "eXgt@CȂ̂ŃXLbv: %ls\n", srcfile.c_str());
+		return;
+	}
+
+	const wchar_t* args[] = {
+		L"AmatsukazeTest.exe", L"--mode", L"test_parallel_split",
+		L"-i", srcfile.c_str(),
+		L"-w", dstDir.c_str(),
+	};
+	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
+}
+
+// ʃXbhŃfR[hwavefR[hʂƈv邩
+TEST_F(TestBase, AsyncAudioDecodeTest) {
+	std::wstring srcfile = TestDataDir + L"\\" + MPEG2VideoTsFile + L".ts";
+	std::wstring dstDir = TestWorkDir + L"\\";
+
+	if (MPEG2VideoTsFile.size() == 0 || !fileExists(srcfile.c_str())) {
+		fprintf(stderr, "eXgt@CȂ̂ŃXLbv: %ls\n", srcfile.c_str());
+		return;
+	}
+
+	const wchar_t* args[] = {
+		L"AmatsukazeTest.exe", L"--mode", L"test_async_audio_decode",
+		L"-i", srcfile.c_str(),
+		L"-w", dstDir.c_str(),
+	};
+	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
+}
+
+// BlockFileWriterŏt@C̃f[^ƈv邩
+TEST_F(TestBase, BlockFileWriterTest) {
+	std::wstring dstDir = TestWorkDir + L"\\";
+
+	const wchar_t* args[] = {
+		L"AmatsukazeTest.exe", L"--mode", L"test_block_file_writer",
+		L"-w", dstDir.c_str(),
+	};
+	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
+}
+
+// DecodedFrameStoreŕۑt[̂܂ܓǂ߂邩
+TEST_F(TestBase, DecodedFrameStoreTest) {
+	std::wstring dstDir = TestWorkDir + L"\\";
+
+	const wchar_t* args[] = {
+		L"AmatsukazeTest.exe", L"--mode", L"test_frame_store",
+		L"-w", dstDir.c_str(),
+	};
+	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
+}
+
+// TSCfbNẌʒuAۑēǂݒ邩
+TEST_F(TestBase, TsIndexTest) {
+	std::wstring srcfile = TestDataDir + L"\\" + MPEG2VideoTsFile + L".ts";
+	std::wstring dstDir = TestWorkDir + L"\\";
+
+	if (MPEG2VideoTsFile.size() == 0 || !fileExists(srcfile.c_str())) {
+		fprintf(stderr, "eXgt@CȂ̂ŃXLbv: %ls\n", srcfile.c_str());
+		return;
+	}
+
+	const wchar_t* args[] = {
+		L"AmatsukazeTest.exe", L"--mode", L"test_ts_index",
+		L"-i", srcfile.c_str(),
+		L"-w", dstDir.c_str(),
+	};
+	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
+}
+
+// ͈͂ォn܂TSprobe_allprobe_subtitles̎肪v邩
+TEST_F(TestBase, ProbeAllLateCaptionTest) {
+	std::wstring srcfile = TestDataDir + L"\\" + MPEG2VideoTsFile + L".ts";
+	std::wstring dstDir = TestWorkDir + L"\\";
+	std::wstring latefile = dstDir + L"late_caption.ts";
+
+	if (MPEG2VideoTsFile.size() == 0 || !fileExists(srcfile.c_str())) {
+		fprintf(stderr, "eXgt@CȂ̂ŃXLbv: %ls\n", srcfile.c_str());
+		return;
+	}
+
+	const wchar_t* args[] = {
+		L"AmatsukazeTest.exe", L"--mode", L"test_late_caption_ts",
+		L"-i", srcfile.c_str(),
+		L"-a", latefile.c_str(),
+		L"-w", dstDir.c_str(),
+	};
+	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
+
+	const wchar_t* args2[] = {
+		L"AmatsukazeTest.exe", L"--mode", L"test_probe_all_subtitle",
+		L"-i", latefile.c_str(),
+		L"--max-frames", L"150",
+		L"-w", dstDir.c_str(),
+	};
+	EXPECT_EQ(AmatsukazeCLI(LEN(args2), args2), 0);
+}
+
+TEST_F(TestBase, VirtualDemuxTest) {
+	std::wstring srcfile = TestDataDir + L"\\" + MPEG2VideoTsFile + L".ts";
+	std::wstring dstDir = TestWorkDir + L"\\";
+
+	if (MPEG2VideoTsFile.size() == 0 || !fileExists(srcfile.c_str())) {
+		fprintf(stderr, "eXgt@CȂ̂ŃXLbv: %ls\n", srcfile.c_str());
+		return;
+	}
+
+	const wchar_t* args[] = {
+		L"AmatsukazeTest.exe", L"--mode", L"test_virtual_demux",
+		L"-i", srcfile.c_str(),
+		L"-w", dstDir.c_str(),
+	};
+	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
+}
+
 TEST_F(TestBase, MPEG2PSVerifier) {
 	std::wstring srcfile = TestDataDir + L"\\" + SampleMPEG2PsFile + L".mpg";
 	VerifyMpeg2Ps(srcfile);
@@ -346,6 +527,71 @@ TEST_F(TestBase, LogoFrameTest)
 	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
 }
 
+// S͂̃XbhŌʂςȂ
+TEST_F(TestBase, LogoFrameThreadsTest)
+{
+	std::wstring srcDir = TestDataDir + L"\\";
+	std::wstring dstDir = TestWorkDir + L"\\";
+	std::wstring inavs = srcDir + L"input.avs";
+
+	const wchar_t* args[] = {
+		L"AmatsukazeTest.exe", L"--mode", L"test_logoframe_threads",
+		L"--logo", L"logo\\SID410-1.lgd",
+		L"--logo", L"logo\\SID410-2.lgd",
+		L"-w", dstDir.c_str(),
+		L"-f", inavs.c_str()
+	};
+	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
+}
+
+// Sč쐬̕fade]]ƈv邩
+TEST_F(TestBase, LogoRemakeTest)
+{
+	std::wstring srcDir = TestDataDir + L"\\";
+	std::wstring dstDir = TestWorkDir + L"\\";
+	std::wstring inavs = srcDir + L"input.avs";
+	std::wstring dstPath = dstDir + L"logoscan.utv";
+
+	const wchar_t* args[] = {
+		L"AmatsukazeTest.exe", L"--mode", L"test_logo_remake",
+		L"--logo", L"logo\\SID410-1.lgd",
+		L"--logo-threads", L"4",
+		L"-w", dstDir.c_str(),
+		L"-o", dstPath.c_str(),
+		L"-f", inavs.c_str()
+	};
+	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
+}
+
+// LumaProxyFileŏvLV̂܂ܓǂ߂邩
+TEST_F(TestBase, LumaProxyFileTest)
+{
+	std::wstring dstDir = TestWorkDir + L"\\";
+
+	const wchar_t* args[] = {
+		L"AmatsukazeTest.exe", L"--mode", L"test_luma_proxy",
+		L"-w", dstDir.c_str(),
+	};
+	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
+}
+
+// vLVǂchapter_exěʂfƓ
+TEST_F(TestBase, LumaProxyChapterTest)
+{
+	std::wstring srcDir = TestDataDir + L"\\";
+	std::wstring dstDir = TestWorkDir + L"\\";
+	std::wstring inavs = srcDir + L"input.avs";
+
+	const wchar_t* args[] = {
+		L"AmatsukazeTest.exe", L"--mode", L"test_luma_proxy_chapter",
+		L"--logo", L"logo\\SID410-1.lgd",
+		L"--logo", L"logo\\SID410-2.lgd",
+		L"-w", dstDir.c_str(),
+		L"-f", inavs.c_str()
+	};
+	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
+}
+
 TEST_F(TestBase, SplitDualMonoAAC)
 {
 	std::wstring srcDir = TestDataDir + L"\\";
@@ -360,6 +606,20 @@ TEST_F(TestBase, SplitDualMonoAAC)
 	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
 }
 
+TEST_F(TestBase, DualMonoParseTest)
+{
+	std::wstring srcDir = TestDataDir + L"\\";
+	std::wstring dstDir = TestWorkDir + L"\\";
+	std::wstring inaac = srcDir + L"dualmono.aac";
+
+	const wchar_t* args[] = {
+		L"AmatsukazeTest.exe", L"--mode", L"test_dualmono_parse",
+		L"-i", inaac.c_str(),
+		L"-w", dstDir.c_str(),
+	};
+	EXPECT_EQ(AmatsukazeCLI(LEN(args), args), 0);
+}
+
 TEST_F(TestBase, AACDecodeTest)
 {
 	std::wstring srcDir = TestDataDir + L"\\";
@@ -247,6 +247,12 @@ void* NEAACDECAPI NeAACDecDecode(NeAACDecHandle hDecoder,
                                  unsigned char *buffer,
                                  unsigned long buffer_size);
 
+/* element positions only (no spectral reconstruction) */
+void NEAACDECAPI NeAACDecParse(NeAACDecHandle hDecoder,
+                               NeAACDecFrameInfo *hInfo,
+                               unsigned char *buffer,
+                               unsigned long buffer_size);
+
 void* NEAACDECAPI NeAACDecDecode2(NeAACDecHandle hDecoder,
                                   NeAACDecFrameInfo *hInfo,
                                   unsigned char *buffer,
@@ -805,6 +805,25 @@ void* NEAACDECAPI NeAACDecDecode(NeAACDecHandle hpDecoder,
     return aac_frame_decode(hDecoder, hInfo, buffer, buffer_size, NULL, 0);
 }
 
+/* Parse the syntax elements of a frame without spectral reconstruction,
+ * filterbank or output conversion. Only bytesconsumed, fr_ch_ele,
+ * element_id, element_start and element_end of hInfo are meaningful.
+ * Overlap and prediction state is not updated, so the output of a
+ * following NeAACDecDecode on the same handle is not reliable.
+ */
+void NEAACDECAPI NeAACDecParse(NeAACDecHandle hpDecoder,
+                               NeAACDecFrameInfo *hInfo,
+                               unsigned char *buffer,
+                               unsigned long buffer_size)
+{
+    NeAACDecStruct* hDecoder = (NeAACDecStruct*)hpDecoder;
+    if (hDecoder == NULL)
+        return;
+    hDecoder->parse_only = 1;
+    aac_frame_decode(hDecoder, hInfo, buffer, buffer_size, NULL, 0);
+    hDecoder->parse_only = 0;
+}
+
 void* NEAACDECAPI NeAACDecDecode2(NeAACDecHandle hpDecoder,
                                   NeAACDecFrameInfo *hInfo,
                                   unsigned char *buffer,
@@ -1050,6 +1069,13 @@ static void* aac_frame_decode(NeAACDecStruct *hDecoder,
     /* Make a channel configuration based on either a PCE or a channelConfiguration */
     create_channel_config(hDecoder, hInfo);
 
+    /* parse only: element positions are all the caller wants */
+    if (hDecoder->parse_only)
+    {
+        hDecoder->frame++;
+        return NULL;
+    }
+
     /* number of samples in this frame */
     hInfo->samples = frame_len*output_channels;
     /* number of channels in this frame */
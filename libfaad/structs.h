@@ -426,6 +426,8 @@ typedef struct
 		// Nekopanda
 		int element_start[MAX_CHANNELS];
 		int element_end[MAX_CHANNELS];
+		/* NeAACDecParse: stop after the bitstream syntax (no reconstruction) */
+		uint8_t parse_only;
 
     /* Configuration data */
     NeAACDecConfiguration config;
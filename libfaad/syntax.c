@@ -631,6 +631,15 @@ static uint8_t single_lfe_channel_element(NeAACDecStruct *hDecoder, bitfile *ld,
     }
 #endif
 
+    /* parse only: element boundary is known, skip spectral reconstruction */
+    if (hDecoder->parse_only)
+    {
+        /* normally set in reconstruct_single_channel() */
+        if (hDecoder->element_output_channels[hDecoder->fr_ch_ele] == 0)
+            hDecoder->element_output_channels[hDecoder->fr_ch_ele] = 1;
+        return 0;
+    }
+
     /* noiseless coding is done, spectral reconstruction is done now */
     retval = reconstruct_single_channel(hDecoder, ics, &sce, spec_data);
     if (retval > 0)
@@ -759,6 +768,10 @@ static uint8_t channel_pair_element(NeAACDecStruct *hDecoder, bitfile *ld,
     }
 #endif
 
+    /* parse only: element boundary is known, skip spectral reconstruction */
+    if (hDecoder->parse_only)
+        return 0;
+
     /* noiseless coding is done, spectral reconstruction is done now */
     if ((result = reconstruct_channel_pair(hDecoder, ics1, ics2, &cpe,
         spec_data1, spec_data2)) > 0)